@@ -0,0 +1,413 @@
+/* benchmark-listing.c
+ *
+ * Copyright (C) 2017 Günther Wutz <info@gunibert.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Lists synthetic projects or issues from a SoupServer running in the
+ * same main context and reports throughput, latency and memory. Pages are
+ * generated up front, so the numbers cover the client only.
+ */
+
+#include <gitlab.h>
+#include <libsoup/soup.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+
+static gint n_pages = 20;
+static gint per_page = 100;
+static gint latency_ms = 0;
+static gint rate_limit = 0;
+static gint rate_window = 60;
+static gint iterations = 10;
+static gboolean issues = FALSE;
+static gboolean offset = FALSE;
+static gboolean intern_strings = FALSE;
+static gboolean lazy_projects = FALSE;
+static gboolean read_names = FALSE;
+
+static GOptionEntry entries[] = {
+	{ "pages", 0, 0, G_OPTION_ARG_INT, &n_pages, "Pages per listing", "N" },
+	{ "per-page", 0, 0, G_OPTION_ARG_INT, &per_page, "Objects per page", "N" },
+	{ "latency", 0, 0, G_OPTION_ARG_INT, &latency_ms, "Delay of every response", "MS" },
+	{ "rate-limit", 0, 0, G_OPTION_ARG_INT, &rate_limit, "Requests per window, 0 for no RateLimit headers", "N" },
+	{ "rate-window", 0, 0, G_OPTION_ARG_INT, &rate_window, "Length of the rate limit window", "SECONDS" },
+	{ "iterations", 0, 0, G_OPTION_ARG_INT, &iterations, "Listings to run", "N" },
+	{ "issues", 0, 0, G_OPTION_ARG_NONE, &issues, "List issues instead of projects", NULL },
+	{ "offset", 0, 0, G_OPTION_ARG_NONE, &offset, "List a group with numbered pages instead of keyset pages", NULL },
+	{ "intern-strings", 0, 0, G_OPTION_ARG_NONE, &intern_strings, "Set GitlabClient:intern-strings", NULL },
+	{ "lazy-projects", 0, 0, G_OPTION_ARG_NONE, &lazy_projects, "Set GitlabClient:lazy-projects", NULL },
+	{ "read-names", 0, 0, G_OPTION_ARG_NONE, &read_names, "Read the name of every listed project", NULL },
+	{ NULL }
+};
+
+typedef struct
+{
+	SoupServer *server;
+	GPtrArray  *pages;
+	gint64      window_start;
+	gint        window_requests;
+	guint       throttled;
+} BenchServer;
+
+typedef struct
+{
+	GMainLoop *loop;
+	GArray    *latencies;
+	guint      requests;
+	guint64    items;
+	gint64     parse_usec;
+	gint       remaining;
+	GError    *error;
+} BenchRun;
+
+typedef struct
+{
+	SoupServer  *server;
+	SoupMessage *msg;
+} BenchDelay;
+
+static GBytes *
+bench_build_page (guint page)
+{
+	GString *body = g_string_new ("[");
+
+	for (guint i = 0; i < (guint) per_page; i++) {
+		guint id = page * per_page + i + 1;
+
+		if (i > 0)
+			g_string_append_c (body, ',');
+
+		if (issues)
+			g_string_append_printf (body,
+			                        "{\"id\":%u,\"iid\":%u,\"project_id\":1,"
+			                        "\"title\":\"Synthetic issue %u\","
+			                        "\"description\":\"An issue generated to measure the client\","
+			                        "\"state\":\"opened\","
+			                        "\"web_url\":\"https://gitlab.example.com/bench/project/issues/%u\","
+			                        "\"updated_at\":\"2020-01-01T00:00:00.000Z\","
+			                        "\"labels\":[\"bench\"],\"author\":{\"id\":1,\"name\":\"Bench\"}}",
+			                        id, id, id, id);
+		else
+			g_string_append_printf (body,
+			                        "{\"id\":%u,\"name\":\"project-%u\","
+			                        "\"name_with_namespace\":\"bench / project-%u\","
+			                        "\"description\":\"A project generated to measure the client\","
+			                        "\"avatar_url\":null,"
+			                        "\"http_url_to_repo\":\"https://gitlab.example.com/bench/project-%u.git\","
+			                        "\"last_activity_at\":\"2020-01-01T00:00:00.000Z\","
+			                        "\"star_count\":%u,\"tag_list\":[],\"namespace\":{\"id\":1,\"path\":\"bench\"}}",
+			                        id, id, id, id, id % 100);
+	}
+
+	g_string_append_c (body, ']');
+
+	return g_string_free_to_bytes (body);
+}
+
+static gboolean
+bench_unpause_cb (gpointer user_data)
+{
+	BenchDelay *delay = user_data;
+
+	soup_server_unpause_message (delay->server, delay->msg);
+	g_object_unref (delay->msg);
+	g_free (delay);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+bench_set_rate_limit (BenchServer *self,
+                      SoupMessage *msg)
+{
+	gint64 now = g_get_real_time () / G_USEC_PER_SEC;
+	g_autofree gchar *limit = NULL;
+	g_autofree gchar *remaining = NULL;
+	g_autofree gchar *reset = NULL;
+
+	if (now - self->window_start >= rate_window) {
+		self->window_start = now;
+		self->window_requests = 0;
+	}
+	self->window_requests++;
+
+	limit = g_strdup_printf ("%d", rate_limit);
+	remaining = g_strdup_printf ("%d", MAX (rate_limit - self->window_requests, 0));
+	reset = g_strdup_printf ("%" G_GINT64_FORMAT, self->window_start + rate_window);
+
+	soup_message_headers_replace (msg->response_headers, "RateLimit-Limit", limit);
+	soup_message_headers_replace (msg->response_headers, "RateLimit-Remaining", remaining);
+	soup_message_headers_replace (msg->response_headers, "RateLimit-Reset", reset);
+}
+
+static void
+bench_server_cb (SoupServer        *server,
+                 SoupMessage       *msg,
+                 const char        *path,
+                 GHashTable        *query,
+                 SoupClientContext *client,
+                 gpointer           user_data)
+{
+	BenchServer *self = user_data;
+	const gchar *page_param = query ? g_hash_table_lookup (query, "page") : NULL;
+	const gchar *id_after = query ? g_hash_table_lookup (query, "id_after") : NULL;
+	gboolean keyset = query && g_strcmp0 (g_hash_table_lookup (query, "pagination"), "keyset") == 0;
+	GBytes *body;
+	guint page = 0;
+
+	if (!g_str_has_suffix (path, issues ? "/issues" : "/projects")) {
+		soup_message_set_status (msg, SOUP_STATUS_NOT_FOUND);
+		return;
+	}
+
+	if (rate_limit > 0) {
+		bench_set_rate_limit (self, msg);
+		if (self->window_requests > rate_limit) {
+			self->throttled++;
+			soup_message_headers_replace (msg->response_headers, "Retry-After", "1");
+			soup_message_set_status (msg, SOUP_STATUS_TOO_MANY_REQUESTS);
+			return;
+		}
+	}
+
+	if (keyset && id_after != NULL)
+		page = g_ascii_strtoull (id_after, NULL, 10) / per_page;
+	else if (page_param != NULL)
+		page = MAX (g_ascii_strtoull (page_param, NULL, 10), 1) - 1;
+
+	if (page >= self->pages->len) {
+		soup_message_set_status (msg, SOUP_STATUS_OK);
+		soup_message_set_response (msg, "application/json", SOUP_MEMORY_STATIC, "[]", 2);
+		return;
+	}
+
+	body = g_ptr_array_index (self->pages, page);
+	soup_message_set_status (msg, SOUP_STATUS_OK);
+	soup_message_set_response (msg, "application/json", SOUP_MEMORY_STATIC,
+	                           g_bytes_get_data (body, NULL), g_bytes_get_size (body));
+
+	if (keyset) {
+		if (page + 1 < self->pages->len) {
+			g_autoptr(GHashTable) next_query = g_hash_table_new (g_str_hash, g_str_equal);
+			g_autofree gchar *next_id = g_strdup_printf ("%u", (page + 1) * per_page);
+			g_autofree gchar *form = NULL;
+			g_autofree gchar *uri = NULL;
+			g_autofree gchar *link = NULL;
+			SoupURI *next;
+			GHashTableIter iter;
+			gpointer key;
+			gpointer value;
+
+			g_hash_table_iter_init (&iter, query);
+			while (g_hash_table_iter_next (&iter, &key, &value))
+				g_hash_table_insert (next_query, key, value);
+			g_hash_table_insert (next_query, (gpointer) "id_after", next_id);
+			form = soup_form_encode_hash (next_query);
+
+			next = soup_uri_copy (soup_message_get_uri (msg));
+			soup_uri_set_query (next, form);
+			uri = soup_uri_to_string (next, FALSE);
+			soup_uri_free (next);
+
+			link = g_strdup_printf ("<%s>; rel=\"next\"", uri);
+			soup_message_headers_replace (msg->response_headers, "Link", link);
+		}
+	} else {
+		g_autofree gchar *total = g_strdup_printf ("%u", self->pages->len);
+		g_autofree gchar *next_page = g_strdup_printf ("%u", page + 2);
+
+		soup_message_headers_replace (msg->response_headers, "X-Total-Pages", total);
+		if (page + 1 < self->pages->len)
+			soup_message_headers_replace (msg->response_headers, "X-Next-Page", next_page);
+	}
+
+	if (latency_ms > 0) {
+		BenchDelay *delay = g_new0 (BenchDelay, 1);
+
+		delay->server = server;
+		delay->msg = g_object_ref (msg);
+		soup_server_pause_message (server, msg);
+		g_timeout_add (latency_ms, bench_unpause_cb, delay);
+	}
+}
+
+static void
+bench_request_finished_cb (GitlabClient       *client,
+                           GitlabRequestStats *stats,
+                           gpointer            user_data)
+{
+	BenchRun *run = user_data;
+	gint64 total = 0;
+
+	for (guint i = 0; i < GITLAB_REQUEST_N_PHASES; i++)
+		total += stats->phase_usec[i];
+
+	g_array_append_val (run->latencies, total);
+	run->requests++;
+	run->items += stats->items;
+	run->parse_usec += stats->phase_usec[GITLAB_REQUEST_PHASE_PARSE];
+}
+
+static void bench_next (GitlabClient *client,
+                        BenchRun     *run);
+
+static void
+bench_listed_cb (GObject      *object,
+                 GAsyncResult *result,
+                 gpointer      user_data)
+{
+	GitlabClient *client = GITLAB_CLIENT (object);
+	BenchRun *run = user_data;
+	GList *list;
+
+	if (issues)
+		list = gitlab_client_get_project_issues_finish (client, result, &run->error);
+	else
+		list = gitlab_client_query_projects_finish (client, result, &run->error);
+
+	/* Lazy projects only pay for what is read */
+	if (read_names && !issues) {
+		for (GList *l = list; l != NULL; l = l->next)
+			gitlab_project_get_name (l->data);
+	}
+
+	g_list_free_full (list, g_object_unref);
+
+	if (run->error != NULL || --run->remaining == 0)
+		g_main_loop_quit (run->loop);
+	else
+		bench_next (client, run);
+}
+
+static void
+bench_next (GitlabClient *client,
+            BenchRun     *run)
+{
+	if (issues) {
+		g_autoptr(GitlabProject) project = gitlab_project_new (1, "bench / project", NULL, NULL);
+
+		gitlab_client_get_project_issues_async (client, project, bench_listed_cb, NULL, run);
+	} else {
+		g_autoptr(GitlabProjectQuery) query = gitlab_project_query_new ();
+
+		if (offset)
+			gitlab_project_query_set_group (query, "bench");
+		gitlab_project_query_set_per_page (query, per_page);
+		gitlab_client_query_projects_async (client, query, bench_listed_cb, NULL, run);
+	}
+}
+
+static gint64
+bench_percentile (GArray *sorted,
+                  guint   percentile)
+{
+	if (sorted->len == 0)
+		return 0;
+
+	return g_array_index (sorted, gint64, (sorted->len - 1) * percentile / 100);
+}
+
+static gint
+bench_compare (gconstpointer a,
+               gconstpointer b)
+{
+	gint64 x = *(const gint64 *) a;
+	gint64 y = *(const gint64 *) b;
+
+	return x < y ? -1 : x > y;
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+	g_autoptr(GOptionContext) context = NULL;
+	g_autoptr(GitlabClient) client = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autofree gchar *baseurl = NULL;
+	g_autofree gchar *root = NULL;
+	BenchServer server = { 0 };
+	BenchRun run = { 0 };
+	struct rusage usage;
+	GSList *uris;
+	gint64 start;
+	gdouble seconds;
+
+	context = g_option_context_new ("- benchmark gitlab-glib listings");
+	g_option_context_add_main_entries (context, entries, NULL);
+	if (!g_option_context_parse (context, &argc, &argv, &error)) {
+		g_printerr ("%s\n", error->message);
+		return EXIT_FAILURE;
+	}
+
+	server.pages = g_ptr_array_new_with_free_func ((GDestroyNotify) g_bytes_unref);
+	for (guint i = 0; i < (guint) n_pages; i++)
+		g_ptr_array_add (server.pages, bench_build_page (i));
+
+	server.server = soup_server_new (NULL, NULL);
+	soup_server_add_handler (server.server, "/api/v4", bench_server_cb, &server, NULL);
+	if (!soup_server_listen_local (server.server, 0, SOUP_SERVER_LISTEN_IPV4_ONLY, &error)) {
+		g_printerr ("%s\n", error->message);
+		return EXIT_FAILURE;
+	}
+
+	uris = soup_server_get_uris (server.server);
+	root = soup_uri_to_string (uris->data, FALSE);
+	g_slist_free_full (uris, (GDestroyNotify) soup_uri_free);
+	baseurl = g_strconcat (root, g_str_has_suffix (root, "/") ? "" : "/", "api/v4", NULL);
+
+	client = gitlab_client_new (baseurl, "bench");
+	g_object_set (client,
+	              "intern-strings", intern_strings,
+	              "lazy-projects", lazy_projects,
+	              NULL);
+
+	run.loop = g_main_loop_new (NULL, FALSE);
+	run.latencies = g_array_new (FALSE, FALSE, sizeof (gint64));
+	run.remaining = MAX (iterations, 1);
+	g_signal_connect (client, "request-finished", G_CALLBACK (bench_request_finished_cb), &run);
+
+	start = g_get_monotonic_time ();
+	bench_next (client, &run);
+	g_main_loop_run (run.loop);
+	seconds = (g_get_monotonic_time () - start) / (gdouble) G_USEC_PER_SEC;
+
+	if (run.error != NULL) {
+		g_printerr ("%s\n", run.error->message);
+		return EXIT_FAILURE;
+	}
+
+	g_array_sort (run.latencies, bench_compare);
+	getrusage (RUSAGE_SELF, &usage);
+
+	g_print ("requests/s:      %.1f\n", run.requests / seconds);
+	g_print ("%s/s:      %.1f\n", issues ? "issues" : "projects", run.items / seconds);
+	g_print ("parsed/s:        %.1f\n",
+	         run.parse_usec > 0 ? run.items * (gdouble) G_USEC_PER_SEC / run.parse_usec : 0.0);
+	g_print ("latency p50:     %.3f ms\n", bench_percentile (run.latencies, 50) / 1000.0);
+	g_print ("latency p99:     %.3f ms\n", bench_percentile (run.latencies, 99) / 1000.0);
+	g_print ("peak rss:        %ld KiB\n", usage.ru_maxrss);
+	if (rate_limit > 0)
+		g_print ("throttled:       %u\n", server.throttled);
+
+	g_array_unref (run.latencies);
+	g_main_loop_unref (run.loop);
+	g_ptr_array_unref (server.pages);
+	g_object_unref (server.server);
+
+	return EXIT_SUCCESS;
+}
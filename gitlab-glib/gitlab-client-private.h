@@ -0,0 +1,61 @@
+/* gitlab-client-private.h
+ *
+ * Copyright (C) 2017 Günther Wutz <info@gunibert.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <libsoup/soup.h>
+#include "gitlab-client.h"
+#include "gitlab-request-trace-private.h"
+#include "gitlab-response-cache-private.h"
+#include "gitlab-scheduler-private.h"
+
+G_BEGIN_DECLS
+
+SoupSession *_gitlab_client_get_session             (GitlabClient *self);
+GitlabScheduler *
+             _gitlab_client_get_scheduler           (GitlabClient *self);
+SoupMessage *_gitlab_client_auth_message            (GitlabClient *self,
+                                                     const gchar  *url);
+guint        _gitlab_client_get_max_pages_in_flight (GitlabClient *self);
+GitlabResponseCache *
+             _gitlab_client_get_response_cache      (GitlabClient *self);
+gchar       *_gitlab_client_get_cache_key           (GitlabClient *self,
+                                                     const gchar  *url);
+void         _gitlab_client_send_async              (GitlabClient        *self,
+                                                     SoupMessage         *msg,
+                                                     GCancellable        *cancellable,
+                                                     GAsyncReadyCallback  callback,
+                                                     gpointer             user_data);
+GBytes      *_gitlab_client_send_finish             (GitlabClient  *self,
+                                                     GAsyncResult  *result,
+                                                     GError       **error);
+void         _gitlab_client_send_parsed             (GitlabClient  *self,
+                                                     GAsyncResult  *result,
+                                                     guint          items);
+void         _gitlab_client_load_image_async        (GitlabClient        *self,
+                                                     const gchar         *url,
+                                                     GCancellable        *cancellable,
+                                                     GAsyncReadyCallback  callback,
+                                                     gpointer             user_data);
+GBytes      *_gitlab_client_load_image_finish       (GitlabClient  *self,
+                                                     GAsyncResult  *result,
+                                                     GError       **error);
+void         _gitlab_client_report                  (GitlabClient       *self,
+                                                     GitlabRequestTrace *trace);
+
+G_END_DECLS
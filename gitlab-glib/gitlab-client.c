@@ -17,17 +17,74 @@
  */
 
 #include "gitlab-client.h"
+#include "gitlab-client-private.h"
+#include "gitlab-disk-cache-private.h"
+#include "gitlab-error.h"
+#include "gitlab-graphql-private.h"
+#include "gitlab-image-cache-private.h"
+#include "gitlab-issue-private.h"
+#include "gitlab-pager-private.h"
+#include "gitlab-project-private.h"
+#include "gitlab-project-query-private.h"
+#include "gitlab-single-flight-private.h"
+#include "gitlab-sync-private.h"
+#ifdef HAVE_SYSPROF
+# include <sysprof-capture.h>
+#endif
 #include <libsoup/soup.h>
 #include <json-glib/json-glib.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
+/* Bucket i counts durations below 2^(i+1) microseconds, the last one the rest */
+#define GITLAB_CLIENT_HISTOGRAM_BUCKETS 32
+
+/* The downloaded images kept in memory and on disk, in bytes */
+#define GITLAB_CLIENT_IMAGE_CACHE_SIZE      (16 * 1024 * 1024)
+#define GITLAB_CLIENT_IMAGE_DISK_CACHE_SIZE (64 * 1024 * 1024)
+
+/* The parsed objects kept for revalidated pages */
+#define GITLAB_CLIENT_RESPONSE_CACHE_ITEMS 20000
+
+/* A download streams through one buffer of this size */
+#define GITLAB_CLIENT_DOWNLOAD_BUFFER_SIZE (64 * 1024)
+#define GITLAB_CLIENT_DOWNLOAD_ATTEMPTS    3
+
 struct _GitlabClient
 {
 	GObject parent_instance;
 
 	gchar *baseurl;
 	gchar *token;
+
+	SoupSession *session;
+	gint max_connections;
+	gint max_connections_per_host;
+	guint idle_timeout;
+	guint max_requests_in_flight;
+	GitlabScheduler *scheduler;
+	guint max_pages_in_flight;
+	guint max_projects_in_flight;
+	gboolean disk_cache;
+	gboolean intern_strings;
+	gboolean lazy_projects;
+
+	GitlabResponseCache *response_cache;
+	GitlabImageCache *images;
+	gint images_pruned;
+	GitlabSingleFlight *flights;
+
+	GMutex version_lock;
+	gchar *version;
+	gchar *revision;
+	GitlabCapabilities capabilities;
+
+	GMutex sync_lock;
+	GHashTable *syncs;
+
+	GMutex stats_lock;
+	guint histograms[GITLAB_REQUEST_N_PHASES][GITLAB_CLIENT_HISTOGRAM_BUCKETS];
 };
 
 G_DEFINE_TYPE (GitlabClient, gitlab_client, G_TYPE_OBJECT)
@@ -36,10 +93,26 @@ enum {
 	PROP_0,
 	PROP_BASEURL,
 	PROP_TOKEN,
+	PROP_MAX_CONNECTIONS,
+	PROP_MAX_CONNECTIONS_PER_HOST,
+	PROP_IDLE_TIMEOUT,
+	PROP_MAX_REQUESTS_IN_FLIGHT,
+	PROP_MAX_PAGES_IN_FLIGHT,
+	PROP_MAX_PROJECTS_IN_FLIGHT,
+	PROP_DISK_CACHE,
+	PROP_INTERN_STRINGS,
+	PROP_LAZY_PROJECTS,
 	N_PROPS
 };
 
+enum {
+	PROJECTS_UPDATED,
+	REQUEST_FINISHED,
+	N_SIGNALS
+};
+
 static GParamSpec *properties [N_PROPS];
+static guint signals [N_SIGNALS];
 
 GitlabClient *
 gitlab_client_new (gchar *baseurl,
@@ -61,6 +134,20 @@ gitlab_client_finalize (GObject *object)
 	g_free (self->baseurl);
 	g_free (self->token);
 
+	if (self->session != NULL)
+		soup_session_abort (self->session);
+	g_clear_object (&self->scheduler);
+	g_clear_object (&self->session);
+	g_clear_pointer (&self->response_cache, _gitlab_response_cache_free);
+	g_clear_pointer (&self->images, _gitlab_image_cache_free);
+	g_clear_pointer (&self->flights, _gitlab_single_flight_free);
+	g_free (self->version);
+	g_free (self->revision);
+	g_mutex_clear (&self->version_lock);
+	g_hash_table_unref (self->syncs);
+	g_mutex_clear (&self->sync_lock);
+	g_mutex_clear (&self->stats_lock);
+
 	G_OBJECT_CLASS (gitlab_client_parent_class)->finalize (object);
 }
 
@@ -80,6 +167,33 @@ gitlab_client_get_property (GObject    *object,
 		case PROP_TOKEN:
 			g_value_set_string (value, self->token);
 			break;
+		case PROP_MAX_CONNECTIONS:
+			g_value_set_int (value, self->max_connections);
+			break;
+		case PROP_MAX_CONNECTIONS_PER_HOST:
+			g_value_set_int (value, self->max_connections_per_host);
+			break;
+		case PROP_IDLE_TIMEOUT:
+			g_value_set_uint (value, self->idle_timeout);
+			break;
+		case PROP_MAX_REQUESTS_IN_FLIGHT:
+			g_value_set_uint (value, self->max_requests_in_flight);
+			break;
+		case PROP_MAX_PAGES_IN_FLIGHT:
+			g_value_set_uint (value, self->max_pages_in_flight);
+			break;
+		case PROP_MAX_PROJECTS_IN_FLIGHT:
+			g_value_set_uint (value, self->max_projects_in_flight);
+			break;
+		case PROP_DISK_CACHE:
+			g_value_set_boolean (value, self->disk_cache);
+			break;
+		case PROP_INTERN_STRINGS:
+			g_value_set_boolean (value, self->intern_strings);
+			break;
+		case PROP_LAZY_PROJECTS:
+			g_value_set_boolean (value, self->lazy_projects);
+			break;
 	  default:
 	    G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 	  }
@@ -101,16 +215,73 @@ gitlab_client_set_property (GObject      *object,
 		case PROP_TOKEN:
 			self->token = g_value_dup_string (value);
 			break;
+		case PROP_MAX_CONNECTIONS:
+			self->max_connections = g_value_get_int (value);
+			if (self->session != NULL)
+				g_object_set (self->session, "max-conns", self->max_connections, NULL);
+			break;
+		case PROP_MAX_CONNECTIONS_PER_HOST:
+			self->max_connections_per_host = g_value_get_int (value);
+			if (self->session != NULL)
+				g_object_set (self->session, "max-conns-per-host", self->max_connections_per_host, NULL);
+			break;
+		case PROP_IDLE_TIMEOUT:
+			self->idle_timeout = g_value_get_uint (value);
+			if (self->session != NULL)
+				g_object_set (self->session, "idle-timeout", self->idle_timeout, NULL);
+			break;
+		case PROP_MAX_REQUESTS_IN_FLIGHT:
+			self->max_requests_in_flight = g_value_get_uint (value);
+			if (self->scheduler != NULL)
+				_gitlab_scheduler_set_max_in_flight (self->scheduler, self->max_requests_in_flight);
+			break;
+		case PROP_MAX_PAGES_IN_FLIGHT:
+			self->max_pages_in_flight = g_value_get_uint (value);
+			break;
+		case PROP_MAX_PROJECTS_IN_FLIGHT:
+			self->max_projects_in_flight = g_value_get_uint (value);
+			break;
+		case PROP_DISK_CACHE:
+			self->disk_cache = g_value_get_boolean (value);
+			break;
+		case PROP_INTERN_STRINGS:
+			self->intern_strings = g_value_get_boolean (value);
+			break;
+		case PROP_LAZY_PROJECTS:
+			self->lazy_projects = g_value_get_boolean (value);
+			break;
 	  default:
 	    G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 	  }
 }
 
+static void
+gitlab_client_constructed (GObject *object)
+{
+	GitlabClient *self = (GitlabClient *)object;
+
+	/*
+	 * One session for the lifetime of the client, so that TCP and TLS
+	 * connections to the instance are kept alive and reused between pages
+	 * and calls instead of being handshaked again for every request. The
+	 * SoupContentDecoder the session comes with asks for gzip and deflate,
+	 * so listings travel compressed.
+	 */
+	self->session = soup_session_new_with_options ("max-conns", self->max_connections,
+	                                               "max-conns-per-host", self->max_connections_per_host,
+	                                               "idle-timeout", self->idle_timeout,
+	                                               NULL);
+	self->scheduler = _gitlab_scheduler_new (self->session, self->max_requests_in_flight);
+
+	G_OBJECT_CLASS (gitlab_client_parent_class)->constructed (object);
+}
+
 static void
 gitlab_client_class_init (GitlabClientClass *klass)
 {
 	GObjectClass *object_class = G_OBJECT_CLASS (klass);
 
+	object_class->constructed = gitlab_client_constructed;
 	object_class->finalize = gitlab_client_finalize;
 	object_class->get_property = gitlab_client_get_property;
 	object_class->set_property = gitlab_client_set_property;
@@ -129,238 +300,3185 @@ gitlab_client_class_init (GitlabClientClass *klass)
 												 "",
 												 G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
 
+	properties[PROP_MAX_CONNECTIONS] =
+		g_param_spec_int ("max-connections",
+											"Max-connections",
+											"The maximum number of open connections in the pool",
+											1, G_MAXINT, 20,
+											G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS);
+
+	properties[PROP_MAX_CONNECTIONS_PER_HOST] =
+		g_param_spec_int ("max-connections-per-host",
+											"Max-connections-per-host",
+											"The maximum number of open connections to the gitlab instance",
+											1, G_MAXINT, 6,
+											G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS);
+
+	properties[PROP_IDLE_TIMEOUT] =
+		g_param_spec_uint ("idle-timeout",
+											 "Idle-timeout",
+											 "Seconds an idle keep-alive connection stays open, 0 for no timeout",
+											 0, G_MAXUINT, 60,
+											 G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS);
+
+	properties[PROP_MAX_REQUESTS_IN_FLIGHT] =
+		g_param_spec_uint ("max-requests-in-flight",
+											 "Max-requests-in-flight",
+											 "The upper bound of concurrent requests, lowered automatically near the rate limit",
+											 1, G_MAXUINT, 8,
+											 G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS);
+
+	properties[PROP_MAX_PAGES_IN_FLIGHT] =
+		g_param_spec_uint ("max-pages-in-flight",
+											 "Max-pages-in-flight",
+											 "The maximum number of pages of one listing requested concurrently",
+											 1, G_MAXUINT, 4,
+											 G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS);
+
+	properties[PROP_MAX_PROJECTS_IN_FLIGHT] =
+		g_param_spec_uint ("max-projects-in-flight",
+											 "Max-projects-in-flight",
+											 "The maximum number of projects loaded concurrently by batch calls",
+											 1, G_MAXUINT, 4,
+											 G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS);
+
+	properties[PROP_DISK_CACHE] =
+		g_param_spec_boolean ("disk-cache",
+													"Disk-cache",
+													"Whether project listings are persisted in the user cache dir",
+													FALSE,
+													G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+	/*
+	 * Lazy projects decode each member on its own and never use the arena,
+	 * so intern-strings has no effect while lazy-projects is set.
+	 */
+	properties[PROP_INTERN_STRINGS] =
+		g_param_spec_boolean ("intern-strings",
+													"Intern-strings",
+													"Whether objects of one response share a string arena, ignored for lazy projects",
+													FALSE,
+													G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+	properties[PROP_LAZY_PROJECTS] =
+		g_param_spec_boolean ("lazy-projects",
+													"Lazy-projects",
+													"Whether listed projects decode their members on first access",
+													FALSE,
+													G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
 	g_object_class_install_properties (object_class, N_PROPS, properties);
+
+	/**
+	 * GitlabClient::projects-updated:
+	 * @self: a #GitlabClient
+	 * @projects: (element-type GitlabProject): the fresh listing
+	 *
+	 * Emitted when gitlab_client_query_projects_async() answered from the
+	 * disk cache and the listing was revalidated with the server in the
+	 * background.
+	 */
+	signals [PROJECTS_UPDATED] =
+		g_signal_new ("projects-updated",
+		              G_TYPE_FROM_CLASS (klass),
+		              G_SIGNAL_RUN_LAST,
+		              0, NULL, NULL, NULL,
+		              G_TYPE_NONE, 1, G_TYPE_POINTER);
+
+	/**
+	 * GitlabClient::request-finished:
+	 * @self: a #GitlabClient
+	 * @stats: the stats of the request, only valid during the emission,
+	 *   see gitlab_request_stats_copy()
+	 *
+	 * Emitted in the main context of the caller whenever a request to the
+	 * server finished, successful or not.
+	 */
+	signals [REQUEST_FINISHED] =
+		g_signal_new ("request-finished",
+		              G_TYPE_FROM_CLASS (klass),
+		              G_SIGNAL_RUN_LAST,
+		              0, NULL, NULL, NULL,
+		              G_TYPE_NONE, 1, GITLAB_TYPE_REQUEST_STATS | G_SIGNAL_TYPE_STATIC_SCOPE);
 }
 
 static void
 gitlab_client_init (GitlabClient *self)
 {
+	self->response_cache = _gitlab_response_cache_new (GITLAB_CLIENT_RESPONSE_CACHE_ITEMS);
+	self->images = _gitlab_image_cache_new (GITLAB_CLIENT_IMAGE_CACHE_SIZE);
+	self->flights = _gitlab_single_flight_new ();
+	g_mutex_init (&self->version_lock);
+	g_mutex_init (&self->sync_lock);
+	g_mutex_init (&self->stats_lock);
+	self->syncs = g_hash_table_new_full (g_str_hash, g_str_equal,
+	                                     g_free, (GDestroyNotify) _gitlab_sync_state_free);
 }
 
-void
-gitlab_client_get_version (GitlabClient  *self,
-                           const gchar        **version,
-                           const gchar        **revision)
+static GPtrArray *
+gitlab_client_parse_projects (GitlabClient  *self,
+                              GBytes        *bytes,
+                              GError       **error)
 {
-	GError *error = NULL;
-	g_autoptr (SoupSession) session = soup_session_new ();
+	g_autoptr(GPtrArray) projects = NULL;
+	g_autoptr(GitlabStringPool) pool = NULL;
+	g_autoptr(GString) scratch = NULL;
+	GitlabJsonScanner scanner;
+	GitlabJsonToken token;
+	gsize length;
 
-	gchar *url = g_strconcat (self->baseurl, "/version", NULL);
-	SoupMessage *msg = soup_message_new ("GET", url);
-	g_free (url);
+	_gitlab_json_scanner_init (&scanner, g_bytes_get_data (bytes, &length), length);
+	if (_gitlab_json_scanner_next (&scanner) != GITLAB_JSON_TOKEN_BEGIN_ARRAY) {
+		g_set_error (error, GITLAB_ERROR, GITLAB_ERROR_PARSE, "Expected an array of projects");
+		return NULL;
+	}
 
-	soup_message_headers_append (msg->request_headers, "PRIVATE-TOKEN", self->token);
+	/* intern-strings is ignored for lazy projects, see the property */
+	if (self->intern_strings && !self->lazy_projects) {
+		pool = _gitlab_string_pool_new ();
+		scratch = g_string_new (NULL);
+	}
 
-	soup_session_send_message (session, msg);
+	projects = g_ptr_array_new_with_free_func (g_object_unref);
+	while ((token = _gitlab_json_scanner_next (&scanner)) == GITLAB_JSON_TOKEN_BEGIN_OBJECT) {
+		GitlabProject *project;
 
-	JsonParser *parser = json_parser_new ();
-	json_parser_load_from_data (parser, msg->response_body->data, msg->response_body->length, &error);
-	JsonNode *root = json_parser_get_root (parser);
-	JsonObject *object = json_node_get_object (root);
-	*version = json_object_get_string_member (object, "version");
-	*revision = json_object_get_string_member (object, "revision");
+		if (self->lazy_projects)
+			project = _gitlab_project_new_lazy (&scanner, bytes, error);
+		else
+			project = _gitlab_project_new_from_scanner (&scanner, pool, scratch, error);
+
+		if (project == NULL)
+			return NULL;
+		g_ptr_array_add (projects, project);
+	}
+
+	if (token != GITLAB_JSON_TOKEN_END_ARRAY) {
+		g_set_error (error, GITLAB_ERROR, GITLAB_ERROR_PARSE, "Malformed array of projects");
+		return NULL;
+	}
+
+	return g_steal_pointer (&projects);
 }
 
-static GList *
-gitlab_client_parse_projects (GInputStream *stream,
-                              GCancellable *cancellable,
-                              GError       *error)
+SoupSession *
+_gitlab_client_get_session (GitlabClient *self)
 {
-	GList *list = NULL;
-	JsonParser *parser = json_parser_new ();
+	g_assert (GITLAB_IS_CLIENT (self));
+
+	return self->session;
+}
+
+GitlabScheduler *
+_gitlab_client_get_scheduler (GitlabClient *self)
+{
+	g_assert (GITLAB_IS_CLIENT (self));
 
-	json_parser_load_from_stream (parser, stream, cancellable, &error);
-	JsonNode *root = json_parser_get_root (parser);
+	return self->scheduler;
+}
 
-	JsonArray *array = json_node_get_array (root);
-	for (int i = 0; i < json_array_get_length (array); i++) {
-		JsonNode *node = json_array_get_element (array, i);
+guint
+_gitlab_client_get_max_pages_in_flight (GitlabClient *self)
+{
+	g_assert (GITLAB_IS_CLIENT (self));
 
-		GitlabProject *p = gitlab_project_new_from_node (node);
-		list = g_list_append (list, p);
-	}
+	return self->max_pages_in_flight;
+}
+
+GitlabResponseCache *
+_gitlab_client_get_response_cache (GitlabClient *self)
+{
+	g_assert (GITLAB_IS_CLIENT (self));
+
+	return self->response_cache;
+}
+
+/*
+ * Responses differ between users, so the token is part of the key. Only a
+ * digest of it is kept around.
+ */
+gchar *
+_gitlab_client_get_cache_key (GitlabClient *self,
+                              const gchar  *url)
+{
+	g_autofree gchar *digest = NULL;
+
+	g_assert (GITLAB_IS_CLIENT (self));
+
+	digest = g_compute_checksum_for_string (G_CHECKSUM_SHA256, self->token ? self->token : "", -1);
+
+	return g_strconcat (digest, " ", url, NULL);
+}
+
+/**
+ * gitlab_client_get_cache_hits:
+ * @self: a #GitlabClient
+ *
+ * Returns: the number of responses that were revalidated with the server
+ * and served from the response cache without being downloaded again
+ */
+guint
+gitlab_client_get_cache_hits (GitlabClient *self)
+{
+	g_assert (GITLAB_IS_CLIENT (self));
+
+	return _gitlab_response_cache_get_hits (self->response_cache);
+}
+
+/**
+ * gitlab_client_get_cache_misses:
+ * @self: a #GitlabClient
+ *
+ * Returns: the number of responses that had to be downloaded and parsed
+ */
+guint
+gitlab_client_get_cache_misses (GitlabClient *self)
+{
+	g_assert (GITLAB_IS_CLIENT (self));
+
+	return _gitlab_response_cache_get_misses (self->response_cache);
+}
+
+/**
+ * gitlab_client_clear_cache:
+ * @self: a #GitlabClient
+ *
+ * Drops all cached responses. The next request of every listing downloads
+ * it completely again.
+ */
+void
+gitlab_client_clear_cache (GitlabClient *self)
+{
+	g_assert (GITLAB_IS_CLIENT (self));
 
-	g_object_unref (parser);
-	return list;
+	_gitlab_response_cache_clear (self->response_cache);
+	_gitlab_image_cache_clear (self->images);
 }
 
-static SoupMessage*
-gitlab_client_auth_message (GitlabClient *self,
-                            gchar        *url)
+SoupMessage *
+_gitlab_client_auth_message (GitlabClient *self,
+                             const gchar  *url)
 {
 	SoupMessage *msg = soup_message_new ("GET", url);
 	soup_message_headers_append (msg->request_headers, "PRIVATE-TOKEN", self->token);
 	return msg;
 }
 
+typedef struct
+{
+	GitlabClient       *client;
+	GitlabRequestTrace *trace;
+	gboolean            reported;
+} GitlabClientSend;
+
 static void
-gitlab_client_get_projects_cb (GTask        *task,
-                               gpointer      source_object,
-                               gpointer      task_data,
-                               GCancellable *cancellable)
+gitlab_client_send_report (GitlabClientSend *send)
 {
-	g_autoptr(GInputStream) stream = NULL;
-	g_autoptr(SoupSession) session = soup_session_new ();
+	if (send->reported)
+		return;
+
+	send->reported = TRUE;
+	_gitlab_client_report (send->client, send->trace);
+}
+
+/* Callers that do not parse the body are reported once they are done */
+static void
+gitlab_client_send_free (gpointer data)
+{
+	GitlabClientSend *send = data;
+
+	gitlab_client_send_report (send);
+	g_object_unref (send->client);
+	_gitlab_request_trace_free (send->trace);
+	g_free (send);
+}
+
+static void
+gitlab_client_send_read_cb (GObject      *object,
+                            GAsyncResult *result,
+                            gpointer      user_data)
+{
+	g_autoptr(GTask) task = user_data;
+	GitlabClientSend *send = g_task_get_task_data (task);
+	GBytes *bytes;
 	GError *error = NULL;
-	GList *list = NULL;
 
-	g_assert (GITLAB_IS_CLIENT (source_object));
-	g_assert (!cancellable || G_IS_CANCELLABLE (cancellable));
+	if (g_output_stream_splice_finish (G_OUTPUT_STREAM (object), result, &error) < 0) {
+		gitlab_client_send_report (send);
+		g_task_return_error (task, error);
+		return;
+	}
+
+	bytes = g_memory_output_stream_steal_as_bytes (G_MEMORY_OUTPUT_STREAM (object));
+	_gitlab_request_trace_read (send->trace, g_bytes_get_size (bytes));
+
+	g_task_return_pointer (task, bytes, (GDestroyNotify) g_bytes_unref);
+}
+
+static void
+gitlab_client_send_cb (GObject      *object,
+                       GAsyncResult *result,
+                       gpointer      user_data)
+{
+	g_autoptr(GTask) task = user_data;
+	GitlabClientSend *send = g_task_get_task_data (task);
+	SoupMessage *msg = _gitlab_request_trace_get_message (send->trace);
+	g_autoptr(GInputStream) stream = NULL;
+	g_autoptr(GOutputStream) body = NULL;
+	GError *error = NULL;
 
-	GitlabClient *self = GITLAB_CLIENT (source_object);
-	g_autofree gchar *url = g_strconcat (self->baseurl, "/groups/GNOME/projects", NULL);
-	SoupMessage *msg = gitlab_client_auth_message (self, url);
-	stream = soup_session_send (session, msg, cancellable, &error);
-	if (!stream && !g_input_stream_close (stream, cancellable, &error)) {
+	stream = _gitlab_scheduler_send_finish (GITLAB_SCHEDULER (object), result, &error);
+	if (stream == NULL) {
+		gitlab_client_send_report (send);
 		g_task_return_error (task, error);
-		g_object_unref (msg);
 		return;
 	}
 
-	const gchar *pages_str = soup_message_headers_get_one (msg->response_headers, "X-Total-Pages");
-	int pages = strtol (pages_str, NULL, 10);
-	g_object_unref (msg);
+	if (!SOUP_STATUS_IS_SUCCESSFUL (msg->status_code) &&
+	    msg->status_code != SOUP_STATUS_NOT_MODIFIED) {
+		g_autofree gchar *url = soup_uri_to_string (soup_message_get_uri (msg), FALSE);
 
-	for (int i = 1; i <= pages; i++)
-	  {
-			char p[3];
-			g_snprintf (p, 3, "%d", i);
-			url = g_strconcat (self->baseurl, "/groups/GNOME/projects", "?page=", p, NULL);
-
-			msg = gitlab_client_auth_message (self, url);
-			stream = soup_session_send (session, msg, cancellable, &error);
-			if (!stream) {
-				g_task_return_error (task, error);
-				return;
-			}
-			GList *more = gitlab_client_parse_projects (stream, cancellable, error);
-			if (!g_input_stream_close (stream, cancellable, &error)) {
-				g_task_return_error (task, error);
-				return;
-			}
-			g_object_unref (msg);
-
-			if (list == NULL) {
-				list = more;
-			} else {
-				list = g_list_concat (list, more);
-			}
-	  }
+		gitlab_client_send_report (send);
+		g_task_return_new_error (task, GITLAB_ERROR, GITLAB_ERROR_HTTP,
+		                         "%s: %u %s", url, msg->status_code, msg->reason_phrase);
+		return;
+	}
 
-	g_task_return_pointer (task, list, NULL);
+	body = g_memory_output_stream_new_resizable ();
+	g_output_stream_splice_async (body,
+	                              stream,
+	                              G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE | G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET,
+	                              G_PRIORITY_DEFAULT,
+	                              g_task_get_cancellable (task),
+	                              gitlab_client_send_read_cb,
+	                              g_object_ref (task));
 }
 
-/**
- * gitlab_client_get_projects_async:
- * @self: a #GitlabClient
- * @callback: the callback for the async operation
- * @cancellable: (nullable): a #Gcancellable, or %NULL
- * @user_data: user defined parameter
- *
- * Asynchronously loads all projects, which are not forked from other projects
- *
- * See also: gitlab_client_get_projects_finish()
+/*
+ * Sends @msg through the scheduler and reads the whole body without
+ * blocking. A status other than 2xx or 304 completes with
+ * %GITLAB_ERROR_HTTP; the headers stay available on @msg. Callers that
+ * parse the body report the request with _gitlab_client_send_parsed(),
+ * the others are reported once they dropped the result.
  */
 void
-gitlab_client_get_projects_async (GitlabClient        *self,
-                                  GAsyncReadyCallback  callback,
-                                  GCancellable        *cancellable,
-                                  gpointer             user_data)
+_gitlab_client_send_async (GitlabClient        *self,
+                           SoupMessage         *msg,
+                           GCancellable        *cancellable,
+                           GAsyncReadyCallback  callback,
+                           gpointer             user_data)
 {
-	g_autoptr (GTask) task = NULL;
+	g_autoptr(GTask) task = NULL;
+	GitlabClientSend *send;
 
 	g_assert (GITLAB_IS_CLIENT (self));
-	g_assert (!cancellable || G_IS_CANCELLABLE (cancellable));
+	g_assert (SOUP_IS_MESSAGE (msg));
+
+	send = g_new0 (GitlabClientSend, 1);
+	send->client = g_object_ref (self);
+	send->trace = _gitlab_request_trace_new (msg);
 
 	task = g_task_new (self, cancellable, callback, user_data);
+	g_task_set_source_tag (task, _gitlab_client_send_async);
+	g_task_set_task_data (task, send, gitlab_client_send_free);
 
-	g_task_run_in_thread (task, gitlab_client_get_projects_cb);
+	_gitlab_scheduler_send_async (self->scheduler,
+	                              msg,
+	                              cancellable,
+	                              gitlab_client_send_cb,
+	                              g_steal_pointer (&task));
 }
 
-GList *
-gitlab_client_get_projects_finish (GitlabClient *self,
-                                   GAsyncResult  *res,
-                                   GError        **error)
+GBytes *
+_gitlab_client_send_finish (GitlabClient  *self,
+                            GAsyncResult  *result,
+                            GError       **error)
 {
 	g_assert (GITLAB_IS_CLIENT (self));
-	g_assert (G_IS_TASK (res));
+	g_assert (g_task_is_valid (result, self));
+
+	return g_task_propagate_pointer (G_TASK (result), error);
+}
+
+/*
+ * Marks the end of parsing the body of @result into @items objects and
+ * reports the request.
+ */
+void
+_gitlab_client_send_parsed (GitlabClient *self,
+                            GAsyncResult *result,
+                            guint         items)
+{
+	GitlabClientSend *send;
+
+	g_assert (GITLAB_IS_CLIENT (self));
+	g_assert (g_task_is_valid (result, self));
+
+	send = g_task_get_task_data (G_TASK (result));
+	_gitlab_request_trace_parsed (send->trace, items);
+	gitlab_client_send_report (send);
+}
+
+static gboolean
+gitlab_client_parse_version (GBytes  *bytes,
+                             gchar  **version,
+                             gchar  **revision,
+                             GError **error)
+{
+	g_autofree gchar *parsed_version = NULL;
+	g_autofree gchar *parsed_revision = NULL;
+	GitlabJsonScanner scanner;
+	GitlabJsonToken token;
+	gsize length;
+
+	_gitlab_json_scanner_init (&scanner, g_bytes_get_data (bytes, &length), length);
+	if (_gitlab_json_scanner_next (&scanner) != GITLAB_JSON_TOKEN_BEGIN_OBJECT) {
+		g_set_error (error, GITLAB_ERROR, GITLAB_ERROR_PARSE, "Expected a version object");
+		return FALSE;
+	}
+
+	while ((token = _gitlab_json_scanner_next (&scanner)) == GITLAB_JSON_TOKEN_STRING) {
+		gchar **field = NULL;
+
+		if (_gitlab_json_scanner_string_equal (&scanner, "version"))
+			field = &parsed_version;
+		else if (_gitlab_json_scanner_string_equal (&scanner, "revision"))
+			field = &parsed_revision;
+
+		token = _gitlab_json_scanner_next (&scanner);
+
+		if (field != NULL && token == GITLAB_JSON_TOKEN_STRING) {
+			g_free (*field);
+			*field = _gitlab_json_scanner_dup_string (&scanner);
+		} else if (!_gitlab_json_scanner_skip_value (&scanner, token)) {
+			token = GITLAB_JSON_TOKEN_ERROR;
+			break;
+		}
+	}
+
+	if (token != GITLAB_JSON_TOKEN_END_OBJECT || parsed_version == NULL) {
+		g_set_error (error, GITLAB_ERROR, GITLAB_ERROR_PARSE,
+		             "Malformed version at offset %" G_GSIZE_FORMAT ": %s",
+		             scanner.pos,
+		             scanner.error_message ? scanner.error_message : "Missing version member");
+		return FALSE;
+	}
+
+	*version = g_steal_pointer (&parsed_version);
+	*revision = g_steal_pointer (&parsed_revision);
+
+	return TRUE;
+}
+
+static GitlabCapabilities
+gitlab_client_capabilities_for_version (const gchar *version)
+{
+	GitlabCapabilities capabilities = GITLAB_CAPABILITY_NONE;
+	gchar *end;
+	guint64 major;
+	guint64 minor = 0;
+
+	major = g_ascii_strtoull (version, &end, 10);
+	if (end == version)
+		return capabilities;
+	if (*end == '.')
+		minor = g_ascii_strtoull (end + 1, NULL, 10);
 
-	return g_task_propagate_pointer (G_TASK(res), error);
+	/* GraphQL is enabled by default since 12.1 */
+	if (major > 12 || (major == 12 && minor >= 1))
+		capabilities |= GITLAB_CAPABILITY_GRAPHQL;
+
+	/* Keyset pagination of /projects was added in 13.0 */
+	if (major >= 13)
+		capabilities |= GITLAB_CAPABILITY_KEYSET_PAGINATION;
+
+	return capabilities;
+}
+
+/*
+ * Remembers the first version the server reported. The strings are owned
+ * by the client from then on, so callers may hand them out without copies.
+ */
+static void
+gitlab_client_set_version (GitlabClient *self,
+                           gchar        *version,
+                           gchar        *revision)
+{
+	g_mutex_lock (&self->version_lock);
+
+	if (self->version == NULL) {
+		self->version = version;
+		self->revision = revision;
+		self->capabilities = gitlab_client_capabilities_for_version (version);
+	} else {
+		g_free (version);
+		g_free (revision);
+	}
+
+	g_mutex_unlock (&self->version_lock);
+}
+
+static gboolean
+gitlab_client_lookup_version (GitlabClient  *self,
+                              const gchar  **version,
+                              const gchar  **revision)
+{
+	gboolean found;
+
+	g_mutex_lock (&self->version_lock);
+
+	found = self->version != NULL;
+	if (version != NULL)
+		*version = self->version;
+	if (revision != NULL)
+		*revision = self->revision;
+
+	g_mutex_unlock (&self->version_lock);
+
+	return found;
+}
+
+/**
+ * gitlab_client_get_version:
+ * @self: a #GitlabClient
+ * @version: (out) (transfer none) (nullable): the version of the server
+ * @revision: (out) (transfer none) (nullable): the revision of the server
+ *
+ * Blocks until the version of the server is known. The strings stay
+ * valid as long as @self. Prefer gitlab_client_get_version_async().
+ */
+void
+gitlab_client_get_version (GitlabClient  *self,
+                           const gchar  **version,
+                           const gchar  **revision)
+{
+	g_assert (GITLAB_IS_CLIENT (self));
+
+	if (!gitlab_client_lookup_version (self, NULL, NULL)) {
+		g_autofree gchar *url = g_strconcat (self->baseurl, "/version", NULL);
+		g_autoptr(SoupMessage) msg = _gitlab_client_auth_message (self, url);
+		g_autoptr(GBytes) bytes = NULL;
+		g_autoptr(GError) error = NULL;
+		gchar *parsed_version;
+		gchar *parsed_revision;
+
+		soup_session_send_message (self->session, msg);
+
+		bytes = g_bytes_new (msg->response_body->data, msg->response_body->length);
+		if (!SOUP_STATUS_IS_SUCCESSFUL (msg->status_code))
+			g_debug ("%s: %u %s", url, msg->status_code, msg->reason_phrase);
+		else if (!gitlab_client_parse_version (bytes, &parsed_version, &parsed_revision, &error))
+			g_debug ("%s", error->message);
+		else
+			gitlab_client_set_version (self, parsed_version, parsed_revision);
+	}
+
+	gitlab_client_lookup_version (self, version, revision);
 }
 
 static void
-gitlab_client_get_project_issues_cb (GTask        *task,
-                                     gpointer      source_object,
-                                     gpointer      task_data,
-                                     GCancellable *cancellable)
+gitlab_client_version_cb (GObject      *object,
+                          GAsyncResult *result,
+                          gpointer      user_data)
 {
-	g_autoptr (GInputStream) stream = NULL;
+	GitlabClient *self = GITLAB_CLIENT (object);
+	GitlabFlight *flight = user_data;
+	g_autoptr(GPtrArray) tasks = NULL;
+	g_autoptr(GBytes) bytes = NULL;
 	GError *error = NULL;
-	g_autoptr (SoupMessage) msg = NULL;
+	gchar *version;
+	gchar *revision;
 
-	g_assert (GITLAB_IS_CLIENT (source_object));
-	g_assert (!cancellable || G_IS_CANCELLABLE (cancellable));
-	g_assert (GITLAB_IS_PROJECT (task_data));
+	bytes = _gitlab_client_send_finish (self, result, &error);
+	if (bytes != NULL) {
+		if (gitlab_client_parse_version (bytes, &version, &revision, &error))
+			gitlab_client_set_version (self, version, revision);
+		_gitlab_client_send_parsed (self, result, error == NULL);
+	}
 
-	GitlabClient *self = GITLAB_CLIENT (source_object);
-	GitlabProject *project = GITLAB_PROJECT (task_data);
+	tasks = _gitlab_single_flight_land (self->flights, flight);
 
-	/*g_autofree gchar *url2 = g_strconcat (self->baseurl,
-																			 "/projects/",
-																			 gitlab_project_get_id(project),
-																			 "/issues",
-																			 NULL);*/
-	g_autofree gchar *url = g_strdup_printf ("%s/projects/%d/issues", self->baseurl, gitlab_project_get_id (project));
-	g_print ("URL: %s\n", url);
-	msg = gitlab_client_auth_message (self, url);
-	/* stream = soup_session_send (self->session, msg, cancellable, &error); */
-	/* if (!stream) { */
-	/* 	g_task_return_error (task, error); */
-	/* } */
+	for (guint i = 0; i < tasks->len; i++) {
+		GTask *task = g_ptr_array_index (tasks, i);
 
-	//soup_session_send_message (self->session, msg);
+		if (error != NULL)
+			g_task_return_error (task, g_error_copy (error));
+		else
+			g_task_return_boolean (task, TRUE);
+	}
 
-	g_print ("%s\n", msg->response_body->data);
+	g_clear_error (&error);
 }
 
 /**
- * gitlab_client_get_project_issues_async:
- * @self: A #GitlabClient
- * @project: A #GitlabProject
+ * gitlab_client_get_version_async:
+ * @self: a #GitlabClient
  * @callback: the callback for the async operation
- * @cancellable: (nullable): A #GCancellable, or %NULL
+ * @cancellable: (nullable): a #GCancellable, or %NULL
  * @user_data: user defined parameter
  *
- * Asynchronously loads all issues to a specific #GitlabProject
- *
- * See also: gitlab_client_get_project_issues_finish()
+ * Asks the server for its version. The answer is kept for the lifetime of
+ * @self, so only the first call goes to the network and concurrent first
+ * calls share one request.
  */
 void
-gitlab_client_get_project_issues_async (GitlabClient        *self,
-                                        GitlabProject       *project,
-                                        GAsyncReadyCallback  callback,
-                                        GCancellable        *cancellable,
-                                        gpointer             user_data)
+gitlab_client_get_version_async (GitlabClient        *self,
+                                 GAsyncReadyCallback  callback,
+                                 GCancellable        *cancellable,
+                                 gpointer             user_data)
 {
-	g_autoptr (GTask) task = NULL;
+	g_autoptr(GTask) task = NULL;
+	g_autoptr(SoupMessage) msg = NULL;
+	g_autofree gchar *url = NULL;
+	g_autofree gchar *cache_key = NULL;
+	g_autofree gchar *key = NULL;
+	GitlabFlight *flight;
 
 	g_assert (GITLAB_IS_CLIENT (self));
-	g_assert (GITLAB_IS_PROJECT (project));
-	g_assert (!cancellable || G_IS_CANCELLABLE (cancellable));
 
-	task = g_task_new (self, cancellable, callback, NULL);
-	g_task_set_task_data (task, project, g_object_unref);
+	task = g_task_new (self, cancellable, callback, user_data);
+	g_task_set_source_tag (task, gitlab_client_get_version_async);
 
-	g_task_run_in_thread (task, gitlab_client_get_project_issues_cb);
-}
+	if (gitlab_client_lookup_version (self, NULL, NULL)) {
+		g_task_return_boolean (task, TRUE);
+		return;
+	}
 
-GList *
-gitlab_client_get_project_issues_finish (GitlabClient  *self,
-                                         GAsyncResult  *res,
-                                         GError       **error)
-{
-	g_assert (GITLAB_IS_CLIENT (self));
-	g_assert (G_IS_TASK (res));
+	url = g_strconcat (self->baseurl, "/version", NULL);
+	cache_key = _gitlab_client_get_cache_key (self, url);
+	key = g_strconcat ("GET ", cache_key, NULL);
+	flight = _gitlab_single_flight_join (self->flights, key, task);
+	if (flight == NULL)
+		return;
 
-	return g_task_propagate_pointer (G_TASK (res), error);
+	msg = _gitlab_client_auth_message (self, url);
+	_gitlab_client_send_async (self,
+	                           msg,
+	                           _gitlab_flight_get_cancellable (flight),
+	                           gitlab_client_version_cb,
+	                           flight);
+}
+
+/**
+ * gitlab_client_get_version_finish:
+ * @self: a #GitlabClient
+ * @res: a #GAsyncResult
+ * @version: (out) (transfer none) (optional): the version of the server
+ * @revision: (out) (transfer none) (optional) (nullable): the revision of the server
+ * @error: a #GError
+ *
+ * The strings stay valid as long as @self.
+ *
+ * Returns: %TRUE if the version is known
+ */
+gboolean
+gitlab_client_get_version_finish (GitlabClient  *self,
+                                  GAsyncResult  *res,
+                                  const gchar  **version,
+                                  const gchar  **revision,
+                                  GError       **error)
+{
+	g_assert (GITLAB_IS_CLIENT (self));
+	g_assert (g_task_is_valid (res, self));
+
+	if (!g_task_propagate_boolean (G_TASK (res), error))
+		return FALSE;
+
+	return gitlab_client_lookup_version (self, version, revision);
+}
+
+/**
+ * gitlab_client_get_capabilities:
+ * @self: a #GitlabClient
+ *
+ * Returns: the features the server supports, derived from its version.
+ * %GITLAB_CAPABILITY_NONE until gitlab_client_get_version_async() finished.
+ */
+GitlabCapabilities
+gitlab_client_get_capabilities (GitlabClient *self)
+{
+	GitlabCapabilities capabilities;
+
+	g_assert (GITLAB_IS_CLIENT (self));
+
+	g_mutex_lock (&self->version_lock);
+	capabilities = self->capabilities;
+	g_mutex_unlock (&self->version_lock);
+
+	return capabilities;
+}
+
+typedef struct
+{
+	GitlabFlight *flight;
+	SoupMessage  *msg;
+	gchar        *url;
+	gchar        *path;
+	GBytes       *cached;
+	gchar        *etag;
+	gchar        *last_modified;
+} GitlabClientImage;
+
+static void
+gitlab_client_image_free (GitlabClientImage *image)
+{
+	g_object_unref (image->msg);
+	g_free (image->url);
+	g_free (image->path);
+	g_free (image->etag);
+	g_free (image->last_modified);
+	g_clear_pointer (&image->cached, g_bytes_unref);
+	g_free (image);
+}
+
+static void
+gitlab_client_image_cb (GObject      *object,
+                        GAsyncResult *result,
+                        gpointer      user_data)
+{
+	GitlabClient *self = GITLAB_CLIENT (object);
+	GitlabClientImage *image = user_data;
+	g_autoptr(GPtrArray) tasks = NULL;
+	g_autoptr(GBytes) bytes = NULL;
+	GError *error = NULL;
+
+	bytes = _gitlab_client_send_finish (self, result, &error);
+	if (bytes != NULL && image->msg->status_code == SOUP_STATUS_NOT_MODIFIED) {
+		g_bytes_unref (bytes);
+		bytes = g_steal_pointer (&image->cached);
+	} else if (bytes != NULL && image->path != NULL) {
+		_gitlab_disk_cache_save_image (image->path,
+		                               soup_message_headers_get_one (image->msg->response_headers, "ETag"),
+		                               soup_message_headers_get_one (image->msg->response_headers, "Last-Modified"),
+		                               bytes);
+	}
+
+	if (bytes != NULL)
+		_gitlab_image_cache_insert (self->images, image->url, bytes);
+
+	tasks = _gitlab_single_flight_land (self->flights, image->flight);
+
+	for (guint i = 0; i < tasks->len; i++) {
+		GTask *task = g_ptr_array_index (tasks, i);
+
+		if (error != NULL)
+			g_task_return_error (task, g_error_copy (error));
+		else
+			g_task_return_pointer (task, g_bytes_ref (bytes), (GDestroyNotify) g_bytes_unref);
+	}
+
+	g_clear_error (&error);
+	gitlab_client_image_free (image);
+}
+
+/*
+ * Images may live on another host than the api, which must not see the
+ * token.
+ */
+static gboolean
+gitlab_client_is_own_url (GitlabClient *self,
+                          SoupURI      *uri)
+{
+	g_autoptr(SoupURI) base = soup_uri_new (self->baseurl);
+
+	return base != NULL && soup_uri_host_equal (base, uri);
+}
+
+static void
+gitlab_client_image_send (GitlabClient      *self,
+                          GitlabClientImage *image)
+{
+	if (image->cached != NULL && image->etag != NULL)
+		soup_message_headers_append (image->msg->request_headers, "If-None-Match", image->etag);
+	if (image->cached != NULL && image->last_modified != NULL)
+		soup_message_headers_append (image->msg->request_headers, "If-Modified-Since", image->last_modified);
+
+	_gitlab_client_send_async (self,
+	                           image->msg,
+	                           _gitlab_flight_get_cancellable (image->flight),
+	                           gitlab_client_image_cb,
+	                           image);
+}
+
+static void
+gitlab_client_image_read_thread (GTask        *task,
+                                 gpointer      source_object,
+                                 gpointer      task_data,
+                                 GCancellable *cancellable)
+{
+	GitlabClientImage *image = task_data;
+
+	image->cached = _gitlab_disk_cache_load_image (image->path,
+	                                               &image->etag,
+	                                               &image->last_modified,
+	                                               NULL);
+	g_task_return_boolean (task, TRUE);
+}
+
+static void
+gitlab_client_image_read_cb (GObject      *object,
+                             GAsyncResult *result,
+                             gpointer      user_data)
+{
+	gitlab_client_image_send (GITLAB_CLIENT (object), user_data);
+}
+
+/*
+ * Loads the image at @url. Images are looked up in memory first, then
+ * read from disk in a thread and requested with the validators of that
+ * copy, so an unchanged image costs one 304. Concurrent loads of the same
+ * url share one request.
+ */
+void
+_gitlab_client_load_image_async (GitlabClient        *self,
+                                 const gchar         *url,
+                                 GCancellable        *cancellable,
+                                 GAsyncReadyCallback  callback,
+                                 gpointer             user_data)
+{
+	g_autoptr(GTask) task = NULL;
+	g_autofree gchar *cache_key = NULL;
+	g_autofree gchar *key = NULL;
+	g_autoptr(GTask) read = NULL;
+	GitlabClientImage *image;
+	GitlabFlight *flight;
+	GBytes *bytes;
+
+	g_assert (GITLAB_IS_CLIENT (self));
+	g_assert (url != NULL);
+
+	task = g_task_new (self, cancellable, callback, user_data);
+	g_task_set_source_tag (task, _gitlab_client_load_image_async);
+
+	bytes = _gitlab_image_cache_lookup (self->images, url);
+	if (bytes != NULL) {
+		g_task_return_pointer (task, bytes, (GDestroyNotify) g_bytes_unref);
+		return;
+	}
+
+	cache_key = _gitlab_client_get_cache_key (self, url);
+	key = g_strconcat ("IMAGE ", cache_key, NULL);
+	flight = _gitlab_single_flight_join (self->flights, key, task);
+	if (flight == NULL)
+		return;
+
+	image = g_new0 (GitlabClientImage, 1);
+	image->flight = flight;
+	image->url = g_strdup (url);
+	image->msg = soup_message_new ("GET", url);
+	if (image->msg == NULL) {
+		g_autoptr(GPtrArray) tasks = _gitlab_single_flight_land (self->flights, flight);
+
+		for (guint i = 0; i < tasks->len; i++)
+			g_task_return_new_error (g_ptr_array_index (tasks, i),
+			                         G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+			                         "Invalid image url %s", url);
+		g_free (image->url);
+		g_free (image);
+		return;
+	}
+
+	if (self->token != NULL && gitlab_client_is_own_url (self, soup_message_get_uri (image->msg)))
+		soup_message_headers_append (image->msg->request_headers, "PRIVATE-TOKEN", self->token);
+
+	if (!self->disk_cache) {
+		gitlab_client_image_send (self, image);
+		return;
+	}
+
+	/* Once per client, so the images of earlier runs do not pile up */
+	if (g_atomic_int_compare_and_exchange (&self->images_pruned, FALSE, TRUE))
+		_gitlab_disk_cache_prune_images (GITLAB_CLIENT_IMAGE_DISK_CACHE_SIZE);
+
+	image->path = _gitlab_disk_cache_get_image_path (key);
+
+	read = g_task_new (self, NULL, gitlab_client_image_read_cb, image);
+	g_task_set_source_tag (read, gitlab_client_image_read_thread);
+	g_task_set_task_data (read, image, NULL);
+	g_task_run_in_thread (read, gitlab_client_image_read_thread);
+}
+
+GBytes *
+_gitlab_client_load_image_finish (GitlabClient  *self,
+                                  GAsyncResult  *result,
+                                  GError       **error)
+{
+	g_assert (GITLAB_IS_CLIENT (self));
+	g_assert (g_task_is_valid (result, self));
+
+	return g_task_propagate_pointer (G_TASK (result), error);
+}
+
+static void
+gitlab_client_free_objects (gpointer data)
+{
+	g_list_free_full (data, g_object_unref);
+}
+
+static void
+gitlab_client_list_cb (GObject      *object,
+                       GAsyncResult *result,
+                       gpointer      user_data)
+{
+	GitlabClient *self = GITLAB_CLIENT (object);
+	GitlabFlight *flight = user_data;
+	g_autoptr(GPtrArray) tasks = NULL;
+	GError *error = NULL;
+	GList *list;
+
+	list = g_task_propagate_pointer (G_TASK (result), &error);
+	tasks = _gitlab_single_flight_land (self->flights, flight);
+
+	for (guint i = 0; i < tasks->len; i++) {
+		GTask *task = g_ptr_array_index (tasks, i);
+
+		if (error != NULL)
+			g_task_return_error (task, g_error_copy (error));
+		else
+			g_task_return_pointer (task,
+			                       g_list_copy_deep (list, (GCopyFunc) g_object_ref, NULL),
+			                       gitlab_client_free_objects);
+	}
+
+	g_clear_error (&error);
+	gitlab_client_free_objects (list);
+}
+
+/*
+ * Loads all pages of @url into a #GList returned by @task. Identical
+ * listings that are requested while one is in flight share its requests
+ * and parsing.
+ */
+static void
+gitlab_client_list_async (GitlabClient         *self,
+                          GTask                *task,
+                          const gchar          *url,
+                          GitlabPagerFlags      flags,
+                          GitlabPagerParseFunc  parse_func)
+{
+	g_autofree gchar *cache_key = NULL;
+	g_autofree gchar *key = NULL;
+	g_autoptr(GTask) fetch = NULL;
+	GitlabFlight *flight;
+
+	cache_key = _gitlab_client_get_cache_key (self, url);
+	key = g_strconcat ("GET ", cache_key, NULL);
+	flight = _gitlab_single_flight_join (self->flights, key, task);
+	if (flight == NULL)
+		return;
+
+	fetch = g_task_new (self, _gitlab_flight_get_cancellable (flight), gitlab_client_list_cb, flight);
+	_gitlab_pager_run (fetch, url, flags, parse_func, NULL, NULL);
+}
+
+typedef struct
+{
+	gchar *path;
+	gchar *url;
+	GList *cached;
+	GTask *task;
+} GitlabClientRefresh;
+
+static void
+gitlab_client_refresh_projects_cb (GObject      *object,
+                                   GAsyncResult *result,
+                                   gpointer      user_data)
+{
+	GitlabClient *self = GITLAB_CLIENT (object);
+	GitlabClientRefresh *refresh = user_data;
+	GError *error = NULL;
+	GList *projects;
+
+	projects = g_task_propagate_pointer (G_TASK (result), &error);
+
+	if (error != NULL) {
+		if (refresh->task != NULL) {
+			g_task_return_error (refresh->task, error);
+		} else {
+			g_debug ("Failed to revalidate projects: %s", error->message);
+			g_error_free (error);
+		}
+	} else {
+		_gitlab_disk_cache_save_projects (refresh->path, projects);
+
+		if (refresh->task != NULL) {
+			g_task_return_pointer (refresh->task, projects, gitlab_client_free_objects);
+		} else {
+			g_signal_emit (self, signals [PROJECTS_UPDATED], 0, projects);
+			gitlab_client_free_objects (projects);
+		}
+	}
+
+	g_clear_object (&refresh->task);
+	g_free (refresh->path);
+	g_free (refresh->url);
+	g_free (refresh);
+}
+
+static void
+gitlab_client_refresh_read_thread (GTask        *task,
+                                   gpointer      source_object,
+                                   gpointer      task_data,
+                                   GCancellable *cancellable)
+{
+	GitlabClientRefresh *refresh = task_data;
+
+	refresh->cached = _gitlab_disk_cache_load_projects (refresh->path, NULL);
+	g_task_return_boolean (task, TRUE);
+}
+
+/*
+ * Answers from the listing read from disk, if there was one, and
+ * revalidates it with the server in the background.
+ */
+static void
+gitlab_client_refresh_read_cb (GObject      *object,
+                               GAsyncResult *result,
+                               gpointer      user_data)
+{
+	GitlabClient *self = GITLAB_CLIENT (object);
+	GitlabClientRefresh *refresh = user_data;
+	g_autoptr(GTask) refresh_task = NULL;
+	GCancellable *cancellable = NULL;
+
+	if (refresh->cached != NULL) {
+		g_task_return_pointer (refresh->task,
+		                       g_steal_pointer (&refresh->cached),
+		                       gitlab_client_free_objects);
+		g_clear_object (&refresh->task);
+	} else {
+		cancellable = g_task_get_cancellable (refresh->task);
+	}
+
+	refresh_task = g_task_new (self, cancellable, gitlab_client_refresh_projects_cb, refresh);
+	gitlab_client_list_async (self, refresh_task, refresh->url, GITLAB_PAGER_NONE, gitlab_client_parse_projects);
+}
+
+static gchar *
+gitlab_client_get_projects_url (GitlabClient       *self,
+                                GitlabProjectQuery *query)
+{
+	return _gitlab_project_query_to_url (query, self->baseurl);
+}
+
+/**
+ * gitlab_client_query_projects_async:
+ * @self: a #GitlabClient
+ * @query: a #GitlabProjectQuery. A new query matches every project the
+ *   token can see, which on a public instance is all of them.
+ * @callback: the callback for the async operation
+ * @cancellable: (nullable): a #Gcancellable, or %NULL
+ * @user_data: user defined parameter
+ *
+ * Asynchronously loads all projects matching @query. Numbered pages after
+ * the first one are requested concurrently, see
+ * #GitlabClient:max-pages-in-flight, keyset pages follow each other.
+ * Calls made while an identical one is in flight share its requests.
+ *
+ * With #GitlabClient:disk-cache set, the listing of the last run is
+ * returned right away and revalidated in the background, see
+ * #GitlabClient::projects-updated.
+ *
+ * See also: gitlab_client_query_projects_finish()
+ */
+void
+gitlab_client_query_projects_async (GitlabClient        *self,
+                                    GitlabProjectQuery  *query,
+                                    GAsyncReadyCallback  callback,
+                                    GCancellable        *cancellable,
+                                    gpointer             user_data)
+{
+	g_autoptr (GTask) task = NULL;
+	g_autoptr (GTask) read = NULL;
+	g_autofree gchar *url = NULL;
+	g_autofree gchar *key = NULL;
+	GitlabClientRefresh *refresh;
+
+	g_assert (GITLAB_IS_CLIENT (self));
+	g_assert (GITLAB_IS_PROJECT_QUERY (query));
+	g_assert (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+	task = g_task_new (self, cancellable, callback, user_data);
+	g_task_set_source_tag (task, gitlab_client_query_projects_async);
+
+	url = gitlab_client_get_projects_url (self, query);
+
+	if (!self->disk_cache) {
+		gitlab_client_list_async (self, task, url, GITLAB_PAGER_NONE, gitlab_client_parse_projects);
+		return;
+	}
+
+	key = _gitlab_client_get_cache_key (self, url);
+	refresh = g_new0 (GitlabClientRefresh, 1);
+	refresh->path = _gitlab_disk_cache_get_path (key);
+	refresh->url = g_steal_pointer (&url);
+	refresh->task = g_object_ref (task);
+
+	/* The cache dir may be on a slow or remote file system */
+	read = g_task_new (self, NULL, gitlab_client_refresh_read_cb, refresh);
+	g_task_set_task_data (read, refresh, NULL);
+	g_task_run_in_thread (read, gitlab_client_refresh_read_thread);
+}
+
+GList *
+gitlab_client_query_projects_finish (GitlabClient  *self,
+                                     GAsyncResult  *res,
+                                     GError       **error)
+{
+	g_assert (GITLAB_IS_CLIENT (self));
+	g_assert (G_IS_TASK (res));
+
+	return g_task_propagate_pointer (G_TASK (res), error);
+}
+
+/**
+ * gitlab_client_get_projects_async:
+ * @self: a #GitlabClient
+ * @callback: the callback for the async operation
+ * @cancellable: (nullable): a #Gcancellable, or %NULL
+ * @user_data: user defined parameter
+ *
+ * Asynchronously loads all projects of the GNOME group. Use
+ * gitlab_client_query_projects_async() to list other projects.
+ *
+ * See also: gitlab_client_get_projects_finish()
+ */
+void
+gitlab_client_get_projects_async (GitlabClient        *self,
+                                  GAsyncReadyCallback  callback,
+                                  GCancellable        *cancellable,
+                                  gpointer             user_data)
+{
+	g_autoptr(GitlabProjectQuery) query = gitlab_project_query_new ();
+
+	g_assert (GITLAB_IS_CLIENT (self));
+	g_assert (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+	gitlab_project_query_set_group (query, "GNOME");
+	gitlab_client_query_projects_async (self, query, callback, cancellable, user_data);
+}
+
+GList *
+gitlab_client_get_projects_finish (GitlabClient *self,
+                                   GAsyncResult  *res,
+                                   GError        **error)
+{
+	return gitlab_client_query_projects_finish (self, res, error);
+}
+
+/**
+ * gitlab_client_stream_projects_async:
+ * @self: a #GitlabClient
+ * @query: a #GitlabProjectQuery. A new query matches every project the
+ *   token can see, which on a public instance is all of them.
+ * @projects_func: called with every page of projects
+ * @projects_data: user data for @projects_func
+ * @callback: the callback for the async operation
+ * @cancellable: (nullable): a #GCancellable, or %NULL
+ * @user_data: user defined parameter
+ *
+ * Like gitlab_client_query_projects_async(), but hands the projects to
+ * @projects_func page by page, in order, as soon as they arrived instead of
+ * collecting them into one list. @projects_func is called in the thread
+ * default main context of the caller and is not called anymore after the
+ * operation completed.
+ *
+ * See also: gitlab_client_stream_projects_finish()
+ */
+void
+gitlab_client_stream_projects_async (GitlabClient        *self,
+                                     GitlabProjectQuery  *query,
+                                     GitlabProjectsFunc   projects_func,
+                                     gpointer             projects_data,
+                                     GAsyncReadyCallback  callback,
+                                     GCancellable        *cancellable,
+                                     gpointer             user_data)
+{
+	g_autoptr (GTask) task = NULL;
+	g_autofree gchar *url = NULL;
+
+	g_assert (GITLAB_IS_CLIENT (self));
+	g_assert (GITLAB_IS_PROJECT_QUERY (query));
+	g_assert (projects_func != NULL);
+	g_assert (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+	task = g_task_new (self, cancellable, callback, user_data);
+	g_task_set_source_tag (task, gitlab_client_stream_projects_async);
+
+	url = gitlab_client_get_projects_url (self, query);
+	_gitlab_pager_run (task, url, GITLAB_PAGER_NONE, gitlab_client_parse_projects,
+	                   (GitlabPagerPageFunc) projects_func, projects_data);
+}
+
+gboolean
+gitlab_client_stream_projects_finish (GitlabClient  *self,
+                                      GAsyncResult  *res,
+                                      GError       **error)
+{
+	g_assert (GITLAB_IS_CLIENT (self));
+	g_assert (G_IS_TASK (res));
+
+	return g_task_propagate_boolean (G_TASK (res), error);
+}
+
+static GPtrArray *
+gitlab_client_parse_issues (GitlabClient  *self,
+                            GBytes        *bytes,
+                            GError       **error)
+{
+	g_autoptr(GPtrArray) issues = NULL;
+	GitlabJsonScanner scanner;
+	GitlabJsonToken token;
+	gsize length;
+
+	_gitlab_json_scanner_init (&scanner, g_bytes_get_data (bytes, &length), length);
+	if (_gitlab_json_scanner_next (&scanner) != GITLAB_JSON_TOKEN_BEGIN_ARRAY) {
+		g_set_error (error, GITLAB_ERROR, GITLAB_ERROR_PARSE, "Expected an array of issues");
+		return NULL;
+	}
+
+	issues = g_ptr_array_new_with_free_func (g_object_unref);
+	while ((token = _gitlab_json_scanner_next (&scanner)) == GITLAB_JSON_TOKEN_BEGIN_OBJECT) {
+		GitlabIssue *issue = _gitlab_issue_new_from_scanner (&scanner, error);
+
+		if (issue == NULL)
+			return NULL;
+		g_ptr_array_add (issues, issue);
+	}
+
+	if (token != GITLAB_JSON_TOKEN_END_ARRAY) {
+		g_set_error (error, GITLAB_ERROR, GITLAB_ERROR_PARSE, "Malformed array of issues");
+		return NULL;
+	}
+
+	return g_steal_pointer (&issues);
+}
+
+/**
+ * gitlab_client_get_project_issues_async:
+ * @self: A #GitlabClient
+ * @project: A #GitlabProject
+ * @callback: the callback for the async operation
+ * @cancellable: (nullable): A #GCancellable, or %NULL
+ * @user_data: user defined parameter
+ *
+ * Asynchronously loads all issues to a specific #GitlabProject. Pages are
+ * requested concurrently like for gitlab_client_query_projects_async().
+ *
+ * See also: gitlab_client_get_project_issues_finish()
+ */
+void
+gitlab_client_get_project_issues_async (GitlabClient        *self,
+                                        GitlabProject       *project,
+                                        GAsyncReadyCallback  callback,
+                                        GCancellable        *cancellable,
+                                        gpointer             user_data)
+{
+	g_autoptr (GTask) task = NULL;
+	g_autofree gchar *url = NULL;
+
+	g_assert (GITLAB_IS_CLIENT (self));
+	g_assert (GITLAB_IS_PROJECT (project));
+	g_assert (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+	task = g_task_new (self, cancellable, callback, user_data);
+	g_task_set_source_tag (task, gitlab_client_get_project_issues_async);
+
+	url = g_strdup_printf ("%s/projects/%d/issues", self->baseurl, gitlab_project_get_id (project));
+	gitlab_client_list_async (self, task, url, GITLAB_PAGER_NONE, gitlab_client_parse_issues);
+}
+
+/**
+ * gitlab_client_get_project_issues_finish:
+ * @self: A #GitlabClient
+ * @res: a #GAsyncResult
+ * @error: a location for a #GError, or %NULL
+ *
+ * Returns: (transfer full) (element-type GitlabIssue): the issues of the
+ * project
+ */
+GList *
+gitlab_client_get_project_issues_finish (GitlabClient  *self,
+                                         GAsyncResult  *res,
+                                         GError       **error)
+{
+	g_assert (GITLAB_IS_CLIENT (self));
+	g_assert (G_IS_TASK (res));
+
+	return g_task_propagate_pointer (G_TASK (res), error);
+}
+
+typedef struct
+{
+	GPtrArray    *projects;
+	GPtrArray    *issues;
+	guint         next;
+	guint         in_flight;
+	GError       *error;
+	GCancellable *cancellable;
+	GCancellable *task_cancellable;
+	gulong        cancelled_id;
+} GitlabClientIssuesBatch;
+
+typedef struct
+{
+	GTask *task;
+	guint  index;
+} GitlabClientIssuesBatchItem;
+
+static void
+gitlab_client_issues_batch_free (gpointer data)
+{
+	GitlabClientIssuesBatch *batch = data;
+
+	if (batch->task_cancellable != NULL)
+		g_cancellable_disconnect (batch->task_cancellable, batch->cancelled_id);
+	g_clear_object (&batch->task_cancellable);
+	g_clear_object (&batch->cancellable);
+	g_ptr_array_unref (batch->projects);
+	g_ptr_array_unref (batch->issues);
+	g_clear_error (&batch->error);
+	g_free (batch);
+}
+
+static void
+gitlab_client_issues_batch_cancelled_cb (GCancellable *cancellable,
+                                         gpointer      user_data)
+{
+	g_cancellable_cancel (G_CANCELLABLE (user_data));
+}
+
+static void gitlab_client_issues_batch_cb (GObject      *object,
+                                           GAsyncResult *result,
+                                           gpointer      user_data);
+
+static void
+gitlab_client_issues_batch_schedule (GTask *task)
+{
+	GitlabClient *self = g_task_get_source_object (task);
+	GitlabClientIssuesBatch *batch = g_task_get_task_data (task);
+	GList *list = NULL;
+
+	while (batch->error == NULL &&
+	       batch->in_flight < self->max_projects_in_flight &&
+	       batch->next < batch->projects->len) {
+		GitlabClientIssuesBatchItem *item = g_new0 (GitlabClientIssuesBatchItem, 1);
+
+		item->task = g_object_ref (task);
+		item->index = batch->next++;
+		batch->in_flight++;
+
+		gitlab_client_get_project_issues_async (self,
+		                                        g_ptr_array_index (batch->projects, item->index),
+		                                        gitlab_client_issues_batch_cb,
+		                                        batch->cancellable,
+		                                        item);
+	}
+
+	if (batch->in_flight > 0)
+		return;
+
+	if (batch->error != NULL) {
+		g_task_return_error (task, g_steal_pointer (&batch->error));
+		return;
+	}
+
+	for (guint i = batch->issues->len; i > 0; i--) {
+		GList *issues = g_steal_pointer (&g_ptr_array_index (batch->issues, i - 1));
+		list = g_list_concat (issues, list);
+	}
+
+	g_task_return_pointer (task, list, gitlab_client_free_objects);
+}
+
+static void
+gitlab_client_issues_batch_cb (GObject      *object,
+                               GAsyncResult *result,
+                               gpointer      user_data)
+{
+	GitlabClientIssuesBatchItem *item = user_data;
+	g_autoptr(GTask) task = item->task;
+	GitlabClientIssuesBatch *batch = g_task_get_task_data (task);
+	GError *error = NULL;
+	GList *issues;
+
+	batch->in_flight--;
+
+	issues = gitlab_client_get_project_issues_finish (GITLAB_CLIENT (object), result, &error);
+	if (error != NULL) {
+		/* The result is lost anyway, so the other projects are not waited for */
+		if (batch->error == NULL) {
+			batch->error = error;
+			g_cancellable_cancel (batch->cancellable);
+		} else {
+			g_error_free (error);
+		}
+	} else {
+		g_ptr_array_index (batch->issues, item->index) = issues;
+	}
+
+	g_free (item);
+	gitlab_client_issues_batch_schedule (task);
+}
+
+/**
+ * gitlab_client_get_issues_for_projects_async:
+ * @self: A #GitlabClient
+ * @projects: (element-type GitlabProject): the projects to load issues of
+ * @callback: the callback for the async operation
+ * @cancellable: (nullable): A #GCancellable, or %NULL
+ * @user_data: user defined parameter
+ *
+ * Asynchronously loads the issues of all @projects, with at most
+ * #GitlabClient:max-projects-in-flight projects being loaded at once. The
+ * first project that fails cancels the others and fails the whole call.
+ *
+ * See also: gitlab_client_get_issues_for_projects_finish()
+ */
+void
+gitlab_client_get_issues_for_projects_async (GitlabClient        *self,
+                                             GList               *projects,
+                                             GAsyncReadyCallback  callback,
+                                             GCancellable        *cancellable,
+                                             gpointer             user_data)
+{
+	g_autoptr (GTask) task = NULL;
+	GitlabClientIssuesBatch *batch;
+
+	g_assert (GITLAB_IS_CLIENT (self));
+	g_assert (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+	task = g_task_new (self, cancellable, callback, user_data);
+	g_task_set_source_tag (task, gitlab_client_get_issues_for_projects_async);
+
+	batch = g_new0 (GitlabClientIssuesBatch, 1);
+	batch->projects = g_ptr_array_new_with_free_func (g_object_unref);
+	for (GList *l = projects; l != NULL; l = l->next)
+		g_ptr_array_add (batch->projects, g_object_ref (l->data));
+	batch->issues = g_ptr_array_new_with_free_func (gitlab_client_free_objects);
+	g_ptr_array_set_size (batch->issues, batch->projects->len);
+	batch->cancellable = g_cancellable_new ();
+	if (cancellable != NULL) {
+		batch->task_cancellable = g_object_ref (cancellable);
+		batch->cancelled_id = g_cancellable_connect (cancellable,
+		                                             G_CALLBACK (gitlab_client_issues_batch_cancelled_cb),
+		                                             batch->cancellable,
+		                                             NULL);
+	}
+	g_task_set_task_data (task, batch, gitlab_client_issues_batch_free);
+
+	gitlab_client_issues_batch_schedule (task);
+}
+
+/**
+ * gitlab_client_get_issues_for_projects_finish:
+ * @self: A #GitlabClient
+ * @res: a #GAsyncResult
+ * @error: a location for a #GError, or %NULL
+ *
+ * Returns: (transfer full) (element-type GitlabIssue): the issues of all
+ * projects, in the order of the projects
+ */
+GList *
+gitlab_client_get_issues_for_projects_finish (GitlabClient  *self,
+                                              GAsyncResult  *res,
+                                              GError       **error)
+{
+	g_assert (GITLAB_IS_CLIENT (self));
+	g_assert (G_IS_TASK (res));
+
+	return g_task_propagate_pointer (G_TASK (res), error);
+}
+
+static GitlabProject *
+gitlab_client_parse_project (GBytes  *bytes,
+                             GError **error)
+{
+	GitlabJsonScanner scanner;
+	gsize length;
+
+	_gitlab_json_scanner_init (&scanner, g_bytes_get_data (bytes, &length), length);
+	if (_gitlab_json_scanner_next (&scanner) != GITLAB_JSON_TOKEN_BEGIN_OBJECT) {
+		g_set_error (error, GITLAB_ERROR, GITLAB_ERROR_PARSE, "Expected a project");
+		return NULL;
+	}
+
+	return _gitlab_project_new_from_scanner (&scanner, NULL, NULL, error);
+}
+
+/*
+ * Every distinct id is requested once. @slots maps each requested id to
+ * its distinct one, the results are spread over @projects and @errors in
+ * the order of the request once all of them arrived.
+ */
+typedef struct
+{
+	GArray    *ids;
+	GArray    *slots;
+	GPtrArray *fetched;
+	GPtrArray *fetch_errors;
+	GPtrArray *projects;
+	GPtrArray *errors;
+	guint      next;
+	guint      in_flight;
+} GitlabClientProjectsBatch;
+
+typedef struct
+{
+	GTask       *task;
+	SoupMessage *msg;
+	guint        index;
+} GitlabClientProjectsBatchItem;
+
+static void
+gitlab_client_projects_batch_free (gpointer data)
+{
+	GitlabClientProjectsBatch *batch = data;
+
+	g_array_unref (batch->ids);
+	g_array_unref (batch->slots);
+	g_ptr_array_unref (batch->fetched);
+	g_ptr_array_unref (batch->fetch_errors);
+	g_ptr_array_unref (batch->projects);
+	g_ptr_array_unref (batch->errors);
+	g_free (batch);
+}
+
+static void
+gitlab_client_free_object (gpointer data)
+{
+	if (data != NULL)
+		g_object_unref (data);
+}
+
+static void
+gitlab_client_free_error (gpointer data)
+{
+	if (data != NULL)
+		g_error_free (data);
+}
+
+static void gitlab_client_projects_batch_cb (GObject      *object,
+                                             GAsyncResult *result,
+                                             gpointer      user_data);
+
+static void
+gitlab_client_projects_batch_schedule (GTask *task)
+{
+	GitlabClient *self = g_task_get_source_object (task);
+	GitlabClientProjectsBatch *batch = g_task_get_task_data (task);
+
+	while (batch->in_flight < self->max_projects_in_flight &&
+	       batch->next < batch->ids->len) {
+		GitlabClientProjectsBatchItem *item = g_new0 (GitlabClientProjectsBatchItem, 1);
+		g_autofree gchar *url = NULL;
+
+		item->task = g_object_ref (task);
+		item->index = batch->next++;
+		batch->in_flight++;
+
+		url = g_strdup_printf ("%s/projects/%d",
+		                       self->baseurl,
+		                       g_array_index (batch->ids, gint, item->index));
+		item->msg = _gitlab_client_auth_message (self, url);
+
+		_gitlab_client_send_async (self,
+		                           item->msg,
+		                           g_task_get_cancellable (task),
+		                           gitlab_client_projects_batch_cb,
+		                           item);
+	}
+
+	if (batch->in_flight > 0)
+		return;
+
+	if (g_task_return_error_if_cancelled (task))
+		return;
+
+	for (guint i = 0; i < batch->slots->len; i++) {
+		guint slot = g_array_index (batch->slots, guint, i);
+		GitlabProject *project = g_ptr_array_index (batch->fetched, slot);
+		GError *error = g_ptr_array_index (batch->fetch_errors, slot);
+
+		g_ptr_array_index (batch->projects, i) = project ? g_object_ref (project) : NULL;
+		g_ptr_array_index (batch->errors, i) = error ? g_error_copy (error) : NULL;
+	}
+
+	g_task_return_pointer (task,
+	                       g_ptr_array_ref (batch->projects),
+	                       (GDestroyNotify) g_ptr_array_unref);
+}
+
+static void
+gitlab_client_projects_batch_cb (GObject      *object,
+                                 GAsyncResult *result,
+                                 gpointer      user_data)
+{
+	GitlabClientProjectsBatchItem *item = user_data;
+	g_autoptr(GTask) task = item->task;
+	GitlabClientProjectsBatch *batch = g_task_get_task_data (task);
+	g_autoptr(GBytes) bytes = NULL;
+	GError *error = NULL;
+
+	batch->in_flight--;
+
+	bytes = _gitlab_client_send_finish (GITLAB_CLIENT (object), result, &error);
+	if (bytes != NULL) {
+		g_ptr_array_index (batch->fetched, item->index) = gitlab_client_parse_project (bytes, &error);
+		_gitlab_client_send_parsed (GITLAB_CLIENT (object), result, error == NULL);
+	}
+
+	g_ptr_array_index (batch->fetch_errors, item->index) = error;
+
+	g_object_unref (item->msg);
+	g_free (item);
+	gitlab_client_projects_batch_schedule (task);
+}
+
+/**
+ * gitlab_client_get_projects_by_ids_async:
+ * @self: a #GitlabClient
+ * @ids: (array length=n_ids): the ids of the projects
+ * @n_ids: the number of ids
+ * @callback: the callback for the async operation
+ * @cancellable: (nullable): a #GCancellable, or %NULL
+ * @user_data: user defined parameter
+ *
+ * Asynchronously loads each project in @ids, with at most
+ * #GitlabClient:max-projects-in-flight requests at once. A project that
+ * fails to load does not fail the others. An id that is given more than
+ * once is requested once and its result is returned for each of them.
+ *
+ * See also: gitlab_client_get_projects_by_ids_finish()
+ */
+void
+gitlab_client_get_projects_by_ids_async (GitlabClient        *self,
+                                         const gint          *ids,
+                                         guint                n_ids,
+                                         GAsyncReadyCallback  callback,
+                                         GCancellable        *cancellable,
+                                         gpointer             user_data)
+{
+	g_autoptr (GTask) task = NULL;
+	g_autoptr (GHashTable) slots = NULL;
+	GitlabClientProjectsBatch *batch;
+
+	g_assert (GITLAB_IS_CLIENT (self));
+	g_assert (ids != NULL || n_ids == 0);
+	g_assert (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+	task = g_task_new (self, cancellable, callback, user_data);
+	g_task_set_source_tag (task, gitlab_client_get_projects_by_ids_async);
+
+	batch = g_new0 (GitlabClientProjectsBatch, 1);
+	batch->ids = g_array_sized_new (FALSE, FALSE, sizeof (gint), n_ids);
+	batch->slots = g_array_sized_new (FALSE, FALSE, sizeof (guint), n_ids);
+	slots = g_hash_table_new (NULL, NULL);
+	for (guint i = 0; i < n_ids; i++) {
+		gpointer value;
+		guint slot;
+
+		if (g_hash_table_lookup_extended (slots, GINT_TO_POINTER (ids[i]), NULL, &value)) {
+			slot = GPOINTER_TO_UINT (value);
+		} else {
+			slot = batch->ids->len;
+			g_hash_table_insert (slots, GINT_TO_POINTER (ids[i]), GUINT_TO_POINTER (slot));
+			g_array_append_val (batch->ids, ids[i]);
+		}
+		g_array_append_val (batch->slots, slot);
+	}
+	batch->fetched = g_ptr_array_new_full (batch->ids->len, gitlab_client_free_object);
+	g_ptr_array_set_size (batch->fetched, batch->ids->len);
+	batch->fetch_errors = g_ptr_array_new_full (batch->ids->len, gitlab_client_free_error);
+	g_ptr_array_set_size (batch->fetch_errors, batch->ids->len);
+	batch->projects = g_ptr_array_new_full (n_ids, gitlab_client_free_object);
+	g_ptr_array_set_size (batch->projects, n_ids);
+	batch->errors = g_ptr_array_new_full (n_ids, gitlab_client_free_error);
+	g_ptr_array_set_size (batch->errors, n_ids);
+	g_task_set_task_data (task, batch, gitlab_client_projects_batch_free);
+
+	gitlab_client_projects_batch_schedule (task);
+}
+
+/**
+ * gitlab_client_get_projects_by_ids_finish:
+ * @self: a #GitlabClient
+ * @res: a #GAsyncResult
+ * @errors: (out) (optional) (transfer container) (element-type GLib.Error):
+ *   the error of each project that failed to load, %NULL for the others
+ * @error: a #GError, only set if the whole call was cancelled
+ *
+ * Returns: (transfer container) (element-type GitlabProject): the projects
+ * in the order of the ids, %NULL for those that failed to load
+ */
+GPtrArray *
+gitlab_client_get_projects_by_ids_finish (GitlabClient  *self,
+                                          GAsyncResult  *res,
+                                          GPtrArray    **errors,
+                                          GError       **error)
+{
+	GitlabClientProjectsBatch *batch;
+	GPtrArray *projects;
+
+	g_assert (GITLAB_IS_CLIENT (self));
+	g_assert (g_task_is_valid (res, self));
+
+	projects = g_task_propagate_pointer (G_TASK (res), error);
+	if (projects != NULL && errors != NULL) {
+		batch = g_task_get_task_data (G_TASK (res));
+		*errors = g_ptr_array_ref (batch->errors);
+	}
+
+	return projects;
+}
+
+typedef struct
+{
+	gchar     *key;
+	gboolean   complete;
+	GPtrArray *added;
+	GPtrArray *changed;
+	GPtrArray *removed;
+} GitlabClientSync;
+
+static void
+gitlab_client_sync_free (gpointer data)
+{
+	GitlabClientSync *sync = data;
+
+	g_free (sync->key);
+	g_clear_pointer (&sync->added, g_ptr_array_unref);
+	g_clear_pointer (&sync->changed, g_ptr_array_unref);
+	g_clear_pointer (&sync->removed, g_ptr_array_unref);
+	g_free (sync);
+}
+
+static GitlabSyncState *
+gitlab_client_get_sync_state (GitlabClient        *self,
+                              const gchar         *key,
+                              GitlabSyncIdFunc     id_func,
+                              GitlabSyncStampFunc  stamp_func)
+{
+	GitlabSyncState *state;
+
+	g_mutex_lock (&self->sync_lock);
+	state = g_hash_table_lookup (self->syncs, key);
+	if (state == NULL) {
+		state = _gitlab_sync_state_new (id_func, stamp_func);
+		g_hash_table_insert (self->syncs, g_strdup (key), state);
+	}
+	g_mutex_unlock (&self->sync_lock);
+
+	return state;
+}
+
+static void
+gitlab_client_sync_cb (GObject      *object,
+                       GAsyncResult *result,
+                       gpointer      user_data)
+{
+	GitlabClient *self = GITLAB_CLIENT (object);
+	g_autoptr(GTask) task = user_data;
+	GitlabClientSync *sync = g_task_get_task_data (task);
+	GitlabSyncState *state;
+	GError *error = NULL;
+	GList *items;
+
+	items = g_task_propagate_pointer (G_TASK (result), &error);
+	if (error != NULL) {
+		g_task_return_error (task, error);
+		return;
+	}
+
+	g_mutex_lock (&self->sync_lock);
+	state = g_hash_table_lookup (self->syncs, sync->key);
+	g_mutex_unlock (&self->sync_lock);
+
+	_gitlab_sync_state_apply (state, items, sync->complete,
+	                          &sync->added, &sync->changed, &sync->removed);
+	gitlab_client_free_objects (items);
+
+	g_task_return_boolean (task, TRUE);
+}
+
+/*
+ * Lists @url completely, or only the objects changed since the high-water
+ * mark of @url passed as @mark_param, and diffs them against the index.
+ */
+static void
+gitlab_client_sync_async (GitlabClient         *self,
+                          GTask                *task,
+                          const gchar          *url,
+                          const gchar          *mark_param,
+                          GitlabSyncFlags       flags,
+                          GitlabPagerParseFunc  parse_func,
+                          GitlabSyncIdFunc      id_func,
+                          GitlabSyncStampFunc   stamp_func)
+{
+	g_autofree gchar *mark = NULL;
+	g_autofree gchar *list_url = NULL;
+	GitlabClientSync *sync;
+	GitlabSyncState *state;
+	GTask *list_task;
+
+	sync = g_new0 (GitlabClientSync, 1);
+	sync->key = _gitlab_client_get_cache_key (self, url);
+	g_task_set_task_data (task, sync, gitlab_client_sync_free);
+
+	state = gitlab_client_get_sync_state (self, sync->key, id_func, stamp_func);
+	if ((flags & GITLAB_SYNC_FULL) == 0)
+		mark = _gitlab_sync_state_get_mark (state);
+
+	if (mark != NULL) {
+		g_autofree gchar *escaped = g_uri_escape_string (mark, NULL, TRUE);
+
+		list_url = g_strdup_printf ("%s%c%s=%s",
+		                            url,
+		                            strchr (url, '?') != NULL ? '&' : '?',
+		                            mark_param,
+		                            escaped);
+	} else {
+		sync->complete = TRUE;
+		list_url = g_strdup (url);
+	}
+
+	list_task = g_task_new (self,
+	                        g_task_get_cancellable (task),
+	                        gitlab_client_sync_cb,
+	                        g_object_ref (task));
+	/* Every mark makes a new URL, caching those would only pile up entries */
+	gitlab_client_list_async (self, list_task, list_url,
+	                          mark != NULL ? GITLAB_PAGER_UNCACHED : GITLAB_PAGER_NONE,
+	                          parse_func);
+	g_object_unref (list_task);
+}
+
+static gboolean
+gitlab_client_sync_finish (GAsyncResult  *res,
+                           GPtrArray    **added,
+                           GPtrArray    **changed,
+                           GPtrArray    **removed,
+                           GError       **error)
+{
+	GitlabClientSync *sync = g_task_get_task_data (G_TASK (res));
+
+	if (!g_task_propagate_boolean (G_TASK (res), error))
+		return FALSE;
+
+	if (added != NULL)
+		*added = g_ptr_array_ref (sync->added);
+	if (changed != NULL)
+		*changed = g_ptr_array_ref (sync->changed);
+	if (removed != NULL)
+		*removed = g_ptr_array_ref (sync->removed);
+
+	return TRUE;
+}
+
+/**
+ * gitlab_client_sync_projects_async:
+ * @self: a #GitlabClient
+ * @query: a #GitlabProjectQuery. A new query matches every project the
+ *   token can see, which on a public instance is all of them.
+ * @flags: #GitlabSyncFlags
+ * @callback: the callback for the async operation
+ * @cancellable: (nullable): a #GCancellable, or %NULL
+ * @user_data: user defined parameter
+ *
+ * Brings the client's index of the projects matching @query up to date.
+ * The first sync lists all of them, later ones only ask for projects with
+ * activity since the newest activity seen, so their cost scales with the
+ * number of changed projects. Deleted projects only show up in a complete
+ * listing, request one from time to time with %GITLAB_SYNC_FULL.
+ *
+ * See also: gitlab_client_sync_projects_finish()
+ */
+void
+gitlab_client_sync_projects_async (GitlabClient        *self,
+                                   GitlabProjectQuery  *query,
+                                   GitlabSyncFlags      flags,
+                                   GAsyncReadyCallback  callback,
+                                   GCancellable        *cancellable,
+                                   gpointer             user_data)
+{
+	g_autoptr(GTask) task = NULL;
+	g_autofree gchar *url = NULL;
+
+	g_assert (GITLAB_IS_CLIENT (self));
+	g_assert (GITLAB_IS_PROJECT_QUERY (query));
+	g_assert (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+	task = g_task_new (self, cancellable, callback, user_data);
+	g_task_set_source_tag (task, gitlab_client_sync_projects_async);
+
+	url = gitlab_client_get_projects_url (self, query);
+	gitlab_client_sync_async (self, task, url, "last_activity_after", flags,
+	                          gitlab_client_parse_projects,
+	                          (GitlabSyncIdFunc) gitlab_project_get_id,
+	                          (GitlabSyncStampFunc) gitlab_project_get_last_activity_at);
+}
+
+/**
+ * gitlab_client_sync_projects_finish:
+ * @self: a #GitlabClient
+ * @res: a #GAsyncResult
+ * @added: (out) (optional) (transfer container) (element-type GitlabProject): new projects
+ * @changed: (out) (optional) (transfer container) (element-type GitlabProject): projects with new activity
+ * @removed: (out) (optional) (transfer container) (element-type GitlabProject): projects that are gone
+ * @error: a #GError
+ *
+ * Returns: %TRUE if the index was updated
+ */
+gboolean
+gitlab_client_sync_projects_finish (GitlabClient  *self,
+                                    GAsyncResult  *res,
+                                    GPtrArray    **added,
+                                    GPtrArray    **changed,
+                                    GPtrArray    **removed,
+                                    GError       **error)
+{
+	g_assert (GITLAB_IS_CLIENT (self));
+	g_assert (g_task_is_valid (res, self));
+
+	return gitlab_client_sync_finish (res, added, changed, removed, error);
+}
+
+/**
+ * gitlab_client_sync_project_issues_async:
+ * @self: a #GitlabClient
+ * @project: a #GitlabProject
+ * @flags: #GitlabSyncFlags
+ * @callback: the callback for the async operation
+ * @cancellable: (nullable): a #GCancellable, or %NULL
+ * @user_data: user defined parameter
+ *
+ * Like gitlab_client_sync_projects_async(), for the issues of @project.
+ * Later syncs only ask for issues updated since the newest update seen.
+ *
+ * See also: gitlab_client_sync_project_issues_finish()
+ */
+void
+gitlab_client_sync_project_issues_async (GitlabClient        *self,
+                                         GitlabProject       *project,
+                                         GitlabSyncFlags      flags,
+                                         GAsyncReadyCallback  callback,
+                                         GCancellable        *cancellable,
+                                         gpointer             user_data)
+{
+	g_autoptr(GTask) task = NULL;
+	g_autofree gchar *url = NULL;
+
+	g_assert (GITLAB_IS_CLIENT (self));
+	g_assert (GITLAB_IS_PROJECT (project));
+	g_assert (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+	task = g_task_new (self, cancellable, callback, user_data);
+	g_task_set_source_tag (task, gitlab_client_sync_project_issues_async);
+
+	url = g_strdup_printf ("%s/projects/%d/issues", self->baseurl, gitlab_project_get_id (project));
+	gitlab_client_sync_async (self, task, url, "updated_after", flags,
+	                          gitlab_client_parse_issues,
+	                          (GitlabSyncIdFunc) gitlab_issue_get_id,
+	                          (GitlabSyncStampFunc) gitlab_issue_get_updated_at);
+}
+
+/**
+ * gitlab_client_sync_project_issues_finish:
+ * @self: a #GitlabClient
+ * @res: a #GAsyncResult
+ * @added: (out) (optional) (transfer container) (element-type GitlabIssue): new issues
+ * @changed: (out) (optional) (transfer container) (element-type GitlabIssue): updated issues
+ * @removed: (out) (optional) (transfer container) (element-type GitlabIssue): issues that are gone
+ * @error: a #GError
+ *
+ * Returns: %TRUE if the index was updated
+ */
+gboolean
+gitlab_client_sync_project_issues_finish (GitlabClient  *self,
+                                          GAsyncResult  *res,
+                                          GPtrArray    **added,
+                                          GPtrArray    **changed,
+                                          GPtrArray    **removed,
+                                          GError       **error)
+{
+	g_assert (GITLAB_IS_CLIENT (self));
+	g_assert (g_task_is_valid (res, self));
+
+	return gitlab_client_sync_finish (res, added, changed, removed, error);
+}
+
+/*
+ * Accounts a finished request in the histograms, marks it in a running
+ * sysprof capture and emits #GitlabClient::request-finished.
+ */
+void
+_gitlab_client_report (GitlabClient       *self,
+                       GitlabRequestTrace *trace)
+{
+	const GitlabRequestStats *stats;
+
+	g_assert (GITLAB_IS_CLIENT (self));
+
+	stats = _gitlab_request_trace_finish (trace);
+
+	g_mutex_lock (&self->stats_lock);
+	for (guint i = 0; i < GITLAB_REQUEST_N_PHASES; i++) {
+		guint bucket = stats->phase_usec[i] > 1 ? g_bit_nth_msf ((gulong) stats->phase_usec[i], -1) : 0;
+
+		self->histograms[i][MIN (bucket, GITLAB_CLIENT_HISTOGRAM_BUCKETS - 1)]++;
+	}
+	g_mutex_unlock (&self->stats_lock);
+
+#ifdef HAVE_SYSPROF
+	{
+		gint64 start = _gitlab_request_trace_get_start (trace);
+
+		sysprof_collector_mark (start * 1000,
+		                        (g_get_monotonic_time () - start) * 1000,
+		                        "gitlab-glib",
+		                        stats->endpoint,
+		                        NULL);
+	}
+#endif
+
+	g_signal_emit (self, signals [REQUEST_FINISHED], 0, stats);
+}
+
+/**
+ * gitlab_client_get_histogram:
+ * @self: a #GitlabClient
+ * @phase: a #GitlabRequestPhase
+ * @n_buckets: (out): the number of buckets
+ *
+ * Returns the distribution of the time requests spent in @phase. Bucket
+ * 0 counts durations below 2 microseconds, bucket i durations from 2^i up
+ * to 2^(i+1) microseconds and the last bucket everything longer.
+ *
+ * Returns: (transfer full) (array length=n_buckets): the request counts
+ */
+guint *
+gitlab_client_get_histogram (GitlabClient       *self,
+                             GitlabRequestPhase  phase,
+                             guint              *n_buckets)
+{
+	guint *buckets;
+
+	g_assert (GITLAB_IS_CLIENT (self));
+	g_assert (phase < GITLAB_REQUEST_N_PHASES);
+	g_assert (n_buckets != NULL);
+
+	g_mutex_lock (&self->stats_lock);
+	buckets = g_new (guint, GITLAB_CLIENT_HISTOGRAM_BUCKETS);
+	memcpy (buckets, self->histograms[phase], sizeof self->histograms[phase]);
+	g_mutex_unlock (&self->stats_lock);
+
+	*n_buckets = GITLAB_CLIENT_HISTOGRAM_BUCKETS;
+
+	return buckets;
+}
+
+/**
+ * gitlab_client_reset_histograms:
+ * @self: a #GitlabClient
+ *
+ * Starts all histograms from zero.
+ */
+void
+gitlab_client_reset_histograms (GitlabClient *self)
+{
+	g_assert (GITLAB_IS_CLIENT (self));
+
+	g_mutex_lock (&self->stats_lock);
+	memset (self->histograms, 0, sizeof self->histograms);
+	g_mutex_unlock (&self->stats_lock);
+}
+
+typedef struct
+{
+	gchar              *url;
+	GOutputStream      *stream;
+	goffset             offset;
+	goffset             first;
+	goffset             total;
+	GitlabProgressFunc  progress_func;
+	gpointer            progress_data;
+	GDestroyNotify      progress_notify;
+	GitlabRequestTrace *trace;
+	GInputStream       *body;
+	gchar              *validator;
+	guint               attempt;
+	guint8             *buffer;
+} GitlabClientDownload;
+
+static void
+gitlab_client_download_free (gpointer data)
+{
+	GitlabClientDownload *download = data;
+
+	g_free (download->url);
+	g_object_unref (download->stream);
+	g_clear_pointer (&download->trace, _gitlab_request_trace_free);
+	g_clear_object (&download->body);
+	g_free (download->validator);
+	g_free (download->buffer);
+	if (download->progress_notify != NULL)
+		download->progress_notify (download->progress_data);
+	g_free (download);
+}
+
+static void gitlab_client_download_send_cb (GObject      *object,
+                                            GAsyncResult *result,
+                                            gpointer      user_data);
+static void gitlab_client_download_read_cb (GObject      *object,
+                                            GAsyncResult *result,
+                                            gpointer      user_data);
+
+static void
+gitlab_client_download_start (GTask *task)
+{
+	GitlabClient *self = g_task_get_source_object (task);
+	GitlabClientDownload *download = g_task_get_task_data (task);
+	g_autoptr(SoupMessage) msg = NULL;
+
+	msg = _gitlab_client_auth_message (self, download->url);
+	/* Ranges count the bytes as sent, so the body must not be decoded */
+	soup_message_disable_feature (msg, SOUP_TYPE_CONTENT_DECODER);
+	if (download->offset > 0)
+		soup_message_headers_set_range (msg->request_headers, download->offset, -1);
+	/* Only continue the archive that was started, a changed one comes whole */
+	if (download->offset > 0 && download->validator != NULL)
+		soup_message_headers_replace (msg->request_headers, "If-Range", download->validator);
+
+	download->attempt++;
+	download->first = download->offset;
+	download->trace = _gitlab_request_trace_new (msg);
+
+	_gitlab_scheduler_send_async (self->scheduler,
+	                              msg,
+	                              g_task_get_cancellable (task),
+	                              gitlab_client_download_send_cb,
+	                              g_object_ref (task));
+}
+
+static void
+gitlab_client_download_end_attempt (GTask *task)
+{
+	GitlabClient *self = g_task_get_source_object (task);
+	GitlabClientDownload *download = g_task_get_task_data (task);
+
+	_gitlab_request_trace_read (download->trace, download->offset - download->first);
+	_gitlab_client_report (self, download->trace);
+	g_clear_pointer (&download->trace, _gitlab_request_trace_free);
+	g_clear_object (&download->body);
+}
+
+/*
+ * Starts the target over, for when the server ignored the range or the
+ * part that was written cannot be validated. Only works if the target can
+ * be truncated.
+ */
+static gboolean
+gitlab_client_download_rewind (GitlabClientDownload  *download,
+                               GCancellable          *cancellable,
+                               GError               **error)
+{
+	GSeekable *seekable = G_IS_SEEKABLE (download->stream) ? G_SEEKABLE (download->stream) : NULL;
+
+	if (seekable == NULL || !g_seekable_can_truncate (seekable)) {
+		g_set_error (error, GITLAB_ERROR, GITLAB_ERROR_HTTP,
+		             "%s: the server does not support resuming", download->url);
+		return FALSE;
+	}
+
+	if (!g_seekable_truncate (seekable, 0, cancellable, error) ||
+	    !g_seekable_seek (seekable, 0, G_SEEK_SET, cancellable, error))
+		return FALSE;
+
+	download->offset = 0;
+	download->first = 0;
+
+	return TRUE;
+}
+
+/*
+ * Network errors start another attempt that continues where the last one
+ * stopped. Cancellation and errors of the server or the target are final.
+ */
+static void
+gitlab_client_download_fail (GTask    *task,
+                             GError   *error,
+                             gboolean  retry)
+{
+	GitlabClientDownload *download = g_task_get_task_data (task);
+
+	gitlab_client_download_end_attempt (task);
+
+	if (retry &&
+	    download->attempt < GITLAB_CLIENT_DOWNLOAD_ATTEMPTS &&
+	    error->domain != GITLAB_ERROR &&
+	    !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+		/* Without a validator the tail might belong to another archive */
+		if (download->offset > 0 && download->validator == NULL &&
+		    !gitlab_client_download_rewind (download, g_task_get_cancellable (task), NULL)) {
+			g_task_return_error (task, error);
+			return;
+		}
+
+		g_debug ("Resuming %s at %" G_GOFFSET_FORMAT ": %s",
+		         download->url, download->offset, error->message);
+		g_error_free (error);
+		gitlab_client_download_start (task);
+		return;
+	}
+
+	g_task_return_error (task, error);
+}
+
+/*
+ * Remembers what identifies the archive the first response started, to
+ * send as If-Range when resuming: a strong ETag or else Last-Modified.
+ */
+static void
+gitlab_client_download_set_validator (GitlabClientDownload *download,
+                                      SoupMessage          *msg)
+{
+	const gchar *etag = soup_message_headers_get_one (msg->response_headers, "ETag");
+	const gchar *last_modified = soup_message_headers_get_one (msg->response_headers, "Last-Modified");
+
+	if (download->validator != NULL)
+		return;
+
+	if (etag != NULL && !g_str_has_prefix (etag, "W/"))
+		download->validator = g_strdup (etag);
+	else if (last_modified != NULL)
+		download->validator = g_strdup (last_modified);
+}
+
+/*
+ * Returns the complete length from a Content-Range of the form
+ * "bytes <range or *>/<length>", or -1.
+ */
+static goffset
+gitlab_client_download_get_complete_length (SoupMessage *msg)
+{
+	const gchar *header = soup_message_headers_get_one (msg->response_headers, "Content-Range");
+	const gchar *slash;
+
+	if (header == NULL || (slash = strchr (header, '/')) == NULL || !g_ascii_isdigit (slash[1]))
+		return -1;
+
+	return g_ascii_strtoll (slash + 1, NULL, 10);
+}
+
+static void
+gitlab_client_download_write_cb (GObject      *object,
+                                 GAsyncResult *result,
+                                 gpointer      user_data)
+{
+	g_autoptr(GTask) task = user_data;
+	GitlabClientDownload *download = g_task_get_task_data (task);
+	GError *error = NULL;
+	gsize written;
+
+	if (!g_output_stream_write_all_finish (G_OUTPUT_STREAM (object), result, &written, &error)) {
+		gitlab_client_download_fail (task, error, FALSE);
+		return;
+	}
+
+	download->offset += written;
+	if (download->progress_func != NULL)
+		download->progress_func (download->offset, download->total, download->progress_data);
+
+	g_input_stream_read_async (download->body,
+	                           download->buffer,
+	                           GITLAB_CLIENT_DOWNLOAD_BUFFER_SIZE,
+	                           G_PRIORITY_DEFAULT,
+	                           g_task_get_cancellable (task),
+	                           gitlab_client_download_read_cb,
+	                           g_steal_pointer (&task));
+}
+
+static void
+gitlab_client_download_read_cb (GObject      *object,
+                                GAsyncResult *result,
+                                gpointer      user_data)
+{
+	g_autoptr(GTask) task = user_data;
+	GitlabClientDownload *download = g_task_get_task_data (task);
+	GError *error = NULL;
+	gssize n_read;
+
+	n_read = g_input_stream_read_finish (G_INPUT_STREAM (object), result, &error);
+	if (n_read < 0) {
+		gitlab_client_download_fail (task, error, TRUE);
+		return;
+	}
+
+	if (n_read == 0) {
+		gitlab_client_download_end_attempt (task);
+		g_task_return_boolean (task, TRUE);
+		return;
+	}
+
+	g_output_stream_write_all_async (download->stream,
+	                                 download->buffer,
+	                                 n_read,
+	                                 G_PRIORITY_DEFAULT,
+	                                 g_task_get_cancellable (task),
+	                                 gitlab_client_download_write_cb,
+	                                 g_steal_pointer (&task));
+}
+
+static void
+gitlab_client_download_send_cb (GObject      *object,
+                                GAsyncResult *result,
+                                gpointer      user_data)
+{
+	g_autoptr(GTask) task = user_data;
+	GitlabClientDownload *download = g_task_get_task_data (task);
+	SoupMessage *msg = _gitlab_request_trace_get_message (download->trace);
+	GError *error = NULL;
+	goffset start;
+	goffset end;
+	goffset total;
+
+	download->body = _gitlab_scheduler_send_finish (GITLAB_SCHEDULER (object), result, &error);
+	if (download->body == NULL) {
+		gitlab_client_download_fail (task, error, TRUE);
+		return;
+	}
+
+	if (msg->status_code == SOUP_STATUS_REQUESTED_RANGE_NOT_SATISFIABLE && download->offset > 0) {
+		total = gitlab_client_download_get_complete_length (msg);
+		if (total != download->offset) {
+			gitlab_client_download_fail (task,
+			                             g_error_new (GITLAB_ERROR, GITLAB_ERROR_HTTP,
+			                                          "%s: have %" G_GOFFSET_FORMAT " bytes of an archive of %" G_GOFFSET_FORMAT,
+			                                          download->url, download->offset, total),
+			                             FALSE);
+			return;
+		}
+
+		/* The target has the whole archive already */
+		download->total = total;
+		gitlab_client_download_end_attempt (task);
+		g_task_return_boolean (task, TRUE);
+		return;
+	}
+
+	if (msg->status_code == SOUP_STATUS_PARTIAL_CONTENT) {
+		if (!soup_message_headers_get_content_range (msg->response_headers, &start, &end, &total) ||
+		    start != download->offset) {
+			gitlab_client_download_fail (task,
+			                             g_error_new (GITLAB_ERROR, GITLAB_ERROR_HTTP,
+			                                          "%s: unexpected Content-Range", download->url),
+			                             FALSE);
+			return;
+		}
+		download->total = total;
+		gitlab_client_download_set_validator (download, msg);
+	} else if (msg->status_code == SOUP_STATUS_OK) {
+		if (download->offset > 0 &&
+		    !gitlab_client_download_rewind (download, g_task_get_cancellable (task), &error)) {
+			gitlab_client_download_fail (task, error, FALSE);
+			return;
+		}
+		if (soup_message_headers_get_encoding (msg->response_headers) == SOUP_ENCODING_CONTENT_LENGTH)
+			download->total = soup_message_headers_get_content_length (msg->response_headers);
+		else
+			download->total = -1;
+		g_clear_pointer (&download->validator, g_free);
+		gitlab_client_download_set_validator (download, msg);
+	} else {
+		gitlab_client_download_fail (task,
+		                             g_error_new (GITLAB_ERROR, GITLAB_ERROR_HTTP,
+		                                          "%s: %u %s", download->url,
+		                                          msg->status_code, msg->reason_phrase),
+		                             FALSE);
+		return;
+	}
+
+	g_input_stream_read_async (download->body,
+	                           download->buffer,
+	                           GITLAB_CLIENT_DOWNLOAD_BUFFER_SIZE,
+	                           G_PRIORITY_DEFAULT,
+	                           g_task_get_cancellable (task),
+	                           gitlab_client_download_read_cb,
+	                           g_steal_pointer (&task));
+}
+
+static gchar *
+gitlab_client_get_archive_url (GitlabClient  *self,
+                               GitlabProject *project,
+                               const gchar   *sha)
+{
+	g_autofree gchar *escaped = NULL;
+
+	if (sha == NULL)
+		return g_strdup_printf ("%s/projects/%d/repository/archive.tar.gz",
+		                        self->baseurl, gitlab_project_get_id (project));
+
+	escaped = g_uri_escape_string (sha, NULL, FALSE);
+	return g_strdup_printf ("%s/projects/%d/repository/archive.tar.gz?sha=%s",
+	                        self->baseurl, gitlab_project_get_id (project), escaped);
+}
+
+/**
+ * gitlab_client_download_archive_async:
+ * @self: a #GitlabClient
+ * @project: a #GitlabProject
+ * @sha: (nullable): the commit, branch or tag to download, or %NULL for
+ *   the default branch
+ * @stream: the #GOutputStream to write the tar.gz archive to
+ * @offset: the number of bytes of the archive @stream has already
+ * @progress_func: (scope notified) (closure progress_data) (destroy progress_notify) (nullable):
+ *   a #GitlabProgressFunc
+ * @progress_data: user data for @progress_func
+ * @progress_notify: (nullable): frees @progress_data once the download
+ *   finished
+ * @callback: the callback for the async operation
+ * @cancellable: (nullable): a #GCancellable, or %NULL
+ * @user_data: user defined parameter
+ *
+ * Streams the repository archive of @project into @stream without
+ * keeping it in memory. A non-zero @offset continues an earlier download
+ * with a Range request. Nothing checks that the archive is still the one
+ * the first @offset bytes came from, so only resume a download whose @sha
+ * names a commit.
+ *
+ * A connection that breaks in the middle is resumed with If-Range and
+ * the ETag or Last-Modified of the first response, so a changed archive
+ * is sent whole. If the server sends the whole archive, or gave no
+ * validator, @stream is truncated and the download starts over if
+ * @stream supports that, otherwise it fails.
+ *
+ * @stream is not closed.
+ */
+void
+gitlab_client_download_archive_async (GitlabClient        *self,
+                                      GitlabProject       *project,
+                                      const gchar         *sha,
+                                      GOutputStream       *stream,
+                                      goffset              offset,
+                                      GitlabProgressFunc   progress_func,
+                                      gpointer             progress_data,
+                                      GDestroyNotify       progress_notify,
+                                      GAsyncReadyCallback  callback,
+                                      GCancellable        *cancellable,
+                                      gpointer             user_data)
+{
+	g_autoptr(GTask) task = NULL;
+	GitlabClientDownload *download;
+
+	g_assert (GITLAB_IS_CLIENT (self));
+	g_assert (GITLAB_IS_PROJECT (project));
+	g_assert (G_IS_OUTPUT_STREAM (stream));
+	g_assert (offset >= 0);
+	g_assert (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+	task = g_task_new (self, cancellable, callback, user_data);
+	g_task_set_source_tag (task, gitlab_client_download_archive_async);
+
+	download = g_new0 (GitlabClientDownload, 1);
+	download->url = gitlab_client_get_archive_url (self, project, sha);
+	download->stream = g_object_ref (stream);
+	download->offset = offset;
+	download->total = -1;
+	download->progress_func = progress_func;
+	download->progress_data = progress_data;
+	download->progress_notify = progress_notify;
+	download->buffer = g_malloc (GITLAB_CLIENT_DOWNLOAD_BUFFER_SIZE);
+	g_task_set_task_data (task, download, gitlab_client_download_free);
+
+	gitlab_client_download_start (task);
+}
+
+/**
+ * gitlab_client_download_archive_finish:
+ * @self: a #GitlabClient
+ * @res: a #GAsyncResult
+ * @error: a #GError
+ *
+ * Returns: the size of the archive, or -1 on error
+ */
+goffset
+gitlab_client_download_archive_finish (GitlabClient  *self,
+                                       GAsyncResult  *res,
+                                       GError       **error)
+{
+	GitlabClientDownload *download;
+
+	g_assert (GITLAB_IS_CLIENT (self));
+	g_assert (g_task_is_valid (res, self));
+
+	if (!g_task_propagate_boolean (G_TASK (res), error))
+		return -1;
+
+	download = g_task_get_task_data (G_TASK (res));
+
+	return download->offset;
+}
+
+typedef struct
+{
+	GitlabProject      *project;
+	gchar              *sha;
+	GitlabProgressFunc  progress_func;
+	gpointer            progress_data;
+	GDestroyNotify      progress_notify;
+	GFile              *file;
+	GFile              *part;
+	GOutputStream      *stream;
+	goffset             size;
+} GitlabClientArchiveFile;
+
+static void
+gitlab_client_archive_file_free (gpointer data)
+{
+	GitlabClientArchiveFile *archive = data;
+
+	g_object_unref (archive->project);
+	g_free (archive->sha);
+	g_object_unref (archive->file);
+	g_object_unref (archive->part);
+	g_clear_object (&archive->stream);
+	if (archive->progress_notify != NULL)
+		archive->progress_notify (archive->progress_data);
+	g_free (archive);
+}
+
+/*
+ * A .part of a commit's archive is kept for the next call to continue,
+ * unless the server refused to continue it. Other archives may change in
+ * between, so their part is never continued and is removed.
+ */
+static void
+gitlab_client_archive_file_fail (GTask  *task,
+                                 GError *error)
+{
+	GitlabClientArchiveFile *archive = g_task_get_task_data (task);
+
+	if (archive->sha == NULL || error->domain == GITLAB_ERROR)
+		g_file_delete_async (archive->part, G_PRIORITY_DEFAULT, NULL, NULL, NULL);
+
+	g_task_return_error (task, error);
+}
+
+static void
+gitlab_client_archive_file_move_thread (GTask        *task,
+                                        gpointer      source_object,
+                                        gpointer      task_data,
+                                        GCancellable *cancellable)
+{
+	GitlabClientArchiveFile *archive = task_data;
+	GError *error = NULL;
+
+	if (!g_file_move (archive->part, archive->file, G_FILE_COPY_OVERWRITE,
+	                  cancellable, NULL, NULL, &error)) {
+		gitlab_client_archive_file_fail (task, error);
+		return;
+	}
+
+	g_task_return_boolean (task, TRUE);
+}
+
+static void
+gitlab_client_archive_file_close_cb (GObject      *object,
+                                     GAsyncResult *result,
+                                     gpointer      user_data)
+{
+	g_autoptr(GTask) task = user_data;
+	GitlabClientArchiveFile *archive = g_task_get_task_data (task);
+	GError *error = NULL;
+
+	if (!g_output_stream_close_finish (G_OUTPUT_STREAM (object), result, &error)) {
+		gitlab_client_archive_file_fail (task, error);
+		return;
+	}
+
+	/* Not every GFile backend renames without blocking */
+	g_task_run_in_thread (task, gitlab_client_archive_file_move_thread);
+}
+
+static void
+gitlab_client_archive_file_download_cb (GObject      *object,
+                                        GAsyncResult *result,
+                                        gpointer      user_data)
+{
+	g_autoptr(GTask) task = user_data;
+	GitlabClientArchiveFile *archive = g_task_get_task_data (task);
+	GError *error = NULL;
+
+	archive->size = gitlab_client_download_archive_finish (GITLAB_CLIENT (object), result, &error);
+	if (archive->size < 0) {
+		g_output_stream_close_async (archive->stream, G_PRIORITY_DEFAULT, NULL, NULL, NULL);
+		gitlab_client_archive_file_fail (task, error);
+		return;
+	}
+
+	g_output_stream_close_async (archive->stream,
+	                             G_PRIORITY_DEFAULT,
+	                             g_task_get_cancellable (task),
+	                             gitlab_client_archive_file_close_cb,
+	                             g_steal_pointer (&task));
+}
+
+static void
+gitlab_client_archive_file_start (GTask   *task,
+                                  goffset  offset)
+{
+	GitlabClient *self = g_task_get_source_object (task);
+	GitlabClientArchiveFile *archive = g_task_get_task_data (task);
+
+	gitlab_client_download_archive_async (self,
+	                                      archive->project,
+	                                      archive->sha,
+	                                      archive->stream,
+	                                      offset,
+	                                      archive->progress_func,
+	                                      archive->progress_data,
+	                                      NULL,
+	                                      gitlab_client_archive_file_download_cb,
+	                                      g_task_get_cancellable (task),
+	                                      task);
+}
+
+static void
+gitlab_client_archive_file_info_cb (GObject      *object,
+                                    GAsyncResult *result,
+                                    gpointer      user_data)
+{
+	g_autoptr(GTask) task = user_data;
+	g_autoptr(GFileInfo) info = NULL;
+	GError *error = NULL;
+
+	info = g_file_output_stream_query_info_finish (G_FILE_OUTPUT_STREAM (object), result, &error);
+	if (info == NULL) {
+		g_task_return_error (task, error);
+		return;
+	}
+
+	gitlab_client_archive_file_start (g_steal_pointer (&task), g_file_info_get_size (info));
+}
+
+static void
+gitlab_client_archive_file_open_cb (GObject      *object,
+                                    GAsyncResult *result,
+                                    gpointer      user_data)
+{
+	g_autoptr(GTask) task = user_data;
+	GitlabClientArchiveFile *archive = g_task_get_task_data (task);
+	GFileOutputStream *stream;
+	GError *error = NULL;
+
+	if (archive->sha != NULL)
+		stream = g_file_append_to_finish (G_FILE (object), result, &error);
+	else
+		stream = g_file_replace_finish (G_FILE (object), result, &error);
+	if (stream == NULL) {
+		g_task_return_error (task, error);
+		return;
+	}
+
+	archive->stream = G_OUTPUT_STREAM (stream);
+
+	if (archive->sha == NULL) {
+		gitlab_client_archive_file_start (g_steal_pointer (&task), 0);
+		return;
+	}
+
+	/* Continue what an interrupted call left in the .part */
+	g_file_output_stream_query_info_async (stream,
+	                                       G_FILE_ATTRIBUTE_STANDARD_SIZE,
+	                                       G_PRIORITY_DEFAULT,
+	                                       g_task_get_cancellable (task),
+	                                       gitlab_client_archive_file_info_cb,
+	                                       g_steal_pointer (&task));
+}
+
+/**
+ * gitlab_client_download_archive_to_file_async:
+ * @self: a #GitlabClient
+ * @project: a #GitlabProject
+ * @sha: (nullable): the commit, branch or tag to download, or %NULL for
+ *   the default branch
+ * @file: the #GFile to write the tar.gz archive to
+ * @progress_func: (scope notified) (closure progress_data) (destroy progress_notify) (nullable):
+ *   a #GitlabProgressFunc
+ * @progress_data: user data for @progress_func
+ * @progress_notify: (nullable): frees @progress_data once the download
+ *   finished
+ * @callback: the callback for the async operation
+ * @cancellable: (nullable): a #GCancellable, or %NULL
+ * @user_data: user defined parameter
+ *
+ * Like gitlab_client_download_archive_async(), but writes to @file. The
+ * archive is downloaded next to @file with a .part suffix and only
+ * renamed to @file once it is complete, so @file is either the old or the
+ * new archive, never a mix of both.
+ *
+ * If @sha is given, a failed download keeps its .part and the next call
+ * for the same @file continues it with a Range request. @sha has to name
+ * a commit for that, as with gitlab_client_download_archive_async(). The
+ * archive of the default branch may change between calls, so without
+ * @sha every call starts over.
+ */
+void
+gitlab_client_download_archive_to_file_async (GitlabClient        *self,
+                                              GitlabProject       *project,
+                                              const gchar         *sha,
+                                              GFile               *file,
+                                              GitlabProgressFunc   progress_func,
+                                              gpointer             progress_data,
+                                              GDestroyNotify       progress_notify,
+                                              GAsyncReadyCallback  callback,
+                                              GCancellable        *cancellable,
+                                              gpointer             user_data)
+{
+	g_autoptr(GTask) task = NULL;
+	g_autoptr(GFile) parent = NULL;
+	g_autofree gchar *basename = NULL;
+	g_autofree gchar *part = NULL;
+	GitlabClientArchiveFile *archive;
+
+	g_assert (GITLAB_IS_CLIENT (self));
+	g_assert (GITLAB_IS_PROJECT (project));
+	g_assert (G_IS_FILE (file));
+	g_assert (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+	task = g_task_new (self, cancellable, callback, user_data);
+	g_task_set_source_tag (task, gitlab_client_download_archive_to_file_async);
+
+	parent = g_file_get_parent (file);
+	basename = g_file_get_basename (file);
+	part = g_strconcat (basename, ".part", NULL);
+
+	archive = g_new0 (GitlabClientArchiveFile, 1);
+	archive->project = g_object_ref (project);
+	archive->sha = g_strdup (sha);
+	archive->progress_func = progress_func;
+	archive->progress_data = progress_data;
+	archive->progress_notify = progress_notify;
+	archive->file = g_object_ref (file);
+	archive->part = g_file_get_child (parent, part);
+	archive->size = -1;
+	g_task_set_task_data (task, archive, gitlab_client_archive_file_free);
+
+	if (sha != NULL)
+		g_file_append_to_async (archive->part,
+		                        G_FILE_CREATE_NONE,
+		                        G_PRIORITY_DEFAULT,
+		                        cancellable,
+		                        gitlab_client_archive_file_open_cb,
+		                        g_steal_pointer (&task));
+	else
+		g_file_replace_async (archive->part,
+		                      NULL,
+		                      FALSE,
+		                      G_FILE_CREATE_REPLACE_DESTINATION,
+		                      G_PRIORITY_DEFAULT,
+		                      cancellable,
+		                      gitlab_client_archive_file_open_cb,
+		                      g_steal_pointer (&task));
+}
+
+/**
+ * gitlab_client_download_archive_to_file_finish:
+ * @self: a #GitlabClient
+ * @res: a #GAsyncResult
+ * @error: a #GError
+ *
+ * Returns: the size of the archive, or -1 on error
+ */
+goffset
+gitlab_client_download_archive_to_file_finish (GitlabClient  *self,
+                                               GAsyncResult  *res,
+                                               GError       **error)
+{
+	GitlabClientArchiveFile *archive;
+
+	g_assert (GITLAB_IS_CLIENT (self));
+	g_assert (g_task_is_valid (res, self));
+
+	if (!g_task_propagate_boolean (G_TASK (res), error))
+		return -1;
+
+	archive = g_task_get_task_data (G_TASK (res));
+
+	return archive->size;
+}
+
+typedef struct
+{
+	GPtrArray *projects;
+	GFile     *directory;
+	GPtrArray *errors;
+	guint      next;
+	guint      in_flight;
+} GitlabClientArchivesBatch;
+
+typedef struct
+{
+	GTask *task;
+	guint  index;
+} GitlabClientArchivesBatchItem;
+
+static void
+gitlab_client_archives_batch_free (gpointer data)
+{
+	GitlabClientArchivesBatch *batch = data;
+
+	g_ptr_array_unref (batch->projects);
+	g_object_unref (batch->directory);
+	g_ptr_array_unref (batch->errors);
+	g_free (batch);
+}
+
+static void gitlab_client_archives_batch_cb (GObject      *object,
+                                             GAsyncResult *result,
+                                             gpointer      user_data);
+
+static void
+gitlab_client_archives_batch_schedule (GTask *task)
+{
+	GitlabClient *self = g_task_get_source_object (task);
+	GitlabClientArchivesBatch *batch = g_task_get_task_data (task);
+
+	while (batch->in_flight < self->max_projects_in_flight &&
+	       batch->next < batch->projects->len) {
+		GitlabClientArchivesBatchItem *item = g_new0 (GitlabClientArchivesBatchItem, 1);
+		GitlabProject *project;
+		g_autofree gchar *name = NULL;
+		g_autoptr(GFile) file = NULL;
+
+		item->task = g_object_ref (task);
+		item->index = batch->next++;
+		batch->in_flight++;
+
+		project = g_ptr_array_index (batch->projects, item->index);
+		name = g_strdup_printf ("%d.tar.gz", gitlab_project_get_id (project));
+		file = g_file_get_child (batch->directory, name);
+
+		gitlab_client_download_archive_to_file_async (self,
+		                                              project,
+		                                              NULL,
+		                                              file,
+		                                              NULL,
+		                                              NULL,
+		                                              NULL,
+		                                              gitlab_client_archives_batch_cb,
+		                                              g_task_get_cancellable (task),
+		                                              item);
+	}
+
+	if (batch->in_flight > 0)
+		return;
+
+	if (g_task_return_error_if_cancelled (task))
+		return;
+
+	g_task_return_boolean (task, TRUE);
+}
+
+static void
+gitlab_client_archives_batch_cb (GObject      *object,
+                                 GAsyncResult *result,
+                                 gpointer      user_data)
+{
+	GitlabClientArchivesBatchItem *item = user_data;
+	g_autoptr(GTask) task = item->task;
+	GitlabClientArchivesBatch *batch = g_task_get_task_data (task);
+	GError *error = NULL;
+
+	batch->in_flight--;
+
+	gitlab_client_download_archive_to_file_finish (GITLAB_CLIENT (object), result, &error);
+	g_ptr_array_index (batch->errors, item->index) = error;
+
+	g_free (item);
+	gitlab_client_archives_batch_schedule (task);
+}
+
+/**
+ * gitlab_client_download_archives_async:
+ * @self: a #GitlabClient
+ * @projects: (element-type GitlabProject): the projects to download
+ * @directory: the directory to store the archives in
+ * @callback: the callback for the async operation
+ * @cancellable: (nullable): a #GCancellable, or %NULL
+ * @user_data: user defined parameter
+ *
+ * Downloads the archive of the default branch of each project in
+ * @projects to @directory, named after the project id with a .tar.gz
+ * suffix. At most #GitlabClient:max-projects-in-flight archives are
+ * downloaded at once, each through a small fixed buffer, so memory use
+ * does not depend on the number or size of the archives. Existing
+ * archives are replaced once their new version is complete, see
+ * gitlab_client_download_archive_to_file_async().
+ *
+ * See also: gitlab_client_download_archives_finish()
+ */
+void
+gitlab_client_download_archives_async (GitlabClient        *self,
+                                       GPtrArray           *projects,
+                                       GFile               *directory,
+                                       GAsyncReadyCallback  callback,
+                                       GCancellable        *cancellable,
+                                       gpointer             user_data)
+{
+	g_autoptr(GTask) task = NULL;
+	GitlabClientArchivesBatch *batch;
+
+	g_assert (GITLAB_IS_CLIENT (self));
+	g_assert (projects != NULL);
+	g_assert (G_IS_FILE (directory));
+	g_assert (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+	task = g_task_new (self, cancellable, callback, user_data);
+	g_task_set_source_tag (task, gitlab_client_download_archives_async);
+
+	batch = g_new0 (GitlabClientArchivesBatch, 1);
+	batch->projects = g_ptr_array_ref (projects);
+	batch->directory = g_object_ref (directory);
+	batch->errors = g_ptr_array_new_full (projects->len, gitlab_client_free_error);
+	g_ptr_array_set_size (batch->errors, projects->len);
+	g_task_set_task_data (task, batch, gitlab_client_archives_batch_free);
+
+	gitlab_client_archives_batch_schedule (task);
+}
+
+/**
+ * gitlab_client_download_archives_finish:
+ * @self: a #GitlabClient
+ * @res: a #GAsyncResult
+ * @errors: (out) (optional) (transfer container) (element-type GLib.Error):
+ *   the error of each project whose archive failed, %NULL for the others
+ * @error: a #GError, only set if the whole call was cancelled
+ *
+ * Returns: %TRUE unless the call was cancelled
+ */
+gboolean
+gitlab_client_download_archives_finish (GitlabClient  *self,
+                                        GAsyncResult  *res,
+                                        GPtrArray    **errors,
+                                        GError       **error)
+{
+	GitlabClientArchivesBatch *batch;
+
+	g_assert (GITLAB_IS_CLIENT (self));
+	g_assert (g_task_is_valid (res, self));
+
+	if (!g_task_propagate_boolean (G_TASK (res), error))
+		return FALSE;
+
+	if (errors != NULL) {
+		batch = g_task_get_task_data (G_TASK (res));
+		*errors = g_ptr_array_ref (batch->errors);
+	}
+
+	return TRUE;
+}
+
+typedef struct
+{
+	GArray       *ids;
+	GHashTable   *projects;
+	GPtrArray    *issues;
+	GError       *error;
+	guint         in_flight;
+	GCancellable *cancellable;
+	GCancellable *task_cancellable;
+	gulong        cancelled_id;
+} GitlabClientSummaries;
+
+static void
+gitlab_client_summaries_free (gpointer data)
+{
+	GitlabClientSummaries *summaries = data;
+
+	if (summaries->task_cancellable != NULL)
+		g_cancellable_disconnect (summaries->task_cancellable, summaries->cancelled_id);
+	g_clear_object (&summaries->task_cancellable);
+	g_clear_object (&summaries->cancellable);
+	g_array_unref (summaries->ids);
+	g_hash_table_unref (summaries->projects);
+	g_ptr_array_unref (summaries->issues);
+	g_clear_error (&summaries->error);
+	g_free (summaries);
+}
+
+static void
+gitlab_client_summaries_cb (GObject      *object,
+                            GAsyncResult *result,
+                            gpointer      user_data)
+{
+	g_autoptr(GTask) task = user_data;
+	GitlabClientSummaries *summaries = g_task_get_task_data (task);
+	g_autoptr(GBytes) bytes = NULL;
+	g_autoptr(GPtrArray) projects = NULL;
+	GError *error = NULL;
+
+	summaries->in_flight--;
+
+	bytes = _gitlab_client_send_finish (GITLAB_CLIENT (object), result, &error);
+	if (bytes != NULL) {
+		guint parsed = g_hash_table_size (summaries->projects);
+
+		_gitlab_graphql_parse_summaries (bytes, summaries->projects, summaries->issues, &error);
+		_gitlab_client_send_parsed (GITLAB_CLIENT (object), result,
+		                            g_hash_table_size (summaries->projects) - parsed);
+	}
+
+	if (error != NULL) {
+		/* The result is lost anyway, so the other batches are not waited for */
+		if (summaries->error == NULL) {
+			summaries->error = error;
+			g_cancellable_cancel (summaries->cancellable);
+		} else {
+			g_error_free (error);
+		}
+	}
+
+	if (summaries->in_flight > 0)
+		return;
+
+	if (summaries->error != NULL) {
+		g_task_return_error (task, g_steal_pointer (&summaries->error));
+		return;
+	}
+
+	projects = g_ptr_array_new_full (summaries->ids->len, gitlab_client_free_object);
+	for (guint i = 0; i < summaries->ids->len; i++) {
+		GitlabProject *project = g_hash_table_lookup (summaries->projects,
+		                                              GINT_TO_POINTER (g_array_index (summaries->ids, gint, i)));
+
+		g_ptr_array_add (projects, project ? g_object_ref (project) : NULL);
+	}
+
+	g_task_return_pointer (task, g_steal_pointer (&projects), (GDestroyNotify) g_ptr_array_unref);
+}
+
+/**
+ * gitlab_client_get_project_summaries_async:
+ * @self: a #GitlabClient
+ * @ids: (array length=n_ids): the ids of the projects
+ * @n_ids: the number of ids
+ * @n_issues: the number of recently updated open issues to load per
+ *   project, at most 10
+ * @callback: the callback for the async operation
+ * @cancellable: (nullable): a #GCancellable, or %NULL
+ * @user_data: user defined parameter
+ *
+ * Loads the projects in @ids together with their open issue count and
+ * their most recently updated open issues through the GraphQL API. This
+ * takes one request per twenty projects, where the REST API needs one per
+ * project and resource. The server has to offer
+ * %GITLAB_CAPABILITY_GRAPHQL. Larger values of @n_issues are clamped to
+ * 10, more would make the server reject the queries as too complex. The
+ * first batch that fails cancels the others and fails the whole call.
+ *
+ * See also: gitlab_client_get_project_summaries_finish()
+ */
+void
+gitlab_client_get_project_summaries_async (GitlabClient        *self,
+                                           const gint          *ids,
+                                           guint                n_ids,
+                                           guint                n_issues,
+                                           GAsyncReadyCallback  callback,
+                                           GCancellable        *cancellable,
+                                           gpointer             user_data)
+{
+	g_autoptr(GTask) task = NULL;
+	g_autofree gchar *url = NULL;
+	g_autofree gchar *authorization = NULL;
+	GitlabClientSummaries *summaries;
+
+	g_assert (GITLAB_IS_CLIENT (self));
+	g_assert (ids != NULL || n_ids == 0);
+	g_assert (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+	task = g_task_new (self, cancellable, callback, user_data);
+	g_task_set_source_tag (task, gitlab_client_get_project_summaries_async);
+
+	summaries = g_new0 (GitlabClientSummaries, 1);
+	summaries->ids = g_array_sized_new (FALSE, FALSE, sizeof (gint), n_ids);
+	g_array_append_vals (summaries->ids, ids, n_ids);
+	summaries->projects = g_hash_table_new_full (NULL, NULL, NULL, g_object_unref);
+	summaries->issues = g_ptr_array_new_with_free_func (g_object_unref);
+	summaries->cancellable = g_cancellable_new ();
+	if (cancellable != NULL) {
+		summaries->task_cancellable = g_object_ref (cancellable);
+		summaries->cancelled_id = g_cancellable_connect (cancellable,
+		                                                 G_CALLBACK (gitlab_client_issues_batch_cancelled_cb),
+		                                                 summaries->cancellable,
+		                                                 NULL);
+	}
+	g_task_set_task_data (task, summaries, gitlab_client_summaries_free);
+
+	if (gitlab_client_lookup_version (self, NULL, NULL) &&
+	    (gitlab_client_get_capabilities (self) & GITLAB_CAPABILITY_GRAPHQL) == 0) {
+		g_task_return_new_error (task, GITLAB_ERROR, GITLAB_ERROR_GRAPHQL,
+		                         "The server does not offer the GraphQL API");
+		return;
+	}
+
+	if (n_ids == 0) {
+		g_task_return_pointer (task, g_ptr_array_new (), (GDestroyNotify) g_ptr_array_unref);
+		return;
+	}
+
+	url = _gitlab_graphql_get_url (self->baseurl);
+	/* Without a token only public projects are answered */
+	if (self->token != NULL && *self->token != '\0')
+		authorization = g_strconcat ("Bearer ", self->token, NULL);
+
+	for (guint i = 0; i < n_ids; i += GITLAB_GRAPHQL_MAX_PROJECTS) {
+		g_autoptr(SoupMessage) msg = soup_message_new ("POST", url);
+		gchar *body = _gitlab_graphql_build_summaries (ids + i,
+		                                               MIN (n_ids - i, GITLAB_GRAPHQL_MAX_PROJECTS),
+		                                               MIN (n_issues, GITLAB_GRAPHQL_MAX_ISSUES));
+
+		if (authorization != NULL)
+			soup_message_headers_append (msg->request_headers, "Authorization", authorization);
+		soup_message_set_request (msg, "application/json", SOUP_MEMORY_TAKE, body, strlen (body));
+
+		summaries->in_flight++;
+		_gitlab_client_send_async (self,
+		                           msg,
+		                           summaries->cancellable,
+		                           gitlab_client_summaries_cb,
+		                           g_object_ref (task));
+	}
+}
+
+/**
+ * gitlab_client_get_project_summaries_finish:
+ * @self: a #GitlabClient
+ * @res: a #GAsyncResult
+ * @issues: (out) (optional) (transfer full) (element-type GitlabIssue):
+ *   the loaded issues of all projects
+ * @error: a #GError
+ *
+ * Returns: (transfer container) (element-type GitlabProject): the projects
+ * in the order of the ids, %NULL for those the server did not return
+ */
+GPtrArray *
+gitlab_client_get_project_summaries_finish (GitlabClient  *self,
+                                            GAsyncResult  *res,
+                                            GPtrArray    **issues,
+                                            GError       **error)
+{
+	GitlabClientSummaries *summaries;
+	GPtrArray *projects;
+
+	g_assert (GITLAB_IS_CLIENT (self));
+	g_assert (g_task_is_valid (res, self));
+
+	projects = g_task_propagate_pointer (G_TASK (res), error);
+	if (projects != NULL && issues != NULL) {
+		summaries = g_task_get_task_data (G_TASK (res));
+		*issues = g_ptr_array_ref (summaries->issues);
+	}
+
+	return projects;
 }
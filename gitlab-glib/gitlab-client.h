@@ -20,7 +20,10 @@
 
 #include <glib-object.h>
 #include <gio/gio.h>
+#include "gitlab-issue.h"
 #include "gitlab-project.h"
+#include "gitlab-project-query.h"
+#include "gitlab-request-stats.h"
 
 G_BEGIN_DECLS
 
@@ -28,10 +31,82 @@ G_BEGIN_DECLS
 
 G_DECLARE_FINAL_TYPE (GitlabClient, gitlab_client, GITLAB, CLIENT, GObject)
 
+/**
+ * GitlabCapabilities:
+ * @GITLAB_CAPABILITY_NONE: nothing is known about the server
+ * @GITLAB_CAPABILITY_GRAPHQL: the server offers the GraphQL API
+ * @GITLAB_CAPABILITY_KEYSET_PAGINATION: project listings support keyset pagination
+ *
+ * Features of the server, derived from its version.
+ */
+typedef enum
+{
+	GITLAB_CAPABILITY_NONE              = 0,
+	GITLAB_CAPABILITY_GRAPHQL           = 1 << 0,
+	GITLAB_CAPABILITY_KEYSET_PAGINATION = 1 << 1,
+} GitlabCapabilities;
+
+/**
+ * GitlabSyncFlags:
+ * @GITLAB_SYNC_NONE: list only what changed since the last sync
+ * @GITLAB_SYNC_FULL: list the whole collection, which also finds removed items
+ *
+ * Flags for gitlab_client_sync_projects_async() and
+ * gitlab_client_sync_project_issues_async().
+ */
+typedef enum
+{
+	GITLAB_SYNC_NONE = 0,
+	GITLAB_SYNC_FULL = 1 << 0,
+} GitlabSyncFlags;
+
+/**
+ * GitlabProjectsFunc:
+ * @client: a #GitlabClient
+ * @projects: (element-type GitlabProject): a batch of projects
+ * @user_data: user data
+ *
+ * Receives a batch of projects while a listing is still in progress.
+ * @projects belongs to this call alone, take a reference on it to keep
+ * it.
+ */
+typedef void (*GitlabProjectsFunc) (GitlabClient *client,
+                                    GPtrArray    *projects,
+                                    gpointer      user_data);
+
+/**
+ * GitlabProgressFunc:
+ * @current: the number of bytes written so far
+ * @total: the expected number of bytes, or -1 if unknown
+ * @user_data: user data
+ *
+ * Reports the progress of a download.
+ */
+typedef void (*GitlabProgressFunc) (goffset  current,
+                                    goffset  total,
+                                    gpointer user_data);
+
 GitlabClient *gitlab_client_new (gchar *baseurl, gchar *token);
+guint gitlab_client_get_cache_hits (GitlabClient *self);
+guint gitlab_client_get_cache_misses (GitlabClient *self);
+void gitlab_client_clear_cache (GitlabClient *self);
+guint *gitlab_client_get_histogram (GitlabClient       *self,
+                                    GitlabRequestPhase  phase,
+                                    guint              *n_buckets);
+void gitlab_client_reset_histograms (GitlabClient *self);
 void gitlab_client_get_version (GitlabClient  *self,
                                 const gchar  **version,
                                 const gchar  **revision);
+void gitlab_client_get_version_async (GitlabClient        *self,
+                                      GAsyncReadyCallback  callback,
+                                      GCancellable        *cancellable,
+                                      gpointer             user_data);
+gboolean gitlab_client_get_version_finish (GitlabClient  *self,
+                                           GAsyncResult  *res,
+                                           const gchar  **version,
+                                           const gchar  **revision,
+                                           GError       **error);
+GitlabCapabilities gitlab_client_get_capabilities (GitlabClient *self);
 void gitlab_client_get_projects_async (GitlabClient        *self,
                                        GAsyncReadyCallback  callback,
                                        GCancellable        *cancellable,
@@ -39,6 +114,24 @@ void gitlab_client_get_projects_async (GitlabClient        *self,
 GList *gitlab_client_get_projects_finish (GitlabClient *self,
                                           GAsyncResult  *res,
                                           GError        **error);
+void gitlab_client_query_projects_async (GitlabClient        *self,
+                                         GitlabProjectQuery  *query,
+                                         GAsyncReadyCallback  callback,
+                                         GCancellable        *cancellable,
+                                         gpointer             user_data);
+GList *gitlab_client_query_projects_finish (GitlabClient  *self,
+                                            GAsyncResult  *res,
+                                            GError       **error);
+void gitlab_client_stream_projects_async (GitlabClient        *self,
+                                          GitlabProjectQuery  *query,
+                                          GitlabProjectsFunc   projects_func,
+                                          gpointer             projects_data,
+                                          GAsyncReadyCallback  callback,
+                                          GCancellable        *cancellable,
+                                          gpointer             user_data);
+gboolean gitlab_client_stream_projects_finish (GitlabClient  *self,
+                                               GAsyncResult  *res,
+                                               GError       **error);
 void gitlab_client_get_project_issues_async (GitlabClient        *self,
                                              GitlabProject       *project,
                                              GAsyncReadyCallback  callback,
@@ -47,4 +140,104 @@ void gitlab_client_get_project_issues_async (GitlabClient        *self,
 GList *gitlab_client_get_project_issues_finish (GitlabClient  *self,
                                                 GAsyncResult  *res,
                                                 GError       **error);
+void gitlab_client_get_issues_for_projects_async (GitlabClient        *self,
+                                                  GList               *projects,
+                                                  GAsyncReadyCallback  callback,
+                                                  GCancellable        *cancellable,
+                                                  gpointer             user_data);
+GList *gitlab_client_get_issues_for_projects_finish (GitlabClient  *self,
+                                                     GAsyncResult  *res,
+                                                     GError       **error);
+void gitlab_client_get_projects_by_ids_async (GitlabClient        *self,
+                                              const gint          *ids,
+                                              guint                n_ids,
+                                              GAsyncReadyCallback  callback,
+                                              GCancellable        *cancellable,
+                                              gpointer             user_data);
+GPtrArray *gitlab_client_get_projects_by_ids_finish (GitlabClient  *self,
+                                                     GAsyncResult  *res,
+                                                     GPtrArray    **errors,
+                                                     GError       **error);
+void gitlab_client_get_project_summaries_async (GitlabClient        *self,
+                                                const gint          *ids,
+                                                guint                n_ids,
+                                                guint                n_issues,
+                                                GAsyncReadyCallback  callback,
+                                                GCancellable        *cancellable,
+                                                gpointer             user_data);
+GPtrArray *gitlab_client_get_project_summaries_finish (GitlabClient  *self,
+                                                       GAsyncResult  *res,
+                                                       GPtrArray    **issues,
+                                                       GError       **error);
+void gitlab_client_sync_projects_async (GitlabClient        *self,
+                                        GitlabProjectQuery  *query,
+                                        GitlabSyncFlags      flags,
+                                        GAsyncReadyCallback  callback,
+                                        GCancellable        *cancellable,
+                                        gpointer             user_data);
+gboolean gitlab_client_sync_projects_finish (GitlabClient  *self,
+                                             GAsyncResult  *res,
+                                             GPtrArray    **added,
+                                             GPtrArray    **changed,
+                                             GPtrArray    **removed,
+                                             GError       **error);
+void gitlab_client_sync_project_issues_async (GitlabClient        *self,
+                                              GitlabProject       *project,
+                                              GitlabSyncFlags      flags,
+                                              GAsyncReadyCallback  callback,
+                                              GCancellable        *cancellable,
+                                              gpointer             user_data);
+gboolean gitlab_client_sync_project_issues_finish (GitlabClient  *self,
+                                                   GAsyncResult  *res,
+                                                   GPtrArray    **added,
+                                                   GPtrArray    **changed,
+                                                   GPtrArray    **removed,
+                                                   GError       **error);
+void gitlab_client_download_archive_async (GitlabClient        *self,
+                                           GitlabProject       *project,
+                                           const gchar         *sha,
+                                           GOutputStream       *stream,
+                                           goffset              offset,
+                                           GitlabProgressFunc   progress_func,
+                                           gpointer             progress_data,
+                                           GDestroyNotify       progress_notify,
+                                           GAsyncReadyCallback  callback,
+                                           GCancellable        *cancellable,
+                                           gpointer             user_data);
+goffset gitlab_client_download_archive_finish (GitlabClient  *self,
+                                               GAsyncResult  *res,
+                                               GError       **error);
+void gitlab_client_download_archive_to_file_async (GitlabClient        *self,
+                                                   GitlabProject       *project,
+                                                   const gchar         *sha,
+                                                   GFile               *file,
+                                                   GitlabProgressFunc   progress_func,
+                                                   gpointer             progress_data,
+                                                   GDestroyNotify       progress_notify,
+                                                   GAsyncReadyCallback  callback,
+                                                   GCancellable        *cancellable,
+                                                   gpointer             user_data);
+goffset gitlab_client_download_archive_to_file_finish (GitlabClient  *self,
+                                                       GAsyncResult  *res,
+                                                       GError       **error);
+void gitlab_client_download_archives_async (GitlabClient        *self,
+                                            GPtrArray           *projects,
+                                            GFile               *directory,
+                                            GAsyncReadyCallback  callback,
+                                            GCancellable        *cancellable,
+                                            gpointer             user_data);
+gboolean gitlab_client_download_archives_finish (GitlabClient  *self,
+                                                 GAsyncResult  *res,
+                                                 GPtrArray    **errors,
+                                                 GError       **error);
+
+void gitlab_project_load_avatar_async (GitlabProject       *project,
+                                       GitlabClient        *client,
+                                       GAsyncReadyCallback  callback,
+                                       GCancellable        *cancellable,
+                                       gpointer             user_data);
+GBytes *gitlab_project_load_avatar_finish (GitlabProject  *project,
+                                           GAsyncResult   *res,
+                                           GError        **error);
+
 G_END_DECLS
@@ -0,0 +1,41 @@
+/* gitlab-disk-cache-private.h
+ *
+ * Copyright (C) 2017 Günther Wutz <info@gunibert.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+gchar  *_gitlab_disk_cache_get_path       (const gchar  *key);
+gchar  *_gitlab_disk_cache_get_image_path (const gchar  *key);
+GList  *_gitlab_disk_cache_load_projects  (const gchar  *path,
+                                           GError      **error);
+void    _gitlab_disk_cache_save_projects  (const gchar  *path,
+                                           GList        *projects);
+GBytes *_gitlab_disk_cache_load_image     (const gchar  *path,
+                                           gchar       **etag,
+                                           gchar       **last_modified,
+                                           GError      **error);
+void    _gitlab_disk_cache_save_image     (const gchar  *path,
+                                           const gchar  *etag,
+                                           const gchar  *last_modified,
+                                           GBytes       *bytes);
+void    _gitlab_disk_cache_prune_images   (guint64       max_size);
+
+G_END_DECLS
@@ -0,0 +1,351 @@
+/* gitlab-disk-cache.c
+ *
+ * Copyright (C) 2017 Günther Wutz <info@gunibert.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Project listings are persisted as a single GVariant of type
+ * GITLAB_DISK_CACHE_PROJECTS_TYPE below the user cache dir. Loading maps
+ * the file and reads the records straight out of the mapping, which keeps
+ * a cold start independent of the network. Images are kept the same way
+ * in a directory of their own, one file each together with the ETag and
+ * Last-Modified they came with. That directory is pruned to a size, least
+ * recently written images first.
+ */
+
+#include "gitlab-disk-cache-private.h"
+#include "gitlab-project.h"
+#include <gio/gio.h>
+
+#define GITLAB_DISK_CACHE_VERSION 2
+#define GITLAB_DISK_CACHE_PROJECTS_TYPE G_VARIANT_TYPE ("(ua(imsmsmsmsmsii))")
+#define GITLAB_DISK_CACHE_IMAGE_TYPE G_VARIANT_TYPE ("(umsmsay)")
+
+/*
+ * The key contains a digest of the token already, hash it once more to
+ * get a sane file name.
+ */
+gchar *
+_gitlab_disk_cache_get_path (const gchar *key)
+{
+	g_autofree gchar *digest = NULL;
+	g_autofree gchar *basename = NULL;
+
+	digest = g_compute_checksum_for_string (G_CHECKSUM_SHA256, key, -1);
+	basename = g_strconcat (digest, ".gvariant", NULL);
+
+	return g_build_filename (g_get_user_cache_dir (), "gitlab-glib", basename, NULL);
+}
+
+gchar *
+_gitlab_disk_cache_get_image_path (const gchar *key)
+{
+	g_autofree gchar *digest = NULL;
+	g_autofree gchar *basename = NULL;
+
+	digest = g_compute_checksum_for_string (G_CHECKSUM_SHA256, key, -1);
+	basename = g_strconcat (digest, ".gvariant", NULL);
+
+	return g_build_filename (g_get_user_cache_dir (), "gitlab-glib", "images", basename, NULL);
+}
+
+GList *
+_gitlab_disk_cache_load_projects (const gchar  *path,
+                                  GError      **error)
+{
+	g_autoptr(GMappedFile) file = NULL;
+	g_autoptr(GBytes) bytes = NULL;
+	g_autoptr(GVariant) variant = NULL;
+	g_autoptr(GVariantIter) iter = NULL;
+	GList *list = NULL;
+	guint32 version;
+	gint id;
+	const gchar *name;
+	const gchar *description;
+	const gchar *avatar;
+	const gchar *http_url_to_repo;
+	const gchar *last_activity_at;
+	gint star_count;
+	gint open_issues_count;
+
+	file = g_mapped_file_new (path, FALSE, error);
+	if (file == NULL)
+		return NULL;
+
+	bytes = g_mapped_file_get_bytes (file);
+	variant = g_variant_new_from_bytes (GITLAB_DISK_CACHE_PROJECTS_TYPE, bytes, FALSE);
+	g_variant_get (variant, "(ua(imsmsmsmsmsii))", &version, &iter);
+
+	if (version != GITLAB_DISK_CACHE_VERSION) {
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+		             "Unsupported cache version %u in %s", version, path);
+		return NULL;
+	}
+
+	while (g_variant_iter_next (iter, "(i&ms&ms&ms&ms&msii)",
+	                            &id, &name, &description, &avatar, &http_url_to_repo,
+	                            &last_activity_at, &star_count, &open_issues_count)) {
+		GitlabProject *project = g_object_new (GITLAB_TYPE_PROJECT,
+		                                       "id", id,
+		                                       "name", name,
+		                                       "description", description,
+		                                       "avatar", avatar,
+		                                       "http-url-to-repo", http_url_to_repo,
+		                                       "last-activity-at", last_activity_at,
+		                                       "star-count", star_count,
+		                                       "open-issues-count", open_issues_count,
+		                                       NULL);
+		list = g_list_prepend (list, project);
+	}
+
+	return g_list_reverse (list);
+}
+
+typedef struct
+{
+	gchar  *path;
+	GBytes *bytes;
+} GitlabDiskCacheWrite;
+
+static void
+gitlab_disk_cache_write_free (gpointer data)
+{
+	GitlabDiskCacheWrite *job = data;
+
+	g_free (job->path);
+	g_bytes_unref (job->bytes);
+	g_free (job);
+}
+
+static void
+gitlab_disk_cache_write_thread (GTask        *task,
+                                gpointer      source_object,
+                                gpointer      task_data,
+                                GCancellable *cancellable)
+{
+	GitlabDiskCacheWrite *job = task_data;
+	g_autoptr(GFile) file = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autofree gchar *dir = NULL;
+
+	dir = g_path_get_dirname (job->path);
+	if (g_mkdir_with_parents (dir, 0700) != 0) {
+		g_debug ("Failed to create %s", dir);
+		g_task_return_boolean (task, FALSE);
+		return;
+	}
+
+	file = g_file_new_for_path (job->path);
+	if (!g_file_replace_contents (file,
+	                              g_bytes_get_data (job->bytes, NULL),
+	                              g_bytes_get_size (job->bytes),
+	                              NULL,
+	                              FALSE,
+	                              G_FILE_CREATE_PRIVATE | G_FILE_CREATE_REPLACE_DESTINATION,
+	                              NULL,
+	                              cancellable,
+	                              &error))
+		g_debug ("Failed to write cache file: %s", error->message);
+
+	g_task_return_boolean (task, error == NULL);
+}
+
+/*
+ * Writes @variant to @path in a thread, consuming a floating ref. The
+ * directory is created there too, the cache dir may be on a slow or
+ * remote file system.
+ */
+static void
+gitlab_disk_cache_write (const gchar *path,
+                         GVariant    *variant)
+{
+	g_autoptr(GTask) task = g_task_new (NULL, NULL, NULL, NULL);
+	GitlabDiskCacheWrite *job;
+
+	g_variant_ref_sink (variant);
+
+	job = g_new0 (GitlabDiskCacheWrite, 1);
+	job->path = g_strdup (path);
+	job->bytes = g_variant_get_data_as_bytes (variant);
+	g_variant_unref (variant);
+
+	g_task_set_source_tag (task, gitlab_disk_cache_write);
+	g_task_set_task_data (task, job, gitlab_disk_cache_write_free);
+	g_task_run_in_thread (task, gitlab_disk_cache_write_thread);
+}
+
+void
+_gitlab_disk_cache_save_projects (const gchar *path,
+                                  GList       *projects)
+{
+	GVariantBuilder builder;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(imsmsmsmsmsii)"));
+	for (GList *l = projects; l != NULL; l = l->next) {
+		GitlabProject *project = l->data;
+
+		g_variant_builder_add (&builder, "(imsmsmsmsmsii)",
+		                       gitlab_project_get_id (project),
+		                       gitlab_project_get_name (project),
+		                       gitlab_project_get_description (project),
+		                       gitlab_project_get_avatar (project),
+		                       gitlab_project_get_http_url_to_repo (project),
+		                       gitlab_project_get_last_activity_at (project),
+		                       gitlab_project_get_star_count (project),
+		                       gitlab_project_get_open_issues_count (project));
+	}
+	gitlab_disk_cache_write (path,
+	                         g_variant_new ("(ua(imsmsmsmsmsii))",
+	                                        GITLAB_DISK_CACHE_VERSION,
+	                                        &builder));
+}
+
+/*
+ * Loads the image cached at @path together with the validators it was
+ * served with. The bytes point into the mapped file.
+ */
+GBytes *
+_gitlab_disk_cache_load_image (const gchar  *path,
+                               gchar       **etag,
+                               gchar       **last_modified,
+                               GError      **error)
+{
+	g_autoptr(GMappedFile) file = NULL;
+	g_autoptr(GBytes) bytes = NULL;
+	g_autoptr(GVariant) variant = NULL;
+	g_autoptr(GVariant) data = NULL;
+	guint32 version;
+
+	file = g_mapped_file_new (path, FALSE, error);
+	if (file == NULL)
+		return NULL;
+
+	bytes = g_mapped_file_get_bytes (file);
+	variant = g_variant_new_from_bytes (GITLAB_DISK_CACHE_IMAGE_TYPE, bytes, FALSE);
+	g_variant_get (variant, "(umsms@ay)", &version, etag, last_modified, &data);
+
+	if (version != GITLAB_DISK_CACHE_VERSION) {
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+		             "Unsupported cache version %u in %s", version, path);
+		g_clear_pointer (etag, g_free);
+		g_clear_pointer (last_modified, g_free);
+		return NULL;
+	}
+
+	return g_variant_get_data_as_bytes (data);
+}
+
+void
+_gitlab_disk_cache_save_image (const gchar *path,
+                               const gchar *etag,
+                               const gchar *last_modified,
+                               GBytes      *bytes)
+{
+	GVariant *data;
+
+	data = g_variant_new_from_bytes (G_VARIANT_TYPE_BYTESTRING, bytes, TRUE);
+	gitlab_disk_cache_write (path,
+	                         g_variant_new ("(umsms@ay)",
+	                                        GITLAB_DISK_CACHE_VERSION,
+	                                        etag,
+	                                        last_modified,
+	                                        data));
+}
+
+typedef struct
+{
+	GFile   *file;
+	guint64  size;
+	guint64  modified;
+} GitlabDiskCacheImage;
+
+static gint
+gitlab_disk_cache_image_compare (gconstpointer a,
+                                 gconstpointer b)
+{
+	const GitlabDiskCacheImage *x = a;
+	const GitlabDiskCacheImage *y = b;
+
+	return x->modified < y->modified ? -1 : x->modified > y->modified;
+}
+
+static void
+gitlab_disk_cache_prune_thread (GTask        *task,
+                                gpointer      source_object,
+                                gpointer      task_data,
+                                GCancellable *cancellable)
+{
+	guint64 max_size = *(guint64 *) task_data;
+	g_autofree gchar *path = NULL;
+	g_autoptr(GFile) dir = NULL;
+	g_autoptr(GFileEnumerator) enumerator = NULL;
+	g_autoptr(GArray) images = NULL;
+	guint64 total = 0;
+	GFileInfo *info;
+
+	path = g_build_filename (g_get_user_cache_dir (), "gitlab-glib", "images", NULL);
+	dir = g_file_new_for_path (path);
+	enumerator = g_file_enumerate_children (dir,
+	                                        G_FILE_ATTRIBUTE_STANDARD_NAME ","
+	                                        G_FILE_ATTRIBUTE_STANDARD_SIZE ","
+	                                        G_FILE_ATTRIBUTE_TIME_MODIFIED,
+	                                        G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+	                                        cancellable,
+	                                        NULL);
+	if (enumerator == NULL) {
+		g_task_return_boolean (task, TRUE);
+		return;
+	}
+
+	images = g_array_new (FALSE, FALSE, sizeof (GitlabDiskCacheImage));
+	while ((info = g_file_enumerator_next_file (enumerator, cancellable, NULL)) != NULL) {
+		GitlabDiskCacheImage image;
+
+		image.file = g_file_get_child (dir, g_file_info_get_name (info));
+		image.size = g_file_info_get_size (info);
+		image.modified = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+		g_array_append_val (images, image);
+		total += image.size;
+
+		g_object_unref (info);
+	}
+
+	g_array_sort (images, gitlab_disk_cache_image_compare);
+
+	for (guint i = 0; i < images->len; i++) {
+		GitlabDiskCacheImage *image = &g_array_index (images, GitlabDiskCacheImage, i);
+
+		if (total > max_size && g_file_delete (image->file, cancellable, NULL))
+			total -= image->size;
+		g_object_unref (image->file);
+	}
+
+	g_task_return_boolean (task, TRUE);
+}
+
+/*
+ * Deletes the least recently written images in a thread until the images
+ * on disk take at most @max_size bytes.
+ */
+void
+_gitlab_disk_cache_prune_images (guint64 max_size)
+{
+	g_autoptr(GTask) task = g_task_new (NULL, NULL, NULL, NULL);
+
+	g_task_set_source_tag (task, _gitlab_disk_cache_prune_images);
+	g_task_set_task_data (task, g_memdup (&max_size, sizeof max_size), g_free);
+	g_task_run_in_thread (task, gitlab_disk_cache_prune_thread);
+}
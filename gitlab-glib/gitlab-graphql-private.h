@@ -0,0 +1,38 @@
+/* gitlab-graphql-private.h
+ *
+ * Copyright (C) 2017 Günther Wutz <info@gunibert.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* The number of projects asked for in one query, see gitlab-graphql.c */
+#define GITLAB_GRAPHQL_MAX_PROJECTS 20
+/* The number of issues asked for per project, see gitlab-graphql.c */
+#define GITLAB_GRAPHQL_MAX_ISSUES 10
+
+gchar    *_gitlab_graphql_get_url             (const gchar  *baseurl);
+gchar    *_gitlab_graphql_build_summaries     (const gint   *ids,
+                                               guint         n_ids,
+                                               guint         n_issues);
+gboolean  _gitlab_graphql_parse_summaries     (GBytes       *bytes,
+                                               GHashTable   *projects,
+                                               GPtrArray    *issues,
+                                               GError      **error);
+
+G_END_DECLS
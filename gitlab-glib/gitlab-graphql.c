@@ -0,0 +1,281 @@
+/* gitlab-graphql.c
+ *
+ * Copyright (C) 2017 Günther Wutz <info@gunibert.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Queries for the GraphQL API, which answers what takes one REST request
+ * per project and resource in a single round trip. Each query asks for
+ * the fields of up to GITLAB_GRAPHQL_MAX_PROJECTS projects together with
+ * their recent open issues. The server rates a query by the number of
+ * nodes it may return, so larger batches would be rejected for being too
+ * complex once issues are included. That only holds while each project
+ * asks for at most GITLAB_GRAPHQL_MAX_ISSUES issues.
+ */
+
+#include "gitlab-graphql-private.h"
+#include "gitlab-error.h"
+#include "gitlab-issue.h"
+#include "gitlab-project.h"
+#include <json-glib/json-glib.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GITLAB_GRAPHQL_PROJECT_GID "gid://gitlab/Project/"
+
+static const gchar *summaries_query =
+	"query($ids: [ID!], $issues: Int) {"
+	"  projects(ids: $ids, first: " G_STRINGIFY (GITLAB_GRAPHQL_MAX_PROJECTS) ") {"
+	"    nodes {"
+	"      id nameWithNamespace description avatarUrl httpUrlToRepo"
+	"      lastActivityAt starCount openIssuesCount"
+	"      issues(state: opened, sort: UPDATED_DESC, first: $issues) {"
+	"        nodes { id iid title description state webUrl updatedAt }"
+	"      }"
+	"    }"
+	"  }"
+	"}";
+
+/*
+ * GraphQL lives next to the versioned REST API, the base url of the client
+ * usually ends in /api/v4.
+ */
+gchar *
+_gitlab_graphql_get_url (const gchar *baseurl)
+{
+	const gchar *api = g_strrstr (baseurl, "/api/v");
+	g_autofree gchar *root = NULL;
+
+	if (api == NULL)
+		return g_strconcat (baseurl, "/api/graphql", NULL);
+
+	root = g_strndup (baseurl, api - baseurl);
+	return g_strconcat (root, "/api/graphql", NULL);
+}
+
+/*
+ * Returns the body of the query for the projects in @ids, which must be
+ * at most GITLAB_GRAPHQL_MAX_PROJECTS, with up to @n_issues issues each,
+ * at most GITLAB_GRAPHQL_MAX_ISSUES.
+ */
+gchar *
+_gitlab_graphql_build_summaries (const gint *ids,
+                                 guint       n_ids,
+                                 guint       n_issues)
+{
+	g_autoptr(JsonBuilder) builder = json_builder_new ();
+	g_autoptr(JsonGenerator) generator = json_generator_new ();
+	g_autoptr(JsonNode) root = NULL;
+
+	g_assert (n_ids <= GITLAB_GRAPHQL_MAX_PROJECTS);
+	g_assert (n_issues <= GITLAB_GRAPHQL_MAX_ISSUES);
+
+	json_builder_begin_object (builder);
+	json_builder_set_member_name (builder, "query");
+	json_builder_add_string_value (builder, summaries_query);
+	json_builder_set_member_name (builder, "variables");
+	json_builder_begin_object (builder);
+	json_builder_set_member_name (builder, "ids");
+	json_builder_begin_array (builder);
+	for (guint i = 0; i < n_ids; i++) {
+		g_autofree gchar *gid = g_strdup_printf (GITLAB_GRAPHQL_PROJECT_GID "%d", ids[i]);
+
+		json_builder_add_string_value (builder, gid);
+	}
+	json_builder_end_array (builder);
+	json_builder_set_member_name (builder, "issues");
+	json_builder_add_int_value (builder, n_issues);
+	json_builder_end_object (builder);
+	json_builder_end_object (builder);
+
+	root = json_builder_get_root (builder);
+	json_generator_set_root (generator, root);
+
+	return json_generator_to_data (generator, NULL);
+}
+
+static const gchar *
+gitlab_graphql_get_string (JsonObject  *object,
+                           const gchar *member)
+{
+	JsonNode *node = json_object_get_member (object, member);
+
+	if (node == NULL || json_node_get_value_type (node) != G_TYPE_STRING)
+		return NULL;
+
+	return json_node_get_string (node);
+}
+
+static gint
+gitlab_graphql_get_int (JsonObject  *object,
+                        const gchar *member)
+{
+	JsonNode *node = json_object_get_member (object, member);
+
+	if (node == NULL || !JSON_NODE_HOLDS_VALUE (node))
+		return 0;
+
+	return json_node_get_int (node);
+}
+
+/* Ids are global, like gid://gitlab/Issue/42, and iids strings */
+static gint
+gitlab_graphql_get_id (JsonObject  *object,
+                       const gchar *member)
+{
+	const gchar *value = gitlab_graphql_get_string (object, member);
+	const gchar *slash;
+
+	if (value == NULL)
+		return 0;
+
+	slash = strrchr (value, '/');
+	return atoi (slash ? slash + 1 : value);
+}
+
+static JsonObject *
+gitlab_graphql_get_element (JsonArray *array,
+                            guint      index)
+{
+	JsonNode *node;
+
+	if (index >= json_array_get_length (array))
+		return NULL;
+
+	node = json_array_get_element (array, index);
+	if (!JSON_NODE_HOLDS_OBJECT (node))
+		return NULL;
+
+	return json_node_get_object (node);
+}
+
+/* Returns the array of nodes of the connection @member, or %NULL */
+static JsonArray *
+gitlab_graphql_get_nodes (JsonObject  *object,
+                          const gchar *member)
+{
+	JsonNode *node = json_object_get_member (object, member);
+
+	if (node == NULL || !JSON_NODE_HOLDS_OBJECT (node))
+		return NULL;
+
+	node = json_object_get_member (json_node_get_object (node), "nodes");
+	if (node == NULL || !JSON_NODE_HOLDS_ARRAY (node))
+		return NULL;
+
+	return json_node_get_array (node);
+}
+
+static void
+gitlab_graphql_parse_issues (JsonArray *nodes,
+                             gint       project_id,
+                             GPtrArray *issues)
+{
+	for (guint i = 0; nodes != NULL && i < json_array_get_length (nodes); i++) {
+		JsonObject *object = gitlab_graphql_get_element (nodes, i);
+
+		if (object == NULL)
+			continue;
+
+		g_ptr_array_add (issues,
+		                 g_object_new (GITLAB_TYPE_ISSUE,
+		                               "id", gitlab_graphql_get_id (object, "id"),
+		                               "iid", gitlab_graphql_get_id (object, "iid"),
+		                               "project-id", project_id,
+		                               "title", gitlab_graphql_get_string (object, "title"),
+		                               "description", gitlab_graphql_get_string (object, "description"),
+		                               "state", gitlab_graphql_get_string (object, "state"),
+		                               "web-url", gitlab_graphql_get_string (object, "webUrl"),
+		                               "updated-at", gitlab_graphql_get_string (object, "updatedAt"),
+		                               NULL));
+	}
+}
+
+/*
+ * Parses the answer to a query of _gitlab_graphql_build_summaries(). Each
+ * project is inserted into @projects by id, its issues are added to
+ * @issues. A response with errors but no data fails with the first error,
+ * partial data is taken as it is.
+ */
+gboolean
+_gitlab_graphql_parse_summaries (GBytes      *bytes,
+                                 GHashTable  *projects,
+                                 GPtrArray   *issues,
+                                 GError     **error)
+{
+	g_autoptr(JsonParser) parser = json_parser_new ();
+	g_autoptr(GError) parse_error = NULL;
+	JsonObject *root;
+	JsonObject *data;
+	JsonObject *first = NULL;
+	JsonArray *nodes;
+	JsonNode *node;
+	const gchar *message;
+	gsize length;
+	const gchar *body = g_bytes_get_data (bytes, &length);
+
+	if (!json_parser_load_from_data (parser, body, length, &parse_error)) {
+		g_set_error (error, GITLAB_ERROR, GITLAB_ERROR_PARSE, "%s", parse_error->message);
+		return FALSE;
+	}
+
+	if (!JSON_NODE_HOLDS_OBJECT (json_parser_get_root (parser))) {
+		g_set_error (error, GITLAB_ERROR, GITLAB_ERROR_PARSE, "Expected a GraphQL response");
+		return FALSE;
+	}
+
+	root = json_node_get_object (json_parser_get_root (parser));
+	node = json_object_get_member (root, "data");
+	data = node && JSON_NODE_HOLDS_OBJECT (node) ? json_node_get_object (node) : NULL;
+
+	if (data == NULL) {
+		node = json_object_get_member (root, "errors");
+		if (node && JSON_NODE_HOLDS_ARRAY (node))
+			first = gitlab_graphql_get_element (json_node_get_array (node), 0);
+		message = first ? gitlab_graphql_get_string (first, "message") : NULL;
+
+		g_set_error (error, GITLAB_ERROR, GITLAB_ERROR_GRAPHQL,
+		             "%s", message ? message : "Response without data");
+		return FALSE;
+	}
+
+	nodes = gitlab_graphql_get_nodes (data, "projects");
+	for (guint i = 0; nodes != NULL && i < json_array_get_length (nodes); i++) {
+		JsonObject *object = gitlab_graphql_get_element (nodes, i);
+		GitlabProject *project;
+		gint id;
+
+		if (object == NULL)
+			continue;
+
+		id = gitlab_graphql_get_id (object, "id");
+		project = g_object_new (GITLAB_TYPE_PROJECT,
+		                        "id", id,
+		                        "name", gitlab_graphql_get_string (object, "nameWithNamespace"),
+		                        "description", gitlab_graphql_get_string (object, "description"),
+		                        "avatar", gitlab_graphql_get_string (object, "avatarUrl"),
+		                        "http-url-to-repo", gitlab_graphql_get_string (object, "httpUrlToRepo"),
+		                        "last-activity-at", gitlab_graphql_get_string (object, "lastActivityAt"),
+		                        "star-count", gitlab_graphql_get_int (object, "starCount"),
+		                        "open-issues-count", gitlab_graphql_get_int (object, "openIssuesCount"),
+		                        NULL);
+		g_hash_table_insert (projects, GINT_TO_POINTER (id), project);
+
+		gitlab_graphql_parse_issues (gitlab_graphql_get_nodes (object, "issues"), id, issues);
+	}
+
+	return TRUE;
+}
@@ -0,0 +1,155 @@
+/* gitlab-image-cache.c
+ *
+ * Copyright (C) 2017 Günther Wutz <info@gunibert.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Keeps downloaded images in memory, bounded by their total size. The
+ * least recently used image is dropped first, which keeps the images of
+ * a scrolled list around while the ones scrolled past long ago go.
+ */
+
+#include "gitlab-image-cache-private.h"
+
+struct _GitlabImageCache
+{
+	GMutex      mutex;
+	GHashTable *entries;
+	GQueue      lru;
+	gsize       size;
+	gsize       max_size;
+};
+
+typedef struct
+{
+	GList   link;
+	gchar  *url;
+	GBytes *bytes;
+} GitlabImageCacheEntry;
+
+static void
+gitlab_image_cache_entry_free (gpointer data)
+{
+	GitlabImageCacheEntry *entry = data;
+
+	g_free (entry->url);
+	g_bytes_unref (entry->bytes);
+	g_free (entry);
+}
+
+GitlabImageCache *
+_gitlab_image_cache_new (gsize max_size)
+{
+	GitlabImageCache *self = g_new0 (GitlabImageCache, 1);
+
+	g_mutex_init (&self->mutex);
+	g_queue_init (&self->lru);
+	self->max_size = max_size;
+	self->entries = g_hash_table_new_full (g_str_hash, g_str_equal,
+	                                       NULL, gitlab_image_cache_entry_free);
+
+	return self;
+}
+
+void
+_gitlab_image_cache_free (GitlabImageCache *self)
+{
+	if (self == NULL)
+		return;
+
+	g_hash_table_unref (self->entries);
+	g_mutex_clear (&self->mutex);
+	g_free (self);
+}
+
+void
+_gitlab_image_cache_clear (GitlabImageCache *self)
+{
+	g_mutex_lock (&self->mutex);
+	g_queue_init (&self->lru);
+	g_hash_table_remove_all (self->entries);
+	self->size = 0;
+	g_mutex_unlock (&self->mutex);
+}
+
+/* Called with the mutex held */
+static void
+gitlab_image_cache_remove_locked (GitlabImageCache      *self,
+                                  GitlabImageCacheEntry *entry)
+{
+	g_queue_unlink (&self->lru, &entry->link);
+	self->size -= g_bytes_get_size (entry->bytes);
+	g_hash_table_remove (self->entries, entry->url);
+}
+
+/*
+ * Returns a new reference on the image of @url and marks it as the most
+ * recently used, or %NULL.
+ */
+GBytes *
+_gitlab_image_cache_lookup (GitlabImageCache *self,
+                            const gchar      *url)
+{
+	GitlabImageCacheEntry *entry;
+	GBytes *bytes = NULL;
+
+	g_mutex_lock (&self->mutex);
+	entry = g_hash_table_lookup (self->entries, url);
+	if (entry != NULL) {
+		g_queue_unlink (&self->lru, &entry->link);
+		g_queue_push_head_link (&self->lru, &entry->link);
+		bytes = g_bytes_ref (entry->bytes);
+	}
+	g_mutex_unlock (&self->mutex);
+
+	return bytes;
+}
+
+/*
+ * Adds @bytes as the image of @url, dropping the least recently used
+ * images until the cache fits again. An image larger than the whole
+ * cache is not kept.
+ */
+void
+_gitlab_image_cache_insert (GitlabImageCache *self,
+                            const gchar      *url,
+                            GBytes           *bytes)
+{
+	GitlabImageCacheEntry *entry;
+	gsize size = g_bytes_get_size (bytes);
+
+	if (size > self->max_size)
+		return;
+
+	g_mutex_lock (&self->mutex);
+
+	entry = g_hash_table_lookup (self->entries, url);
+	if (entry != NULL)
+		gitlab_image_cache_remove_locked (self, entry);
+
+	while (self->size + size > self->max_size)
+		gitlab_image_cache_remove_locked (self, g_queue_peek_tail_link (&self->lru)->data);
+
+	entry = g_new0 (GitlabImageCacheEntry, 1);
+	entry->link.data = entry;
+	entry->url = g_strdup (url);
+	entry->bytes = g_bytes_ref (bytes);
+	g_queue_push_head_link (&self->lru, &entry->link);
+	g_hash_table_insert (self->entries, entry->url, entry);
+	self->size += size;
+
+	g_mutex_unlock (&self->mutex);
+}
@@ -0,0 +1,28 @@
+/* gitlab-issue-private.h
+ *
+ * Copyright (C) 2017 Günther Wutz <info@gunibert.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include "gitlab-issue.h"
+#include "gitlab-json-scanner-private.h"
+
+G_BEGIN_DECLS
+
+GitlabIssue *_gitlab_issue_new_from_scanner (GitlabJsonScanner  *scanner,
+                                             GError            **error);
+
+G_END_DECLS
@@ -0,0 +1,292 @@
+/* gitlab-issue.c
+ *
+ * Copyright (C) 2017 Günther Wutz <info@gunibert.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "gitlab-issue.h"
+#include "gitlab-issue-private.h"
+#include "gitlab-error.h"
+
+struct _GitlabIssue
+{
+	GObject parent_instance;
+
+	gint id;
+	gint iid;
+	gint project_id;
+	gchar *title;
+	gchar *description;
+	gchar *state;
+	gchar *web_url;
+	gchar *updated_at;
+};
+
+G_DEFINE_TYPE (GitlabIssue, gitlab_issue, G_TYPE_OBJECT)
+
+enum {
+	PROP_0,
+	PROP_ID,
+	PROP_IID,
+	PROP_PROJECT_ID,
+	PROP_TITLE,
+	PROP_DESCRIPTION,
+	PROP_STATE,
+	PROP_WEB_URL,
+	PROP_UPDATED_AT,
+	N_PROPS
+};
+
+static GParamSpec *properties [N_PROPS];
+
+/* The members of the issue json object, indexed by property */
+static const gchar *member_names [N_PROPS] = {
+	[PROP_ID] = "id",
+	[PROP_IID] = "iid",
+	[PROP_PROJECT_ID] = "project_id",
+	[PROP_TITLE] = "title",
+	[PROP_DESCRIPTION] = "description",
+	[PROP_STATE] = "state",
+	[PROP_WEB_URL] = "web_url",
+	[PROP_UPDATED_AT] = "updated_at",
+};
+
+static gchar **
+gitlab_issue_get_string_field (GitlabIssue *self,
+                               guint        prop_id)
+{
+	switch (prop_id)
+	  {
+		case PROP_TITLE:
+			return &self->title;
+		case PROP_DESCRIPTION:
+			return &self->description;
+		case PROP_STATE:
+			return &self->state;
+		case PROP_WEB_URL:
+			return &self->web_url;
+		case PROP_UPDATED_AT:
+			return &self->updated_at;
+		default:
+			return NULL;
+	  }
+}
+
+static gint *
+gitlab_issue_get_int_field (GitlabIssue *self,
+                            guint        prop_id)
+{
+	switch (prop_id)
+	  {
+		case PROP_ID:
+			return &self->id;
+		case PROP_IID:
+			return &self->iid;
+		case PROP_PROJECT_ID:
+			return &self->project_id;
+		default:
+			return NULL;
+	  }
+}
+
+/*
+ * Decodes the members of an issue object straight from @scanner, which is
+ * positioned right after the opening brace.
+ */
+GitlabIssue *
+_gitlab_issue_new_from_scanner (GitlabJsonScanner  *scanner,
+                                GError            **error)
+{
+	g_autoptr(GitlabIssue) self = g_object_new (GITLAB_TYPE_ISSUE, NULL);
+	GitlabJsonToken token;
+
+	while ((token = _gitlab_json_scanner_next (scanner)) == GITLAB_JSON_TOKEN_STRING) {
+		guint prop_id = PROP_0;
+		gchar **string_field;
+		gint *int_field;
+
+		for (guint i = PROP_ID; i < N_PROPS; i++) {
+			if (_gitlab_json_scanner_string_equal (scanner, member_names[i])) {
+				prop_id = i;
+				break;
+			}
+		}
+
+		string_field = gitlab_issue_get_string_field (self, prop_id);
+		int_field = gitlab_issue_get_int_field (self, prop_id);
+
+		token = _gitlab_json_scanner_next (scanner);
+
+		if (int_field != NULL && token == GITLAB_JSON_TOKEN_NUMBER) {
+			*int_field = _gitlab_json_scanner_get_int (scanner);
+		} else if (string_field != NULL && token == GITLAB_JSON_TOKEN_STRING) {
+			g_free (*string_field);
+			*string_field = _gitlab_json_scanner_dup_string (scanner);
+		} else if (!_gitlab_json_scanner_skip_value (scanner, token)) {
+			token = GITLAB_JSON_TOKEN_ERROR;
+			break;
+		}
+	}
+
+	if (token != GITLAB_JSON_TOKEN_END_OBJECT) {
+		g_set_error (error, GITLAB_ERROR, GITLAB_ERROR_PARSE,
+		             "Malformed issue at offset %" G_GSIZE_FORMAT ": %s",
+		             scanner->pos,
+		             scanner->error_message ? scanner->error_message : "Expected a member name");
+		return NULL;
+	}
+
+	return g_steal_pointer (&self);
+}
+
+static void
+gitlab_issue_finalize (GObject *object)
+{
+	GitlabIssue *self = (GitlabIssue *)object;
+
+	g_free (self->title);
+	g_free (self->description);
+	g_free (self->state);
+	g_free (self->web_url);
+	g_free (self->updated_at);
+
+	G_OBJECT_CLASS (gitlab_issue_parent_class)->finalize (object);
+}
+
+static void
+gitlab_issue_get_property (GObject    *object,
+                           guint       prop_id,
+                           GValue     *value,
+                           GParamSpec *pspec)
+{
+	GitlabIssue *self = GITLAB_ISSUE (object);
+	gchar **string_field = gitlab_issue_get_string_field (self, prop_id);
+	gint *int_field = gitlab_issue_get_int_field (self, prop_id);
+
+	if (string_field != NULL)
+		g_value_set_string (value, *string_field);
+	else if (int_field != NULL)
+		g_value_set_int (value, *int_field);
+	else
+		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+}
+
+static void
+gitlab_issue_set_property (GObject      *object,
+                           guint         prop_id,
+                           const GValue *value,
+                           GParamSpec   *pspec)
+{
+	GitlabIssue *self = GITLAB_ISSUE (object);
+	gchar **string_field = gitlab_issue_get_string_field (self, prop_id);
+	gint *int_field = gitlab_issue_get_int_field (self, prop_id);
+
+	if (string_field != NULL) {
+		g_free (*string_field);
+		*string_field = g_value_dup_string (value);
+	} else if (int_field != NULL) {
+		*int_field = g_value_get_int (value);
+	} else {
+		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+	}
+}
+
+static void
+gitlab_issue_class_init (GitlabIssueClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	object_class->finalize = gitlab_issue_finalize;
+	object_class->get_property = gitlab_issue_get_property;
+	object_class->set_property = gitlab_issue_set_property;
+
+	properties[PROP_ID] =
+		g_param_spec_int ("id", "Id", "The unique id of the issue", 0, G_MAXINT, 0, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+	properties[PROP_IID] =
+		g_param_spec_int ("iid", "Iid", "The id of the issue inside its project", 0, G_MAXINT, 0, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+	properties[PROP_PROJECT_ID] =
+		g_param_spec_int ("project-id", "Project-id", "The id of the project of the issue", 0, G_MAXINT, 0, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+	properties[PROP_TITLE] =
+		g_param_spec_string ("title", "Title", "The title of the issue", "", G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+	properties[PROP_DESCRIPTION] =
+		g_param_spec_string ("description", "Description", "The description of the issue", "", G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+	properties[PROP_STATE] =
+		g_param_spec_string ("state", "State", "The state of the issue, opened or closed", "", G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+	properties[PROP_WEB_URL] =
+		g_param_spec_string ("web-url", "Web-url", "The url of the issue in the web interface", "", G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+	properties[PROP_UPDATED_AT] =
+		g_param_spec_string ("updated-at", "Updated-at", "The time of the last change as ISO 8601 string", "", G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+	g_object_class_install_properties (object_class, N_PROPS, properties);
+}
+
+static void
+gitlab_issue_init (GitlabIssue *self)
+{
+}
+
+gint
+gitlab_issue_get_id (GitlabIssue *self)
+{
+	return self->id;
+}
+
+gint
+gitlab_issue_get_iid (GitlabIssue *self)
+{
+	return self->iid;
+}
+
+gint
+gitlab_issue_get_project_id (GitlabIssue *self)
+{
+	return self->project_id;
+}
+
+gchar *
+gitlab_issue_get_title (GitlabIssue *self)
+{
+	return self->title;
+}
+
+gchar *
+gitlab_issue_get_description (GitlabIssue *self)
+{
+	return self->description;
+}
+
+gchar *
+gitlab_issue_get_state (GitlabIssue *self)
+{
+	return self->state;
+}
+
+gchar *
+gitlab_issue_get_web_url (GitlabIssue *self)
+{
+	return self->web_url;
+}
+
+gchar *
+gitlab_issue_get_updated_at (GitlabIssue *self)
+{
+	return self->updated_at;
+}
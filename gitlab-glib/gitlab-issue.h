@@ -0,0 +1,37 @@
+/* gitlab-issue.h
+ *
+ * Copyright (C) 2017 Günther Wutz <info@gunibert.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define GITLAB_TYPE_ISSUE (gitlab_issue_get_type())
+
+G_DECLARE_FINAL_TYPE (GitlabIssue, gitlab_issue, GITLAB, ISSUE, GObject)
+
+gint   gitlab_issue_get_id (GitlabIssue *self);
+gint   gitlab_issue_get_iid (GitlabIssue *self);
+gint   gitlab_issue_get_project_id (GitlabIssue *self);
+gchar *gitlab_issue_get_title (GitlabIssue *self);
+gchar *gitlab_issue_get_description (GitlabIssue *self);
+gchar *gitlab_issue_get_state (GitlabIssue *self);
+gchar *gitlab_issue_get_web_url (GitlabIssue *self);
+gchar *gitlab_issue_get_updated_at (GitlabIssue *self);
+
+G_END_DECLS
@@ -0,0 +1,63 @@
+/* gitlab-json-scanner-private.h
+ *
+ * Copyright (C) 2017 Günther Wutz <info@gunibert.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef enum
+{
+	GITLAB_JSON_TOKEN_ERROR,
+	GITLAB_JSON_TOKEN_EOF,
+	GITLAB_JSON_TOKEN_BEGIN_OBJECT,
+	GITLAB_JSON_TOKEN_END_OBJECT,
+	GITLAB_JSON_TOKEN_BEGIN_ARRAY,
+	GITLAB_JSON_TOKEN_END_ARRAY,
+	GITLAB_JSON_TOKEN_STRING,
+	GITLAB_JSON_TOKEN_NUMBER,
+	GITLAB_JSON_TOKEN_TRUE,
+	GITLAB_JSON_TOKEN_FALSE,
+	GITLAB_JSON_TOKEN_NULL,
+} GitlabJsonToken;
+
+typedef struct
+{
+	const gchar *data;
+	gsize        length;
+	gsize        pos;
+	gsize        token_start;
+	gsize        token_end;
+	const gchar *error_message;
+} GitlabJsonScanner;
+
+void             _gitlab_json_scanner_init         (GitlabJsonScanner *self,
+                                                    const gchar       *data,
+                                                    gsize              length);
+GitlabJsonToken  _gitlab_json_scanner_next         (GitlabJsonScanner *self);
+gboolean         _gitlab_json_scanner_skip_value   (GitlabJsonScanner *self,
+                                                    GitlabJsonToken    token);
+gboolean         _gitlab_json_scanner_string_equal (GitlabJsonScanner *self,
+                                                    const gchar       *str);
+gchar           *_gitlab_json_scanner_dup_string   (GitlabJsonScanner *self);
+void             _gitlab_json_scanner_get_string   (GitlabJsonScanner *self,
+                                                    GString           *out);
+gint64           _gitlab_json_scanner_get_int      (GitlabJsonScanner *self);
+
+G_END_DECLS
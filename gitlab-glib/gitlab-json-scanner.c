@@ -0,0 +1,310 @@
+/* gitlab-json-scanner.c
+ *
+ * Copyright (C) 2017 Günther Wutz <info@gunibert.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * A pull tokenizer for the JSON documents returned by the API. It works on
+ * the raw response buffer and never builds a tree: callers walk the tokens,
+ * decode only the members they care about and skip the rest. Separators
+ * are not validated, "," and ":" are treated like whitespace.
+ */
+
+#include "gitlab-json-scanner-private.h"
+
+#include <string.h>
+
+void
+_gitlab_json_scanner_init (GitlabJsonScanner *self,
+                           const gchar       *data,
+                           gsize              length)
+{
+	memset (self, 0, sizeof *self);
+	self->data = data;
+	self->length = length;
+}
+
+static GitlabJsonToken
+gitlab_json_scanner_error (GitlabJsonScanner *self,
+                           const gchar       *message)
+{
+	self->error_message = message;
+	return GITLAB_JSON_TOKEN_ERROR;
+}
+
+static GitlabJsonToken
+gitlab_json_scanner_literal (GitlabJsonScanner *self,
+                             const gchar       *literal,
+                             GitlabJsonToken    token)
+{
+	gsize len = strlen (literal);
+
+	if (self->length - self->pos < len ||
+	    memcmp (self->data + self->pos, literal, len) != 0)
+		return gitlab_json_scanner_error (self, "Invalid literal");
+
+	self->pos += len;
+	self->token_end = self->pos;
+	return token;
+}
+
+static gboolean
+gitlab_json_scanner_is_number_char (gchar c)
+{
+	return g_ascii_isdigit (c) || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
+
+GitlabJsonToken
+_gitlab_json_scanner_next (GitlabJsonScanner *self)
+{
+	gchar c;
+
+	while (self->pos < self->length) {
+		c = self->data[self->pos];
+		if (c != ' ' && c != '\t' && c != '\n' && c != '\r' && c != ',' && c != ':')
+			break;
+		self->pos++;
+	}
+
+	if (self->pos >= self->length)
+		return GITLAB_JSON_TOKEN_EOF;
+
+	self->token_start = self->pos;
+	c = self->data[self->pos];
+
+	switch (c)
+	  {
+		case '{':
+			self->token_end = ++self->pos;
+			return GITLAB_JSON_TOKEN_BEGIN_OBJECT;
+		case '}':
+			self->token_end = ++self->pos;
+			return GITLAB_JSON_TOKEN_END_OBJECT;
+		case '[':
+			self->token_end = ++self->pos;
+			return GITLAB_JSON_TOKEN_BEGIN_ARRAY;
+		case ']':
+			self->token_end = ++self->pos;
+			return GITLAB_JSON_TOKEN_END_ARRAY;
+		case '"':
+			self->token_start = ++self->pos;
+			while (self->pos < self->length && self->data[self->pos] != '"') {
+				if (self->data[self->pos] == '\\')
+					self->pos++;
+				self->pos++;
+			}
+			if (self->pos >= self->length)
+				return gitlab_json_scanner_error (self, "Unterminated string");
+			self->token_end = self->pos++;
+			return GITLAB_JSON_TOKEN_STRING;
+		case 't':
+			return gitlab_json_scanner_literal (self, "true", GITLAB_JSON_TOKEN_TRUE);
+		case 'f':
+			return gitlab_json_scanner_literal (self, "false", GITLAB_JSON_TOKEN_FALSE);
+		case 'n':
+			return gitlab_json_scanner_literal (self, "null", GITLAB_JSON_TOKEN_NULL);
+		default:
+			if (c != '-' && !g_ascii_isdigit (c))
+				return gitlab_json_scanner_error (self, "Unexpected character");
+			while (self->pos < self->length &&
+			       gitlab_json_scanner_is_number_char (self->data[self->pos]))
+				self->pos++;
+			self->token_end = self->pos;
+			return GITLAB_JSON_TOKEN_NUMBER;
+	  }
+}
+
+/*
+ * Skips the value that starts with @token, including nested objects and
+ * arrays. Returns %FALSE if the document ended or is malformed.
+ */
+gboolean
+_gitlab_json_scanner_skip_value (GitlabJsonScanner *self,
+                                 GitlabJsonToken    token)
+{
+	guint depth;
+
+	switch (token)
+	  {
+		case GITLAB_JSON_TOKEN_BEGIN_OBJECT:
+		case GITLAB_JSON_TOKEN_BEGIN_ARRAY:
+			break;
+		case GITLAB_JSON_TOKEN_STRING:
+		case GITLAB_JSON_TOKEN_NUMBER:
+		case GITLAB_JSON_TOKEN_TRUE:
+		case GITLAB_JSON_TOKEN_FALSE:
+		case GITLAB_JSON_TOKEN_NULL:
+			return TRUE;
+		default:
+			if (self->error_message == NULL)
+				self->error_message = "Expected a value";
+			return FALSE;
+	  }
+
+	for (depth = 1; depth > 0;) {
+		switch (_gitlab_json_scanner_next (self))
+		  {
+			case GITLAB_JSON_TOKEN_BEGIN_OBJECT:
+			case GITLAB_JSON_TOKEN_BEGIN_ARRAY:
+				depth++;
+				break;
+			case GITLAB_JSON_TOKEN_END_OBJECT:
+			case GITLAB_JSON_TOKEN_END_ARRAY:
+				depth--;
+				break;
+			case GITLAB_JSON_TOKEN_ERROR:
+				return FALSE;
+			case GITLAB_JSON_TOKEN_EOF:
+				self->error_message = "Unexpected end of document";
+				return FALSE;
+			default:
+				break;
+		  }
+	}
+
+	return TRUE;
+}
+
+/*
+ * Compares the current string token, as it appears in the document, with
+ * @str. Meant for member names, which never contain escapes.
+ */
+gboolean
+_gitlab_json_scanner_string_equal (GitlabJsonScanner *self,
+                                   const gchar       *str)
+{
+	gsize len = self->token_end - self->token_start;
+
+	return strlen (str) == len && memcmp (self->data + self->token_start, str, len) == 0;
+}
+
+static gboolean
+gitlab_json_scanner_read_hex4 (const gchar *p,
+                               const gchar *end,
+                               gunichar    *out)
+{
+	gunichar value = 0;
+
+	if (end - p < 4)
+		return FALSE;
+
+	for (guint i = 0; i < 4; i++) {
+		gint digit = g_ascii_xdigit_value (p[i]);
+		if (digit < 0)
+			return FALSE;
+		value = (value << 4) | digit;
+	}
+
+	*out = value;
+	return TRUE;
+}
+
+/*
+ * Replaces the contents of @out with the unescaped current string token.
+ */
+void
+_gitlab_json_scanner_get_string (GitlabJsonScanner *self,
+                                 GString           *out)
+{
+	const gchar *p = self->data + self->token_start;
+	const gchar *end = self->data + self->token_end;
+
+	g_string_truncate (out, 0);
+
+	for (; p < end; p++) {
+		gunichar ch;
+		gunichar low;
+
+		if (*p != '\\') {
+			g_string_append_c (out, *p);
+			continue;
+		}
+
+		if (++p == end)
+			break;
+
+		switch (*p)
+		  {
+			case 'b':
+				g_string_append_c (out, '\b');
+				break;
+			case 'f':
+				g_string_append_c (out, '\f');
+				break;
+			case 'n':
+				g_string_append_c (out, '\n');
+				break;
+			case 'r':
+				g_string_append_c (out, '\r');
+				break;
+			case 't':
+				g_string_append_c (out, '\t');
+				break;
+			case 'u':
+				if (!gitlab_json_scanner_read_hex4 (p + 1, end, &ch)) {
+					g_string_append_unichar (out, 0xFFFD);
+					break;
+				}
+				p += 4;
+				if (ch >= 0xD800 && ch < 0xDC00 &&
+				    end - p > 6 && p[1] == '\\' && p[2] == 'u' &&
+				    gitlab_json_scanner_read_hex4 (p + 3, end, &low) &&
+				    low >= 0xDC00 && low < 0xE000) {
+					ch = 0x10000 + ((ch - 0xD800) << 10) + (low - 0xDC00);
+					p += 6;
+				}
+				/* Lone surrogates, and NUL which would cut the C string short */
+				if (ch == 0 || (ch >= 0xD800 && ch < 0xE000))
+					ch = 0xFFFD;
+				g_string_append_unichar (out, ch);
+				break;
+			default:
+				g_string_append_c (out, *p);
+				break;
+		  }
+	}
+}
+
+/*
+ * Returns the unescaped contents of the current string token.
+ */
+gchar *
+_gitlab_json_scanner_dup_string (GitlabJsonScanner *self)
+{
+	const gchar *p = self->data + self->token_start;
+	gsize len = self->token_end - self->token_start;
+	GString *str;
+
+	if (memchr (p, '\\', len) == NULL)
+		return g_strndup (p, len);
+
+	str = g_string_sized_new (len);
+	_gitlab_json_scanner_get_string (self, str);
+
+	return g_string_free (str, FALSE);
+}
+
+gint64
+_gitlab_json_scanner_get_int (GitlabJsonScanner *self)
+{
+	gchar buf[32];
+	gsize len = MIN (self->token_end - self->token_start, sizeof buf - 1);
+
+	memcpy (buf, self->data + self->token_start, len);
+	buf[len] = '\0';
+
+	return g_ascii_strtoll (buf, NULL, 10);
+}
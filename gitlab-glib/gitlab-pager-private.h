@@ -0,0 +1,59 @@
+/* gitlab-pager-private.h
+ *
+ * Copyright (C) 2017 Günther Wutz <info@gunibert.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+#include "gitlab-client.h"
+
+G_BEGIN_DECLS
+
+/*
+ * Parses the body of one page of a paginated listing into an array of
+ * owned objects, or returns %NULL and sets @error.
+ */
+typedef GPtrArray *(*GitlabPagerParseFunc) (GitlabClient  *client,
+                                            GBytes        *bytes,
+                                            GError       **error);
+
+/*
+ * Receives the items of each page, in page order, in the main context of
+ * the caller.
+ */
+typedef void (*GitlabPagerPageFunc) (GitlabClient *client,
+                                     GPtrArray    *items,
+                                     gpointer      user_data);
+
+/*
+ * GITLAB_PAGER_UNCACHED: neither revalidate the pages nor keep them in the
+ * response cache, for listings whose URL is not requested again.
+ */
+typedef enum
+{
+	GITLAB_PAGER_NONE     = 0,
+	GITLAB_PAGER_UNCACHED = 1 << 0,
+} GitlabPagerFlags;
+
+void _gitlab_pager_run (GTask                *task,
+                        const gchar          *url,
+                        GitlabPagerFlags      flags,
+                        GitlabPagerParseFunc  parse_func,
+                        GitlabPagerPageFunc   page_func,
+                        gpointer              page_data);
+
+G_END_DECLS
@@ -0,0 +1,519 @@
+/* gitlab-pager.c
+ *
+ * Copyright (C) 2017 Günther Wutz <info@gunibert.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * The pager drives a paginated GET endpoint. The first page doubles as the
+ * probe for X-Total-Pages, after which the remaining pages are requested
+ * concurrently, bounded by the client's max-pages-in-flight. Listings with
+ * keyset pagination have no page numbers, there every page is requested
+ * from the next link of the previous one. Requests go
+ * through the client's scheduler, bodies are read asynchronously and all
+ * parsing and bookkeeping happens in the main context of the caller, so no
+ * thread is blocked on the network. Pages are either handed to a page func in
+ * order as soon as all previous pages arrived, or concatenated into one
+ * #GList once the last one arrived.
+ */
+
+#include "gitlab-pager-private.h"
+#include "gitlab-client-private.h"
+#include "gitlab-error.h"
+#include "gitlab-request-trace-private.h"
+#include "gitlab-response-cache-private.h"
+#include "gitlab-scheduler-private.h"
+
+#include <string.h>
+
+typedef struct
+{
+	gchar                *url;
+	gboolean              keyset;
+	gboolean              cached;
+	gchar                *next_url;
+	GitlabPagerParseFunc  parse_func;
+	GitlabPagerPageFunc   page_func;
+	gpointer              page_data;
+	GCancellable         *cancellable;
+	GCancellable         *task_cancellable;
+	gulong                cancelled_id;
+	GPtrArray            *pages;
+	guint                 delivered;
+	guint                 next_page;
+	guint                 last_page;
+	guint                 in_flight;
+	GError               *error;
+} GitlabPager;
+
+typedef struct
+{
+	guint                 page;
+	gboolean              cached;
+	gchar                *url;
+	gchar                *key;
+	gchar                *etag;
+	GitlabPagerParseFunc  parse_func;
+	SoupMessage          *msg;
+	GitlabRequestTrace   *trace;
+	GPtrArray            *items;
+	guint                 total_pages;
+	guint                 next_page;
+	gchar                *next_url;
+} GitlabPage;
+
+static void
+gitlab_pager_free_items (gpointer data)
+{
+	g_list_free_full (data, g_object_unref);
+}
+
+static void
+gitlab_pager_free_page_items (gpointer data)
+{
+	if (data != NULL)
+		g_ptr_array_unref (data);
+}
+
+static void
+gitlab_pager_free (gpointer data)
+{
+	GitlabPager *pager = data;
+
+	if (pager->task_cancellable != NULL)
+		g_cancellable_disconnect (pager->task_cancellable, pager->cancelled_id);
+	g_clear_object (&pager->task_cancellable);
+	g_clear_object (&pager->cancellable);
+	g_ptr_array_unref (pager->pages);
+	g_clear_error (&pager->error);
+	g_free (pager->url);
+	g_free (pager->next_url);
+	g_free (pager);
+}
+
+static void
+gitlab_page_free (gpointer data)
+{
+	GitlabPage *page = data;
+
+	gitlab_pager_free_page_items (page->items);
+	g_clear_pointer (&page->trace, _gitlab_request_trace_free);
+	g_clear_object (&page->msg);
+	g_free (page->url);
+	g_free (page->key);
+	g_free (page->etag);
+	g_free (page->next_url);
+	g_free (page);
+}
+
+static guint
+gitlab_pager_header_uint (SoupMessageHeaders *headers,
+                          const gchar        *name)
+{
+	const gchar *value = soup_message_headers_get_one (headers, name);
+
+	if (value == NULL || *value == '\0')
+		return 0;
+
+	return (guint) g_ascii_strtoull (value, NULL, 10);
+}
+
+/*
+ * Returns the target of the rel="next" entry of the Link header, or %NULL
+ * on the last page.
+ */
+static gchar *
+gitlab_pager_header_next_link (SoupMessageHeaders *headers)
+{
+	const gchar *value = soup_message_headers_get_list (headers, "Link");
+	GSList *links;
+	gchar *next_url = NULL;
+
+	if (value == NULL)
+		return NULL;
+
+	links = soup_header_parse_list (value);
+
+	for (GSList *l = links; l != NULL && next_url == NULL; l = l->next) {
+		const gchar *link = l->data;
+		const gchar *start = strchr (link, '<');
+		const gchar *end = start ? strchr (start, '>') : NULL;
+
+		if (end != NULL && strstr (end, "rel=\"next\"") != NULL)
+			next_url = g_strndup (start + 1, end - start - 1);
+	}
+
+	soup_header_free_list (links);
+
+	return next_url;
+}
+
+static void
+gitlab_pager_page_read_cb (GObject      *object,
+                           GAsyncResult *result,
+                           gpointer      user_data)
+{
+	g_autoptr(GTask) task = user_data;
+	GitlabClient *client = g_task_get_source_object (task);
+	GitlabPage *page = g_task_get_task_data (task);
+	g_autoptr(GBytes) bytes = NULL;
+	GError *error = NULL;
+
+	if (g_output_stream_splice_finish (G_OUTPUT_STREAM (object), result, &error) < 0) {
+		g_task_return_error (task, error);
+		return;
+	}
+
+	bytes = g_memory_output_stream_steal_as_bytes (G_MEMORY_OUTPUT_STREAM (object));
+	_gitlab_request_trace_read (page->trace, g_bytes_get_size (bytes));
+
+	page->items = page->parse_func (client, bytes, &error);
+	if (page->items == NULL) {
+		g_task_return_error (task, error);
+		return;
+	}
+
+	_gitlab_request_trace_parsed (page->trace, page->items->len);
+
+	if (!page->cached) {
+		g_task_return_boolean (task, TRUE);
+		return;
+	}
+
+	_gitlab_request_trace_set_cache (page->trace, GITLAB_CACHE_OUTCOME_MISS);
+	_gitlab_response_cache_take_miss (_gitlab_client_get_response_cache (client),
+	                                  page->key,
+	                                  page->etag,
+	                                  page->items,
+	                                  page->total_pages,
+	                                  page->next_page,
+	                                  page->next_url);
+
+	g_task_return_boolean (task, TRUE);
+}
+
+static void gitlab_pager_page_sent_cb (GObject      *object,
+                                       GAsyncResult *result,
+                                       gpointer      user_data);
+
+/*
+ * Sends a new message for the page of @task, which takes the reference
+ * on @task. With @revalidate the ETag of the cached page is sent along.
+ */
+static void
+gitlab_pager_page_send (GTask    *task,
+                        gboolean  revalidate)
+{
+	GitlabClient *client = g_task_get_source_object (task);
+	GitlabPage *page = g_task_get_task_data (task);
+
+	g_clear_object (&page->msg);
+	g_clear_pointer (&page->trace, _gitlab_request_trace_free);
+
+	page->msg = _gitlab_client_auth_message (client, page->url);
+	page->trace = _gitlab_request_trace_new (page->msg);
+
+	if (revalidate) {
+		g_autofree gchar *etag = NULL;
+
+		etag = _gitlab_response_cache_get_etag (_gitlab_client_get_response_cache (client), page->key);
+		if (etag != NULL)
+			soup_message_headers_replace (page->msg->request_headers, "If-None-Match", etag);
+	}
+
+	_gitlab_scheduler_send_async (_gitlab_client_get_scheduler (client),
+	                              page->msg,
+	                              g_task_get_cancellable (task),
+	                              gitlab_pager_page_sent_cb,
+	                              task);
+}
+
+static void
+gitlab_pager_page_sent_cb (GObject      *object,
+                           GAsyncResult *result,
+                           gpointer      user_data)
+{
+	g_autoptr(GTask) task = user_data;
+	GitlabClient *client = g_task_get_source_object (task);
+	GitlabPage *page = g_task_get_task_data (task);
+	SoupMessage *msg = page->msg;
+	g_autoptr(GInputStream) stream = NULL;
+	g_autoptr(GOutputStream) body = NULL;
+	GError *error = NULL;
+
+	stream = _gitlab_scheduler_send_finish (GITLAB_SCHEDULER (object), result, &error);
+	if (stream == NULL) {
+		g_task_return_error (task, error);
+		return;
+	}
+
+	if (msg->status_code == SOUP_STATUS_NOT_MODIFIED) {
+		if (_gitlab_response_cache_take_hit (_gitlab_client_get_response_cache (client),
+		                                     page->key,
+		                                     &page->items,
+		                                     &page->total_pages,
+		                                     &page->next_page,
+		                                     &page->next_url)) {
+			_gitlab_request_trace_set_cache (page->trace, GITLAB_CACHE_OUTCOME_HIT);
+			g_task_return_boolean (task, TRUE);
+			return;
+		}
+
+		/*
+		 * The entry was cleared or evicted while the request was in
+		 * flight, so the page has to be downloaded after all.
+		 */
+		if (soup_message_headers_get_one (msg->request_headers, "If-None-Match") != NULL) {
+			gitlab_pager_page_send (g_steal_pointer (&task), FALSE);
+			return;
+		}
+	}
+
+	if (!SOUP_STATUS_IS_SUCCESSFUL (msg->status_code)) {
+		g_task_return_new_error (task, GITLAB_ERROR, GITLAB_ERROR_HTTP,
+		                         "%s: %u %s", page->url, msg->status_code, msg->reason_phrase);
+		return;
+	}
+
+	page->total_pages = gitlab_pager_header_uint (msg->response_headers, "X-Total-Pages");
+	page->next_page = gitlab_pager_header_uint (msg->response_headers, "X-Next-Page");
+	page->next_url = gitlab_pager_header_next_link (msg->response_headers);
+	page->etag = g_strdup (soup_message_headers_get_one (msg->response_headers, "ETag"));
+
+	body = g_memory_output_stream_new_resizable ();
+	g_output_stream_splice_async (body,
+	                              stream,
+	                              G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE | G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET,
+	                              G_PRIORITY_DEFAULT,
+	                              g_task_get_cancellable (task),
+	                              gitlab_pager_page_read_cb,
+	                              g_object_ref (task));
+}
+
+static void gitlab_pager_page_cb (GObject      *object,
+                                  GAsyncResult *result,
+                                  gpointer      user_data);
+
+static void
+gitlab_pager_fetch_page (GTask *task,
+                         guint  n)
+{
+	GitlabPager *pager = g_task_get_task_data (task);
+	GitlabClient *client = g_task_get_source_object (task);
+	GTask *page_task;
+	GitlabPage *page;
+
+	page = g_new0 (GitlabPage, 1);
+	page->page = n;
+	page->cached = pager->cached;
+	page->parse_func = pager->parse_func;
+	if (pager->keyset)
+		page->url = g_steal_pointer (&pager->next_url);
+	else
+		page->url = g_strdup_printf ("%s%cpage=%u",
+		                             pager->url,
+		                             strchr (pager->url, '?') != NULL ? '&' : '?',
+		                             n);
+	page->key = _gitlab_client_get_cache_key (client, page->url);
+
+	page_task = g_task_new (client,
+	                        pager->cancellable,
+	                        gitlab_pager_page_cb,
+	                        g_object_ref (task));
+	g_task_set_task_data (page_task, page, gitlab_page_free);
+
+	pager->in_flight++;
+	gitlab_pager_page_send (page_task, page->cached);
+}
+
+static void
+gitlab_pager_complete (GTask *task)
+{
+	GitlabPager *pager = g_task_get_task_data (task);
+	GList *list = NULL;
+
+	if (pager->error != NULL) {
+		g_task_return_error (task, g_steal_pointer (&pager->error));
+		return;
+	}
+
+	if (pager->page_func != NULL) {
+		g_task_return_boolean (task, TRUE);
+		return;
+	}
+
+	for (guint i = pager->pages->len; i > 0; i--) {
+		GPtrArray *items = g_ptr_array_index (pager->pages, i - 1);
+
+		for (guint j = items->len; j > 0; j--)
+			list = g_list_prepend (list, g_object_ref (g_ptr_array_index (items, j - 1)));
+	}
+
+	g_task_return_pointer (task, list, gitlab_pager_free_items);
+}
+
+/*
+ * Hands the pages that arrived in order to the page func. Nothing is
+ * delivered after an error, the caller gets that error instead of a
+ * listing with a hole. The response cache keeps the array of a page, so
+ * the page func gets a copy it may sort or shrink.
+ */
+static void
+gitlab_pager_deliver (GTask *task)
+{
+	GitlabPager *pager = g_task_get_task_data (task);
+
+	while (pager->error == NULL &&
+	       pager->delivered < pager->pages->len &&
+	       g_ptr_array_index (pager->pages, pager->delivered) != NULL) {
+		g_autoptr(GPtrArray) items = NULL;
+
+		items = g_ptr_array_copy (g_ptr_array_index (pager->pages, pager->delivered),
+		                          (GCopyFunc) g_object_ref,
+		                          NULL);
+		g_clear_pointer (&g_ptr_array_index (pager->pages, pager->delivered), g_ptr_array_unref);
+		pager->delivered++;
+
+		pager->page_func (g_task_get_source_object (task), items, pager->page_data);
+	}
+}
+
+static void
+gitlab_pager_schedule (GTask *task)
+{
+	GitlabPager *pager = g_task_get_task_data (task);
+	guint max_in_flight;
+
+	max_in_flight = _gitlab_client_get_max_pages_in_flight (g_task_get_source_object (task));
+
+	while (pager->error == NULL &&
+	       pager->in_flight < max_in_flight &&
+	       pager->next_page <= pager->last_page)
+		gitlab_pager_fetch_page (task, pager->next_page++);
+
+	if (pager->in_flight == 0)
+		gitlab_pager_complete (task);
+}
+
+static void
+gitlab_pager_page_cb (GObject      *object,
+                      GAsyncResult *result,
+                      gpointer      user_data)
+{
+	g_autoptr(GTask) task = user_data;
+	GitlabPager *pager = g_task_get_task_data (task);
+	GitlabPage *page = g_task_get_task_data (G_TASK (result));
+	GError *error = NULL;
+
+	pager->in_flight--;
+	_gitlab_client_report (GITLAB_CLIENT (object), page->trace);
+
+	if (!g_task_propagate_boolean (G_TASK (result), &error)) {
+		if (pager->error == NULL) {
+			pager->error = error;
+			g_cancellable_cancel (pager->cancellable);
+		} else {
+			g_error_free (error);
+		}
+	} else if (pager->error == NULL) {
+		if (page->page > pager->pages->len)
+			g_ptr_array_set_size (pager->pages, page->page);
+		g_ptr_array_index (pager->pages, page->page - 1) = g_steal_pointer (&page->items);
+
+		if (pager->keyset) {
+			/* Older servers ignore pagination=keyset but link numbered pages */
+			if (page->next_url != NULL) {
+				pager->next_url = g_steal_pointer (&page->next_url);
+				pager->last_page = page->page + 1;
+			}
+		} else {
+			/*
+			 * X-Total-Pages is omitted by gitlab for very large collections,
+			 * fall back to following X-Next-Page one page at a time then.
+			 */
+			pager->last_page = MAX (pager->last_page, page->total_pages);
+			pager->last_page = MAX (pager->last_page, page->next_page);
+		}
+
+		if (pager->page_func != NULL)
+			gitlab_pager_deliver (task);
+	}
+
+	gitlab_pager_schedule (task);
+}
+
+static void
+gitlab_pager_cancelled_cb (GCancellable *cancellable,
+                           gpointer      user_data)
+{
+	g_cancellable_cancel (G_CANCELLABLE (user_data));
+}
+
+/*
+ * _gitlab_pager_run:
+ * @task: a #GTask with a #GitlabClient as source object
+ * @url: the url of the listing, without page parameter. With
+ *   pagination=keyset, the pages are followed through their Link header.
+ * @parse_func: parses a single page
+ * @page_func: (nullable): receives the items of each page in order
+ * @page_data: user data for @page_func
+ *
+ * Fetches every page of @url. Without @page_func the concatenated #GList of
+ * items is returned in @task, otherwise each page is handed to @page_func
+ * and @task returns a boolean. The task data of @task is owned by the pager.
+ */
+void
+_gitlab_pager_run (GTask                *task,
+                   const gchar          *url,
+                   GitlabPagerFlags      flags,
+                   GitlabPagerParseFunc  parse_func,
+                   GitlabPagerPageFunc   page_func,
+                   gpointer              page_data)
+{
+	GitlabPager *pager;
+	GCancellable *cancellable;
+
+	g_assert (G_IS_TASK (task));
+	g_assert (GITLAB_IS_CLIENT (g_task_get_source_object (task)));
+	g_assert (url != NULL);
+	g_assert (parse_func != NULL);
+
+	pager = g_new0 (GitlabPager, 1);
+	pager->url = g_strdup (url);
+	pager->keyset = strstr (url, "pagination=keyset") != NULL;
+	pager->cached = (flags & GITLAB_PAGER_UNCACHED) == 0;
+	if (pager->keyset)
+		pager->next_url = g_strdup (url);
+	pager->parse_func = parse_func;
+	pager->page_func = page_func;
+	pager->page_data = page_data;
+	pager->cancellable = g_cancellable_new ();
+	pager->pages = g_ptr_array_new_with_free_func (gitlab_pager_free_page_items);
+	pager->next_page = 1;
+	pager->last_page = 1;
+
+	cancellable = g_task_get_cancellable (task);
+	if (cancellable != NULL) {
+		pager->task_cancellable = g_object_ref (cancellable);
+		pager->cancelled_id = g_cancellable_connect (cancellable,
+		                                             G_CALLBACK (gitlab_pager_cancelled_cb),
+		                                             pager->cancellable,
+		                                             NULL);
+	}
+
+	g_task_set_task_data (task, pager, gitlab_pager_free);
+
+	gitlab_pager_schedule (task);
+}
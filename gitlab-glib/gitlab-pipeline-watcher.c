@@ -0,0 +1,526 @@
+/* gitlab-pipeline-watcher.c
+ *
+ * Copyright (C) 2017 Günther Wutz <info@gunibert.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Watches the latest pipeline of many projects with one shared budget of
+ * requests. Every project has its own interval: a running pipeline is
+ * polled every fast-interval seconds, an idle project backs off by
+ * doubling its interval up to slow-interval. Polls are conditional, so an
+ * unchanged project usually costs a 304. Due projects wait for a free
+ * slot of max-in-flight, the one due longest goes first.
+ */
+
+#include "gitlab-pipeline-watcher.h"
+#include "gitlab-client-private.h"
+#include "gitlab-error.h"
+#include <json-glib/json-glib.h>
+
+struct _GitlabPipelineWatcher
+{
+	GObject parent_instance;
+
+	GitlabClient *client;
+	guint max_in_flight;
+	guint fast_interval;
+	guint slow_interval;
+
+	GHashTable *watches;
+	GCancellable *cancellable;
+	guint in_flight;
+	guint timeout_id;
+};
+
+typedef struct
+{
+	GitlabProject *project;
+	gchar *etag;
+	gint pipeline_id;
+	gchar *status;
+	gint64 next_poll;
+	guint interval;
+	gboolean polling;
+} GitlabPipelineWatch;
+
+/* A poll does not keep the watcher alive, self is cleared when it goes */
+typedef struct
+{
+	GitlabPipelineWatcher *self;
+	SoupMessage *msg;
+	gint project_id;
+} GitlabPipelinePoll;
+
+G_DEFINE_TYPE (GitlabPipelineWatcher, gitlab_pipeline_watcher, G_TYPE_OBJECT)
+
+enum {
+	PROP_0,
+	PROP_CLIENT,
+	PROP_MAX_IN_FLIGHT,
+	PROP_FAST_INTERVAL,
+	PROP_SLOW_INTERVAL,
+	N_PROPS
+};
+
+enum {
+	PIPELINE_CHANGED,
+	N_SIGNALS
+};
+
+static GParamSpec *properties [N_PROPS];
+static guint signals [N_SIGNALS];
+
+static void gitlab_pipeline_watcher_schedule (GitlabPipelineWatcher *self);
+
+/**
+ * gitlab_pipeline_watcher_new:
+ * @client: the #GitlabClient to poll with
+ *
+ * Returns: (transfer full): a new #GitlabPipelineWatcher
+ */
+GitlabPipelineWatcher *
+gitlab_pipeline_watcher_new (GitlabClient *client)
+{
+	return g_object_new (GITLAB_TYPE_PIPELINE_WATCHER,
+	                     "client", client,
+	                     NULL);
+}
+
+static void
+gitlab_pipeline_watch_free (gpointer data)
+{
+	GitlabPipelineWatch *watch = data;
+
+	g_object_unref (watch->project);
+	g_free (watch->etag);
+	g_free (watch->status);
+	g_free (watch);
+}
+
+static gboolean
+gitlab_pipeline_watcher_is_active (const gchar *status)
+{
+	static const gchar *active[] = {
+		"created", "waiting_for_resource", "preparing", "pending", "running", "scheduled",
+	};
+
+	for (guint i = 0; status != NULL && i < G_N_ELEMENTS (active); i++) {
+		if (g_str_equal (status, active[i]))
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+/*
+ * Parses the first pipeline of a listing. An empty listing leaves the
+ * project without a pipeline, which is id 0.
+ */
+static gboolean
+gitlab_pipeline_watcher_parse (GBytes  *bytes,
+                               gint    *pipeline_id,
+                               gchar  **status,
+                               gchar  **ref,
+                               GError **error)
+{
+	g_autoptr(JsonParser) parser = json_parser_new ();
+	JsonNode *root;
+	JsonArray *array;
+	JsonObject *pipeline;
+	gsize length;
+	const gchar *data = g_bytes_get_data (bytes, &length);
+
+	*pipeline_id = 0;
+	*status = NULL;
+	*ref = NULL;
+
+	if (!json_parser_load_from_data (parser, data, length, error))
+		return FALSE;
+
+	root = json_parser_get_root (parser);
+	if (!JSON_NODE_HOLDS_ARRAY (root)) {
+		g_set_error (error, GITLAB_ERROR, GITLAB_ERROR_PARSE, "Expected a list of pipelines");
+		return FALSE;
+	}
+
+	array = json_node_get_array (root);
+	if (json_array_get_length (array) == 0)
+		return TRUE;
+
+	root = json_array_get_element (array, 0);
+	if (!JSON_NODE_HOLDS_OBJECT (root)) {
+		g_set_error (error, GITLAB_ERROR, GITLAB_ERROR_PARSE, "Expected a pipeline");
+		return FALSE;
+	}
+
+	pipeline = json_node_get_object (root);
+	if (json_object_has_member (pipeline, "id"))
+		*pipeline_id = json_object_get_int_member (pipeline, "id");
+	if (json_object_has_member (pipeline, "status"))
+		*status = g_strdup (json_object_get_string_member (pipeline, "status"));
+	if (json_object_has_member (pipeline, "ref"))
+		*ref = g_strdup (json_object_get_string_member (pipeline, "ref"));
+
+	return TRUE;
+}
+
+/*
+ * Applies the answer of a poll. Changes are announced and make the project
+ * fast again, an unchanged idle project backs off.
+ */
+static void
+gitlab_pipeline_watcher_update (GitlabPipelineWatcher *self,
+                                GitlabPipelineWatch   *watch,
+                                SoupMessage           *msg,
+                                GBytes                *bytes)
+{
+	g_autofree gchar *status = NULL;
+	g_autofree gchar *ref = NULL;
+	g_autoptr(GError) error = NULL;
+	gint pipeline_id;
+
+	if (msg->status_code == SOUP_STATUS_NOT_MODIFIED) {
+		pipeline_id = watch->pipeline_id;
+		status = g_strdup (watch->status);
+	} else if (!gitlab_pipeline_watcher_parse (bytes, &pipeline_id, &status, &ref, &error)) {
+		g_debug ("Pipelines of project %d: %s", gitlab_project_get_id (watch->project), error->message);
+		watch->interval = self->slow_interval;
+		return;
+	} else {
+		g_free (watch->etag);
+		watch->etag = g_strdup (soup_message_headers_get_one (msg->response_headers, "ETag"));
+	}
+
+	if (pipeline_id != watch->pipeline_id || g_strcmp0 (status, watch->status) != 0) {
+		watch->pipeline_id = pipeline_id;
+		g_free (watch->status);
+		watch->status = g_steal_pointer (&status);
+		watch->interval = self->fast_interval;
+
+		g_signal_emit (self, signals [PIPELINE_CHANGED], 0,
+		               watch->project, watch->pipeline_id, watch->status, ref);
+	} else if (gitlab_pipeline_watcher_is_active (watch->status)) {
+		watch->interval = self->fast_interval;
+	} else {
+		watch->interval = MIN (watch->interval * 2, self->slow_interval);
+	}
+}
+
+static void
+gitlab_pipeline_watcher_poll_cb (GObject      *object,
+                                 GAsyncResult *result,
+                                 gpointer      user_data)
+{
+	GitlabPipelinePoll *poll = user_data;
+	GitlabPipelineWatcher *self = poll->self;
+	GitlabPipelineWatch *watch;
+	g_autoptr(GBytes) bytes = NULL;
+	g_autoptr(GError) error = NULL;
+
+	bytes = _gitlab_client_send_finish (GITLAB_CLIENT (object), result, &error);
+
+	if (self == NULL) {
+		g_object_unref (poll->msg);
+		g_free (poll);
+		return;
+	}
+
+	g_object_remove_weak_pointer (G_OBJECT (self), (gpointer *) &poll->self);
+	self->in_flight--;
+
+	/* The project may have been removed while it was polled */
+	watch = g_hash_table_lookup (self->watches, GINT_TO_POINTER (poll->project_id));
+	if (watch != NULL && watch->polling) {
+		watch->polling = FALSE;
+
+		if (bytes != NULL) {
+			gitlab_pipeline_watcher_update (self, watch, poll->msg, bytes);
+		} else {
+			g_debug ("Pipelines of project %d: %s", poll->project_id, error->message);
+			watch->interval = self->slow_interval;
+		}
+
+		watch->next_poll = g_get_monotonic_time () + (gint64) watch->interval * G_USEC_PER_SEC;
+	}
+
+	gitlab_pipeline_watcher_schedule (self);
+
+	g_object_unref (poll->msg);
+	g_free (poll);
+}
+
+static void
+gitlab_pipeline_watcher_poll (GitlabPipelineWatcher *self,
+                              GitlabPipelineWatch   *watch)
+{
+	GitlabPipelinePoll *poll;
+	g_autofree gchar *url = NULL;
+	g_autofree gchar *baseurl = NULL;
+
+	g_object_get (self->client, "baseurl", &baseurl, NULL);
+	url = g_strdup_printf ("%s/projects/%d/pipelines?per_page=1&order_by=id&sort=desc",
+	                       baseurl, gitlab_project_get_id (watch->project));
+
+	poll = g_new0 (GitlabPipelinePoll, 1);
+	poll->self = self;
+	g_object_add_weak_pointer (G_OBJECT (self), (gpointer *) &poll->self);
+	poll->project_id = gitlab_project_get_id (watch->project);
+	poll->msg = _gitlab_client_auth_message (self->client, url);
+	if (watch->etag != NULL)
+		soup_message_headers_append (poll->msg->request_headers, "If-None-Match", watch->etag);
+
+	watch->polling = TRUE;
+	self->in_flight++;
+
+	_gitlab_client_send_async (self->client,
+	                           poll->msg,
+	                           self->cancellable,
+	                           gitlab_pipeline_watcher_poll_cb,
+	                           poll);
+}
+
+static gboolean
+gitlab_pipeline_watcher_timeout_cb (gpointer user_data)
+{
+	GitlabPipelineWatcher *self = user_data;
+
+	self->timeout_id = 0;
+	gitlab_pipeline_watcher_schedule (self);
+
+	return G_SOURCE_REMOVE;
+}
+
+/*
+ * Polls the due projects that fit into the budget, longest due first, and
+ * arms the timer for the next one.
+ */
+static void
+gitlab_pipeline_watcher_schedule (GitlabPipelineWatcher *self)
+{
+	gint64 now = g_get_monotonic_time ();
+
+	if (self->timeout_id != 0) {
+		g_source_remove (self->timeout_id);
+		self->timeout_id = 0;
+	}
+
+	while (self->in_flight < self->max_in_flight) {
+		GitlabPipelineWatch *next = NULL;
+		GHashTableIter iter;
+		gpointer value;
+
+		g_hash_table_iter_init (&iter, self->watches);
+		while (g_hash_table_iter_next (&iter, NULL, &value)) {
+			GitlabPipelineWatch *watch = value;
+
+			if (!watch->polling && (next == NULL || watch->next_poll < next->next_poll))
+				next = watch;
+		}
+
+		if (next == NULL)
+			return;
+
+		if (next->next_poll > now) {
+			self->timeout_id = g_timeout_add ((next->next_poll - now) / 1000 + 1,
+			                                  gitlab_pipeline_watcher_timeout_cb,
+			                                  self);
+			return;
+		}
+
+		gitlab_pipeline_watcher_poll (self, next);
+	}
+}
+
+/**
+ * gitlab_pipeline_watcher_add:
+ * @self: a #GitlabPipelineWatcher
+ * @project: the #GitlabProject to watch
+ *
+ * Starts watching the latest pipeline of @project. The first poll reports
+ * the current pipeline, if there is one, through
+ * #GitlabPipelineWatcher::pipeline-changed.
+ */
+void
+gitlab_pipeline_watcher_add (GitlabPipelineWatcher *self,
+                             GitlabProject         *project)
+{
+	GitlabPipelineWatch *watch;
+	gint id;
+
+	g_assert (GITLAB_IS_PIPELINE_WATCHER (self));
+	g_assert (GITLAB_IS_PROJECT (project));
+
+	id = gitlab_project_get_id (project);
+	if (g_hash_table_contains (self->watches, GINT_TO_POINTER (id)))
+		return;
+
+	watch = g_new0 (GitlabPipelineWatch, 1);
+	watch->project = g_object_ref (project);
+	watch->interval = self->fast_interval;
+	/* Spread the first polls of many projects over the fast interval */
+	watch->next_poll = g_get_monotonic_time () +
+	                   g_random_int_range (0, self->fast_interval * 1000) * (gint64) 1000;
+	g_hash_table_insert (self->watches, GINT_TO_POINTER (id), watch);
+
+	gitlab_pipeline_watcher_schedule (self);
+}
+
+/**
+ * gitlab_pipeline_watcher_remove:
+ * @self: a #GitlabPipelineWatcher
+ * @project: the #GitlabProject to stop watching
+ */
+void
+gitlab_pipeline_watcher_remove (GitlabPipelineWatcher *self,
+                                GitlabProject         *project)
+{
+	g_assert (GITLAB_IS_PIPELINE_WATCHER (self));
+	g_assert (GITLAB_IS_PROJECT (project));
+
+	g_hash_table_remove (self->watches, GINT_TO_POINTER (gitlab_project_get_id (project)));
+}
+
+static void
+gitlab_pipeline_watcher_dispose (GObject *object)
+{
+	GitlabPipelineWatcher *self = (GitlabPipelineWatcher *)object;
+
+	g_cancellable_cancel (self->cancellable);
+	g_hash_table_remove_all (self->watches);
+	if (self->timeout_id != 0) {
+		g_source_remove (self->timeout_id);
+		self->timeout_id = 0;
+	}
+
+	G_OBJECT_CLASS (gitlab_pipeline_watcher_parent_class)->dispose (object);
+}
+
+static void
+gitlab_pipeline_watcher_finalize (GObject *object)
+{
+	GitlabPipelineWatcher *self = (GitlabPipelineWatcher *)object;
+
+	g_hash_table_unref (self->watches);
+	g_object_unref (self->cancellable);
+	g_clear_object (&self->client);
+
+	G_OBJECT_CLASS (gitlab_pipeline_watcher_parent_class)->finalize (object);
+}
+
+static void
+gitlab_pipeline_watcher_get_property (GObject    *object,
+                                      guint       prop_id,
+                                      GValue     *value,
+                                      GParamSpec *pspec)
+{
+	GitlabPipelineWatcher *self = GITLAB_PIPELINE_WATCHER (object);
+
+	switch (prop_id)
+	  {
+		case PROP_CLIENT:
+			g_value_set_object (value, self->client);
+			break;
+		case PROP_MAX_IN_FLIGHT:
+			g_value_set_uint (value, self->max_in_flight);
+			break;
+		case PROP_FAST_INTERVAL:
+			g_value_set_uint (value, self->fast_interval);
+			break;
+		case PROP_SLOW_INTERVAL:
+			g_value_set_uint (value, self->slow_interval);
+			break;
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+	  }
+}
+
+static void
+gitlab_pipeline_watcher_set_property (GObject      *object,
+                                      guint         prop_id,
+                                      const GValue *value,
+                                      GParamSpec   *pspec)
+{
+	GitlabPipelineWatcher *self = GITLAB_PIPELINE_WATCHER (object);
+
+	switch (prop_id)
+	  {
+		case PROP_CLIENT:
+			self->client = g_value_dup_object (value);
+			break;
+		case PROP_MAX_IN_FLIGHT:
+			self->max_in_flight = g_value_get_uint (value);
+			if (self->watches != NULL)
+				gitlab_pipeline_watcher_schedule (self);
+			break;
+		case PROP_FAST_INTERVAL:
+			self->fast_interval = g_value_get_uint (value);
+			break;
+		case PROP_SLOW_INTERVAL:
+			self->slow_interval = g_value_get_uint (value);
+			break;
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+	  }
+}
+
+static void
+gitlab_pipeline_watcher_class_init (GitlabPipelineWatcherClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	object_class->dispose = gitlab_pipeline_watcher_dispose;
+	object_class->finalize = gitlab_pipeline_watcher_finalize;
+	object_class->get_property = gitlab_pipeline_watcher_get_property;
+	object_class->set_property = gitlab_pipeline_watcher_set_property;
+
+	properties[PROP_CLIENT] =
+		g_param_spec_object ("client", "Client", "The client to poll with", GITLAB_TYPE_CLIENT, G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_STRINGS);
+
+	properties[PROP_MAX_IN_FLIGHT] =
+		g_param_spec_uint ("max-in-flight", "Max-in-flight", "The number of polls running at once for all projects", 1, G_MAXUINT, 4, G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS);
+
+	properties[PROP_FAST_INTERVAL] =
+		g_param_spec_uint ("fast-interval", "Fast-interval", "The seconds between polls while a pipeline runs", 1, G_MAXUINT, 10, G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS);
+
+	properties[PROP_SLOW_INTERVAL] =
+		g_param_spec_uint ("slow-interval", "Slow-interval", "The most seconds between polls of an idle project", 1, G_MAXUINT, 300, G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS);
+
+	g_object_class_install_properties (object_class, N_PROPS, properties);
+
+	/**
+	 * GitlabPipelineWatcher::pipeline-changed:
+	 * @self: a #GitlabPipelineWatcher
+	 * @project: the #GitlabProject
+	 * @pipeline_id: the id of the latest pipeline, 0 if there is none
+	 * @status: (nullable): the status of the pipeline, like running or success
+	 * @ref: (nullable): the branch or tag of the pipeline
+	 *
+	 * Emitted when the latest pipeline of @project or its status changed.
+	 */
+	signals [PIPELINE_CHANGED] =
+		g_signal_new ("pipeline-changed",
+		              G_TYPE_FROM_CLASS (klass),
+		              G_SIGNAL_RUN_LAST,
+		              0, NULL, NULL, NULL,
+		              G_TYPE_NONE, 4, GITLAB_TYPE_PROJECT, G_TYPE_INT, G_TYPE_STRING, G_TYPE_STRING);
+}
+
+static void
+gitlab_pipeline_watcher_init (GitlabPipelineWatcher *self)
+{
+	self->watches = g_hash_table_new_full (NULL, NULL, NULL, gitlab_pipeline_watch_free);
+	self->cancellable = g_cancellable_new ();
+}
@@ -0,0 +1,36 @@
+/* gitlab-pipeline-watcher.h
+ *
+ * Copyright (C) 2017 Günther Wutz <info@gunibert.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <glib-object.h>
+#include "gitlab-client.h"
+#include "gitlab-project.h"
+
+G_BEGIN_DECLS
+
+#define GITLAB_TYPE_PIPELINE_WATCHER (gitlab_pipeline_watcher_get_type())
+
+G_DECLARE_FINAL_TYPE (GitlabPipelineWatcher, gitlab_pipeline_watcher, GITLAB, PIPELINE_WATCHER, GObject)
+
+GitlabPipelineWatcher *gitlab_pipeline_watcher_new (GitlabClient *client);
+void gitlab_pipeline_watcher_add (GitlabPipelineWatcher *self,
+                                  GitlabProject         *project);
+void gitlab_pipeline_watcher_remove (GitlabPipelineWatcher *self,
+                                     GitlabProject         *project);
+
+G_END_DECLS
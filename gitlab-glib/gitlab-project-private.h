@@ -0,0 +1,34 @@
+/* gitlab-project-private.h
+ *
+ * Copyright (C) 2017 Günther Wutz <info@gunibert.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include "gitlab-project.h"
+#include "gitlab-json-scanner-private.h"
+#include "gitlab-string-pool-private.h"
+
+G_BEGIN_DECLS
+
+GitlabProject *_gitlab_project_new_from_scanner (GitlabJsonScanner  *scanner,
+                                                 GitlabStringPool   *pool,
+                                                 GString            *scratch,
+                                                 GError            **error);
+GitlabProject *_gitlab_project_new_lazy         (GitlabJsonScanner  *scanner,
+                                                 GBytes             *bytes,
+                                                 GError            **error);
+
+G_END_DECLS
@@ -0,0 +1,428 @@
+/* gitlab-project-query.c
+ *
+ * Copyright (C) 2017 Günther Wutz <info@gunibert.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * A query describes which projects a listing returns and how it is paged.
+ * Everything is pushed down to the server as url parameters, so filtered
+ * out projects are never downloaded.
+ */
+
+#include "gitlab-project-query.h"
+#include "gitlab-project-query-private.h"
+
+#define GITLAB_PROJECT_QUERY_MAX_PER_PAGE 100
+
+GType
+gitlab_archived_filter_get_type (void)
+{
+	static gsize type = 0;
+
+	if (g_once_init_enter (&type)) {
+		static const GEnumValue values[] = {
+			{ GITLAB_ARCHIVED_ANY, "GITLAB_ARCHIVED_ANY", "any" },
+			{ GITLAB_ARCHIVED_ONLY, "GITLAB_ARCHIVED_ONLY", "only" },
+			{ GITLAB_ARCHIVED_EXCLUDE, "GITLAB_ARCHIVED_EXCLUDE", "exclude" },
+			{ 0, NULL, NULL }
+		};
+
+		g_once_init_leave (&type, g_enum_register_static ("GitlabArchivedFilter", values));
+	}
+
+	return type;
+}
+
+struct _GitlabProjectQuery
+{
+	GObject parent_instance;
+
+	gchar *group;
+	gchar *user;
+	gchar *search;
+	GDateTime *last_activity_after;
+	GitlabArchivedFilter archived;
+	guint per_page;
+	gboolean simple;
+	gboolean keyset;
+};
+
+G_DEFINE_TYPE (GitlabProjectQuery, gitlab_project_query, G_TYPE_OBJECT)
+
+enum {
+	PROP_0,
+	PROP_GROUP,
+	PROP_USER,
+	PROP_SEARCH,
+	PROP_LAST_ACTIVITY_AFTER,
+	PROP_ARCHIVED,
+	PROP_PER_PAGE,
+	PROP_SIMPLE,
+	PROP_KEYSET,
+	N_PROPS
+};
+
+static GParamSpec *properties [N_PROPS];
+
+/**
+ * gitlab_project_query_new:
+ *
+ * Creates a query for all projects visible to the token, 100 per page,
+ * in the simple representation and with keyset pagination.
+ *
+ * Returns: (transfer full): a new #GitlabProjectQuery
+ */
+GitlabProjectQuery *
+gitlab_project_query_new (void)
+{
+	return g_object_new (GITLAB_TYPE_PROJECT_QUERY, NULL);
+}
+
+static void
+gitlab_project_query_finalize (GObject *object)
+{
+	GitlabProjectQuery *self = (GitlabProjectQuery *)object;
+
+	g_free (self->group);
+	g_free (self->user);
+	g_free (self->search);
+	g_clear_pointer (&self->last_activity_after, g_date_time_unref);
+
+	G_OBJECT_CLASS (gitlab_project_query_parent_class)->finalize (object);
+}
+
+static void
+gitlab_project_query_get_property (GObject    *object,
+                                   guint       prop_id,
+                                   GValue     *value,
+                                   GParamSpec *pspec)
+{
+	GitlabProjectQuery *self = GITLAB_PROJECT_QUERY (object);
+
+	switch (prop_id)
+	  {
+		case PROP_GROUP:
+			g_value_set_string (value, self->group);
+			break;
+		case PROP_USER:
+			g_value_set_string (value, self->user);
+			break;
+		case PROP_SEARCH:
+			g_value_set_string (value, self->search);
+			break;
+		case PROP_LAST_ACTIVITY_AFTER:
+			g_value_set_boxed (value, self->last_activity_after);
+			break;
+		case PROP_ARCHIVED:
+			g_value_set_enum (value, self->archived);
+			break;
+		case PROP_PER_PAGE:
+			g_value_set_uint (value, self->per_page);
+			break;
+		case PROP_SIMPLE:
+			g_value_set_boolean (value, self->simple);
+			break;
+		case PROP_KEYSET:
+			g_value_set_boolean (value, self->keyset);
+			break;
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+	  }
+}
+
+static void
+gitlab_project_query_set_property (GObject      *object,
+                                   guint         prop_id,
+                                   const GValue *value,
+                                   GParamSpec   *pspec)
+{
+	GitlabProjectQuery *self = GITLAB_PROJECT_QUERY (object);
+
+	switch (prop_id)
+	  {
+		case PROP_GROUP:
+			g_free (self->group);
+			self->group = g_value_dup_string (value);
+			break;
+		case PROP_USER:
+			g_free (self->user);
+			self->user = g_value_dup_string (value);
+			break;
+		case PROP_SEARCH:
+			g_free (self->search);
+			self->search = g_value_dup_string (value);
+			break;
+		case PROP_LAST_ACTIVITY_AFTER:
+			g_clear_pointer (&self->last_activity_after, g_date_time_unref);
+			self->last_activity_after = g_value_dup_boxed (value);
+			break;
+		case PROP_ARCHIVED:
+			self->archived = g_value_get_enum (value);
+			break;
+		case PROP_PER_PAGE:
+			self->per_page = g_value_get_uint (value);
+			break;
+		case PROP_SIMPLE:
+			self->simple = g_value_get_boolean (value);
+			break;
+		case PROP_KEYSET:
+			self->keyset = g_value_get_boolean (value);
+			break;
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+	  }
+}
+
+static void
+gitlab_project_query_class_init (GitlabProjectQueryClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	object_class->finalize = gitlab_project_query_finalize;
+	object_class->get_property = gitlab_project_query_get_property;
+	object_class->set_property = gitlab_project_query_set_property;
+
+	properties[PROP_GROUP] =
+		g_param_spec_string ("group", "Group", "The id or full path of the group to list", NULL, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+	properties[PROP_USER] =
+		g_param_spec_string ("user", "User", "The id or name of the user to list", NULL, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+	properties[PROP_SEARCH] =
+		g_param_spec_string ("search", "Search", "Only list projects matching this search", NULL, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+	properties[PROP_LAST_ACTIVITY_AFTER] =
+		g_param_spec_boxed ("last-activity-after", "Last-activity-after", "Only list projects active after this time", G_TYPE_DATE_TIME, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+	properties[PROP_ARCHIVED] =
+		g_param_spec_enum ("archived", "Archived", "How archived projects are treated", GITLAB_TYPE_ARCHIVED_FILTER, GITLAB_ARCHIVED_ANY, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+	properties[PROP_PER_PAGE] =
+		g_param_spec_uint ("per-page", "Per-page", "The number of projects per page", 1, GITLAB_PROJECT_QUERY_MAX_PER_PAGE, GITLAB_PROJECT_QUERY_MAX_PER_PAGE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+	properties[PROP_SIMPLE] =
+		g_param_spec_boolean ("simple", "Simple", "Whether the server sends only the basic fields of each project", TRUE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+	properties[PROP_KEYSET] =
+		g_param_spec_boolean ("keyset", "Keyset", "Whether listings of all projects use keyset pagination", TRUE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+	g_object_class_install_properties (object_class, N_PROPS, properties);
+}
+
+static void
+gitlab_project_query_init (GitlabProjectQuery *self)
+{
+	self->archived = GITLAB_ARCHIVED_ANY;
+	self->per_page = GITLAB_PROJECT_QUERY_MAX_PER_PAGE;
+	self->simple = TRUE;
+	self->keyset = TRUE;
+}
+
+/**
+ * gitlab_project_query_set_group:
+ * @self: a #GitlabProjectQuery
+ * @group: (nullable): the id or full path of a group
+ *
+ * Restricts the listing to the projects of @group.
+ */
+void
+gitlab_project_query_set_group (GitlabProjectQuery *self,
+                                const gchar        *group)
+{
+	g_assert (GITLAB_IS_PROJECT_QUERY (self));
+
+	g_object_set (self, "group", group, NULL);
+}
+
+/**
+ * gitlab_project_query_set_user:
+ * @self: a #GitlabProjectQuery
+ * @user: (nullable): the id or name of a user
+ *
+ * Restricts the listing to the projects owned by @user. Ignored if a group
+ * is set.
+ */
+void
+gitlab_project_query_set_user (GitlabProjectQuery *self,
+                               const gchar        *user)
+{
+	g_assert (GITLAB_IS_PROJECT_QUERY (self));
+
+	g_object_set (self, "user", user, NULL);
+}
+
+/**
+ * gitlab_project_query_set_search:
+ * @self: a #GitlabProjectQuery
+ * @search: (nullable): a search term
+ *
+ * Restricts the listing to projects matching @search.
+ */
+void
+gitlab_project_query_set_search (GitlabProjectQuery *self,
+                                 const gchar        *search)
+{
+	g_assert (GITLAB_IS_PROJECT_QUERY (self));
+
+	g_object_set (self, "search", search, NULL);
+}
+
+/**
+ * gitlab_project_query_set_last_activity_after:
+ * @self: a #GitlabProjectQuery
+ * @last_activity_after: (nullable): a #GDateTime
+ *
+ * Restricts the listing to projects with activity after
+ * @last_activity_after.
+ */
+void
+gitlab_project_query_set_last_activity_after (GitlabProjectQuery *self,
+                                              GDateTime          *last_activity_after)
+{
+	g_assert (GITLAB_IS_PROJECT_QUERY (self));
+
+	g_object_set (self, "last-activity-after", last_activity_after, NULL);
+}
+
+/**
+ * gitlab_project_query_set_archived:
+ * @self: a #GitlabProjectQuery
+ * @archived: a #GitlabArchivedFilter
+ *
+ * Sets whether archived projects are listed.
+ */
+void
+gitlab_project_query_set_archived (GitlabProjectQuery   *self,
+                                   GitlabArchivedFilter  archived)
+{
+	g_assert (GITLAB_IS_PROJECT_QUERY (self));
+
+	g_object_set (self, "archived", archived, NULL);
+}
+
+/**
+ * gitlab_project_query_set_per_page:
+ * @self: a #GitlabProjectQuery
+ * @per_page: the page size, at most 100
+ *
+ * Sets how many projects one request returns.
+ */
+void
+gitlab_project_query_set_per_page (GitlabProjectQuery *self,
+                                   guint               per_page)
+{
+	g_assert (GITLAB_IS_PROJECT_QUERY (self));
+
+	g_object_set (self, "per-page", CLAMP (per_page, 1, GITLAB_PROJECT_QUERY_MAX_PER_PAGE), NULL);
+}
+
+/**
+ * gitlab_project_query_set_simple:
+ * @self: a #GitlabProjectQuery
+ * @simple: whether to request the simple representation
+ *
+ * The simple representation is a fraction of the size of the full one and
+ * carries every field of #GitlabProject except
+ * #GitlabProject:open-issues-count, which stays 0.
+ */
+void
+gitlab_project_query_set_simple (GitlabProjectQuery *self,
+                                 gboolean            simple)
+{
+	g_assert (GITLAB_IS_PROJECT_QUERY (self));
+
+	g_object_set (self, "simple", simple, NULL);
+}
+
+/**
+ * gitlab_project_query_set_keyset:
+ * @self: a #GitlabProjectQuery
+ * @keyset: whether to use keyset pagination
+ *
+ * Keyset pagination follows the Link header of each page and stays fast
+ * for deep pages. Gitlab only offers it for the listing of all projects,
+ * group and user listings always use numbered pages.
+ */
+void
+gitlab_project_query_set_keyset (GitlabProjectQuery *self,
+                                 gboolean            keyset)
+{
+	g_assert (GITLAB_IS_PROJECT_QUERY (self));
+
+	g_object_set (self, "keyset", keyset, NULL);
+}
+
+static void
+gitlab_project_query_append (GString     *url,
+                             const gchar *name,
+                             const gchar *value)
+{
+	g_autofree gchar *escaped = g_uri_escape_string (value, NULL, TRUE);
+
+	g_string_append_printf (url, "%s=%s&", name, escaped);
+}
+
+/*
+ * Builds the url of the first page of @self below @baseurl.
+ */
+gchar *
+_gitlab_project_query_to_url (GitlabProjectQuery *self,
+                              const gchar        *baseurl)
+{
+	g_autofree gchar *owner = NULL;
+	GString *url;
+
+	g_assert (GITLAB_IS_PROJECT_QUERY (self));
+	g_assert (baseurl != NULL);
+
+	url = g_string_new (baseurl);
+
+	if (self->group != NULL) {
+		owner = g_uri_escape_string (self->group, NULL, TRUE);
+		g_string_append_printf (url, "/groups/%s/projects?", owner);
+	} else if (self->user != NULL) {
+		owner = g_uri_escape_string (self->user, NULL, TRUE);
+		g_string_append_printf (url, "/users/%s/projects?", owner);
+	} else {
+		g_string_append (url, "/projects?");
+		if (self->keyset)
+			g_string_append (url, "pagination=keyset&order_by=id&sort=asc&");
+	}
+
+	g_string_append_printf (url, "per_page=%u&", self->per_page);
+
+	if (self->simple)
+		g_string_append (url, "simple=true&");
+
+	if (self->search != NULL)
+		gitlab_project_query_append (url, "search", self->search);
+
+	if (self->last_activity_after != NULL) {
+		g_autoptr(GDateTime) utc = g_date_time_to_utc (self->last_activity_after);
+		g_autofree gchar *timestamp = g_date_time_format (utc, "%Y-%m-%dT%H:%M:%SZ");
+
+		gitlab_project_query_append (url, "last_activity_after", timestamp);
+	}
+
+	if (self->archived == GITLAB_ARCHIVED_ONLY)
+		g_string_append (url, "archived=true&");
+	else if (self->archived == GITLAB_ARCHIVED_EXCLUDE)
+		g_string_append (url, "archived=false&");
+
+	g_string_truncate (url, url->len - 1);
+
+	return g_string_free (url, FALSE);
+}
@@ -0,0 +1,65 @@
+/* gitlab-project-query.h
+ *
+ * Copyright (C) 2017 Günther Wutz <info@gunibert.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define GITLAB_TYPE_PROJECT_QUERY (gitlab_project_query_get_type())
+
+G_DECLARE_FINAL_TYPE (GitlabProjectQuery, gitlab_project_query, GITLAB, PROJECT_QUERY, GObject)
+
+/**
+ * GitlabArchivedFilter:
+ * @GITLAB_ARCHIVED_ANY: list archived and active projects
+ * @GITLAB_ARCHIVED_ONLY: list archived projects only
+ * @GITLAB_ARCHIVED_EXCLUDE: list active projects only
+ *
+ * How a #GitlabProjectQuery treats archived projects.
+ */
+typedef enum
+{
+	GITLAB_ARCHIVED_ANY,
+	GITLAB_ARCHIVED_ONLY,
+	GITLAB_ARCHIVED_EXCLUDE,
+} GitlabArchivedFilter;
+
+#define GITLAB_TYPE_ARCHIVED_FILTER (gitlab_archived_filter_get_type())
+
+GType gitlab_archived_filter_get_type (void);
+
+GitlabProjectQuery *gitlab_project_query_new (void);
+void gitlab_project_query_set_group (GitlabProjectQuery *self,
+                                     const gchar        *group);
+void gitlab_project_query_set_user (GitlabProjectQuery *self,
+                                    const gchar        *user);
+void gitlab_project_query_set_search (GitlabProjectQuery *self,
+                                      const gchar        *search);
+void gitlab_project_query_set_last_activity_after (GitlabProjectQuery *self,
+                                                   GDateTime          *last_activity_after);
+void gitlab_project_query_set_archived (GitlabProjectQuery   *self,
+                                        GitlabArchivedFilter  archived);
+void gitlab_project_query_set_per_page (GitlabProjectQuery *self,
+                                        guint               per_page);
+void gitlab_project_query_set_simple (GitlabProjectQuery *self,
+                                      gboolean            simple);
+void gitlab_project_query_set_keyset (GitlabProjectQuery *self,
+                                      gboolean            keyset);
+
+G_END_DECLS
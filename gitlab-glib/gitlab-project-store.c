@@ -0,0 +1,532 @@
+/* gitlab-project-store.c
+ *
+ * Copyright (C) 2017 Günther Wutz <info@gunibert.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * The store keeps its projects sorted by their casefolded name, which is
+ * both the order of the list model and the index for lookups by name.
+ * Every word of every name is kept in a second sorted array, so a prefix
+ * search is a binary search followed by a scan over the matches. Updates
+ * come in batches: the new projects are sorted on their own and merged
+ * into both arrays, and the list model reports the batch as one change
+ * spanning from the first to the last position that moved.
+ */
+
+#include "gitlab-project-store.h"
+
+#include <string.h>
+
+typedef struct
+{
+	gchar         *key;
+	GitlabProject *project;
+} GitlabProjectStoreItem;
+
+typedef struct
+{
+	gchar                  *key;
+	GitlabProjectStoreItem *item;
+} GitlabProjectStoreWord;
+
+struct _GitlabProjectStore
+{
+	GObject parent_instance;
+
+	/* GitlabProjectStoreItem, sorted by key and id */
+	GPtrArray *items;
+	/* GitlabProjectStoreWord, sorted by key, pointing into items */
+	GPtrArray *words;
+	/* id to GitlabProjectStoreItem */
+	GHashTable *by_id;
+};
+
+static void gitlab_project_store_list_model_iface_init (GListModelInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (GitlabProjectStore, gitlab_project_store, G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (G_TYPE_LIST_MODEL,
+                                                gitlab_project_store_list_model_iface_init))
+
+static gchar *
+gitlab_project_store_get_key (const gchar *name)
+{
+	return g_utf8_casefold (name != NULL ? name : "", -1);
+}
+
+static GitlabProjectStoreItem *
+gitlab_project_store_item_new (GitlabProject *project)
+{
+	GitlabProjectStoreItem *item = g_new0 (GitlabProjectStoreItem, 1);
+
+	item->key = gitlab_project_store_get_key (gitlab_project_get_name (project));
+	item->project = g_object_ref (project);
+
+	return item;
+}
+
+static void
+gitlab_project_store_item_free (gpointer data)
+{
+	GitlabProjectStoreItem *item = data;
+
+	g_free (item->key);
+	g_object_unref (item->project);
+	g_free (item);
+}
+
+static void
+gitlab_project_store_word_free (gpointer data)
+{
+	GitlabProjectStoreWord *word = data;
+
+	g_free (word->key);
+	g_free (word);
+}
+
+static gint
+gitlab_project_store_item_compare (const GitlabProjectStoreItem *a,
+                                   const GitlabProjectStoreItem *b)
+{
+	gint ret = strcmp (a->key, b->key);
+
+	if (ret != 0)
+		return ret;
+
+	return gitlab_project_get_id (a->project) - gitlab_project_get_id (b->project);
+}
+
+static gint
+gitlab_project_store_word_compare (const GitlabProjectStoreWord *a,
+                                   const GitlabProjectStoreWord *b)
+{
+	gint ret = strcmp (a->key, b->key);
+
+	if (ret != 0)
+		return ret;
+
+	return gitlab_project_store_item_compare (a->item, b->item);
+}
+
+static gint
+gitlab_project_store_sort_items (gconstpointer a,
+                                 gconstpointer b)
+{
+	return gitlab_project_store_item_compare (*(GitlabProjectStoreItem **) a,
+	                                          *(GitlabProjectStoreItem **) b);
+}
+
+static gint
+gitlab_project_store_sort_words (gconstpointer a,
+                                 gconstpointer b)
+{
+	return gitlab_project_store_word_compare (*(GitlabProjectStoreWord **) a,
+	                                          *(GitlabProjectStoreWord **) b);
+}
+
+/*
+ * Splits the key of @item at everything that is not a letter or digit.
+ */
+static void
+gitlab_project_store_add_words (GPtrArray              *words,
+                                GitlabProjectStoreItem *item)
+{
+	const gchar *start = NULL;
+
+	for (const gchar *p = item->key; ; p = g_utf8_next_char (p)) {
+		gboolean alnum = *p != '\0' && g_unichar_isalnum (g_utf8_get_char (p));
+
+		if (alnum && start == NULL) {
+			start = p;
+		} else if (!alnum && start != NULL) {
+			GitlabProjectStoreWord *word = g_new0 (GitlabProjectStoreWord, 1);
+
+			word->key = g_strndup (start, p - start);
+			word->item = item;
+			g_ptr_array_add (words, word);
+			start = NULL;
+		}
+
+		if (*p == '\0')
+			break;
+	}
+}
+
+/*
+ * Merges the sorted @fresh into the sorted @old, leaving out the entries
+ * @keep rejects. The arrays of the store do not own their entries, they
+ * are freed explicitly once they drop out of both.
+ */
+static GPtrArray *
+gitlab_project_store_merge (GPtrArray                 *old,
+                            GPtrArray                 *fresh,
+                            GCompareFunc               compare,
+                            gboolean                 (*keep) (gpointer    entry,
+                                                              GHashTable *stale),
+                            GHashTable                *stale)
+{
+	GPtrArray *merged = g_ptr_array_sized_new (old->len + fresh->len);
+	guint i = 0;
+	guint j = 0;
+
+	while (i < old->len || j < fresh->len) {
+		gpointer entry;
+
+		if (j == fresh->len ||
+		    (i < old->len && compare (g_ptr_array_index (old, i), g_ptr_array_index (fresh, j)) < 0))
+			entry = g_ptr_array_index (old, i++);
+		else
+			entry = g_ptr_array_index (fresh, j++);
+
+		if (keep (entry, stale))
+			g_ptr_array_add (merged, entry);
+	}
+
+	return merged;
+}
+
+static gboolean
+gitlab_project_store_keep_item (gpointer    entry,
+                                GHashTable *stale)
+{
+	return !g_hash_table_contains (stale, entry);
+}
+
+static gboolean
+gitlab_project_store_keep_word (gpointer    entry,
+                                GHashTable *stale)
+{
+	return !g_hash_table_contains (stale, ((GitlabProjectStoreWord *) entry)->item);
+}
+
+static gint
+gitlab_project_store_merge_items (gconstpointer a,
+                                  gconstpointer b)
+{
+	return gitlab_project_store_item_compare (a, b);
+}
+
+static gint
+gitlab_project_store_merge_words (gconstpointer a,
+                                  gconstpointer b)
+{
+	return gitlab_project_store_word_compare (a, b);
+}
+
+/**
+ * gitlab_project_store_new:
+ *
+ * Returns: (transfer full): a new, empty #GitlabProjectStore
+ */
+GitlabProjectStore *
+gitlab_project_store_new (void)
+{
+	return g_object_new (GITLAB_TYPE_PROJECT_STORE, NULL);
+}
+
+/**
+ * gitlab_project_store_update:
+ * @self: a #GitlabProjectStore
+ * @projects: (nullable) (element-type GitlabProject): projects to add or replace
+ * @removed: (nullable) (element-type GitlabProject): projects to remove
+ *
+ * Applies a batch of changes, matching projects by id. This fits the
+ * results of gitlab_client_sync_projects_finish() and the pages of
+ * gitlab_client_stream_projects_async(). #GListModel::items-changed is
+ * emitted at most once per batch.
+ */
+void
+gitlab_project_store_update (GitlabProjectStore *self,
+                             GPtrArray          *projects,
+                             GPtrArray          *removed)
+{
+	g_autoptr(GHashTable) stale = NULL;
+	g_autoptr(GPtrArray) fresh = NULL;
+	g_autoptr(GPtrArray) fresh_words = NULL;
+	GPtrArray *old;
+	GPtrArray *old_words;
+	GHashTableIter iter;
+	gpointer stale_item;
+	guint prefix = 0;
+	guint suffix = 0;
+
+	g_assert (GITLAB_IS_PROJECT_STORE (self));
+
+	stale = g_hash_table_new (NULL, NULL);
+	fresh = g_ptr_array_new ();
+	fresh_words = g_ptr_array_new ();
+
+	for (guint i = 0; removed != NULL && i < removed->len; i++) {
+		gint id = gitlab_project_get_id (g_ptr_array_index (removed, i));
+		GitlabProjectStoreItem *item = g_hash_table_lookup (self->by_id, GINT_TO_POINTER (id));
+
+		if (item != NULL) {
+			g_hash_table_add (stale, item);
+			g_hash_table_remove (self->by_id, GINT_TO_POINTER (id));
+		}
+	}
+
+	for (guint i = 0; projects != NULL && i < projects->len; i++) {
+		GitlabProject *project = g_ptr_array_index (projects, i);
+		gint id = gitlab_project_get_id (project);
+		GitlabProjectStoreItem *item = g_hash_table_lookup (self->by_id, GINT_TO_POINTER (id));
+
+		if (item != NULL && item->project == project)
+			continue;
+		if (item != NULL)
+			g_hash_table_add (stale, item);
+
+		item = gitlab_project_store_item_new (project);
+		g_hash_table_insert (self->by_id, GINT_TO_POINTER (id), item);
+		g_ptr_array_add (fresh, item);
+		gitlab_project_store_add_words (fresh_words, item);
+	}
+
+	if (fresh->len == 0 && g_hash_table_size (stale) == 0)
+		return;
+
+	g_ptr_array_sort (fresh, gitlab_project_store_sort_items);
+	g_ptr_array_sort (fresh_words, gitlab_project_store_sort_words);
+
+	old = self->items;
+	old_words = self->words;
+	self->items = gitlab_project_store_merge (old, fresh,
+	                                          gitlab_project_store_merge_items,
+	                                          gitlab_project_store_keep_item,
+	                                          stale);
+	self->words = gitlab_project_store_merge (old_words, fresh_words,
+	                                          gitlab_project_store_merge_words,
+	                                          gitlab_project_store_keep_word,
+	                                          stale);
+
+	while (prefix < old->len && prefix < self->items->len &&
+	       g_ptr_array_index (old, prefix) == g_ptr_array_index (self->items, prefix))
+		prefix++;
+	while (suffix < old->len - prefix && suffix < self->items->len - prefix &&
+	       g_ptr_array_index (old, old->len - suffix - 1) ==
+	       g_ptr_array_index (self->items, self->items->len - suffix - 1))
+		suffix++;
+
+	/* Free what fell out only after both arrays stopped pointing to it */
+	for (guint i = 0; i < old_words->len; i++) {
+		GitlabProjectStoreWord *word = g_ptr_array_index (old_words, i);
+
+		if (g_hash_table_contains (stale, word->item))
+			gitlab_project_store_word_free (word);
+	}
+	for (guint i = 0; i < fresh_words->len; i++) {
+		GitlabProjectStoreWord *word = g_ptr_array_index (fresh_words, i);
+
+		if (g_hash_table_contains (stale, word->item))
+			gitlab_project_store_word_free (word);
+	}
+
+	g_list_model_items_changed (G_LIST_MODEL (self),
+	                            prefix,
+	                            old->len - prefix - suffix,
+	                            self->items->len - prefix - suffix);
+
+	g_ptr_array_unref (old_words);
+	g_ptr_array_unref (old);
+
+	g_hash_table_iter_init (&iter, stale);
+	while (g_hash_table_iter_next (&iter, &stale_item, NULL))
+		gitlab_project_store_item_free (stale_item);
+}
+
+/**
+ * gitlab_project_store_lookup:
+ * @self: a #GitlabProjectStore
+ * @id: the id of a project
+ *
+ * Returns: (transfer none) (nullable): the project with @id
+ */
+GitlabProject *
+gitlab_project_store_lookup (GitlabProjectStore *self,
+                             gint                id)
+{
+	GitlabProjectStoreItem *item;
+
+	g_assert (GITLAB_IS_PROJECT_STORE (self));
+
+	item = g_hash_table_lookup (self->by_id, GINT_TO_POINTER (id));
+
+	return item != NULL ? item->project : NULL;
+}
+
+/* Returns the first index in the sorted @array whose key is not below @key */
+static guint
+gitlab_project_store_lower_bound (GPtrArray   *array,
+                                  const gchar *key)
+{
+	guint lo = 0;
+	guint hi = array->len;
+
+	while (lo < hi) {
+		guint mid = lo + (hi - lo) / 2;
+		/* Items and words both start with their key */
+		const gchar *mid_key = *(const gchar **) g_ptr_array_index (array, mid);
+
+		if (strcmp (mid_key, key) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+/**
+ * gitlab_project_store_lookup_name:
+ * @self: a #GitlabProjectStore
+ * @name: the name of a project, compared case insensitive
+ *
+ * Returns: (transfer none) (nullable): a project called @name
+ */
+GitlabProject *
+gitlab_project_store_lookup_name (GitlabProjectStore *self,
+                                  const gchar        *name)
+{
+	g_autofree gchar *key = NULL;
+	GitlabProjectStoreItem *item;
+	guint i;
+
+	g_assert (GITLAB_IS_PROJECT_STORE (self));
+	g_assert (name != NULL);
+
+	key = gitlab_project_store_get_key (name);
+	i = gitlab_project_store_lower_bound (self->items, key);
+	if (i == self->items->len)
+		return NULL;
+
+	item = g_ptr_array_index (self->items, i);
+
+	return strcmp (item->key, key) == 0 ? item->project : NULL;
+}
+
+/**
+ * gitlab_project_store_search:
+ * @self: a #GitlabProjectStore
+ * @prefix: the beginning of a word, compared case insensitive
+ *
+ * Finds the projects with a word in their name starting with @prefix. For
+ * "GNOME / gnome-builder" these are "gnome" and "builder".
+ *
+ * Returns: (transfer container) (element-type GitlabProject): the matching
+ * projects in the order of the store
+ */
+GPtrArray *
+gitlab_project_store_search (GitlabProjectStore *self,
+                             const gchar        *prefix)
+{
+	g_autofree gchar *key = NULL;
+	g_autoptr(GHashTable) seen = NULL;
+	g_autoptr(GPtrArray) matches = NULL;
+	GPtrArray *projects;
+
+	g_assert (GITLAB_IS_PROJECT_STORE (self));
+	g_assert (prefix != NULL);
+
+	key = gitlab_project_store_get_key (prefix);
+	seen = g_hash_table_new (NULL, NULL);
+	matches = g_ptr_array_new ();
+
+	for (guint i = gitlab_project_store_lower_bound (self->words, key); i < self->words->len; i++) {
+		GitlabProjectStoreWord *word = g_ptr_array_index (self->words, i);
+
+		if (!g_str_has_prefix (word->key, key))
+			break;
+		if (g_hash_table_add (seen, word->item))
+			g_ptr_array_add (matches, word->item);
+	}
+
+	g_ptr_array_sort (matches, gitlab_project_store_sort_items);
+
+	projects = g_ptr_array_new_full (matches->len, g_object_unref);
+	for (guint i = 0; i < matches->len; i++) {
+		GitlabProjectStoreItem *item = g_ptr_array_index (matches, i);
+
+		g_ptr_array_add (projects, g_object_ref (item->project));
+	}
+
+	return projects;
+}
+
+static GType
+gitlab_project_store_get_item_type (GListModel *model)
+{
+	return GITLAB_TYPE_PROJECT;
+}
+
+static guint
+gitlab_project_store_get_n_items (GListModel *model)
+{
+	GitlabProjectStore *self = GITLAB_PROJECT_STORE (model);
+
+	return self->items->len;
+}
+
+static gpointer
+gitlab_project_store_get_item (GListModel *model,
+                               guint       position)
+{
+	GitlabProjectStore *self = GITLAB_PROJECT_STORE (model);
+	GitlabProjectStoreItem *item;
+
+	if (position >= self->items->len)
+		return NULL;
+
+	item = g_ptr_array_index (self->items, position);
+
+	return g_object_ref (item->project);
+}
+
+static void
+gitlab_project_store_list_model_iface_init (GListModelInterface *iface)
+{
+	iface->get_item_type = gitlab_project_store_get_item_type;
+	iface->get_n_items = gitlab_project_store_get_n_items;
+	iface->get_item = gitlab_project_store_get_item;
+}
+
+static void
+gitlab_project_store_finalize (GObject *object)
+{
+	GitlabProjectStore *self = (GitlabProjectStore *)object;
+
+	g_hash_table_unref (self->by_id);
+	g_ptr_array_set_free_func (self->words, gitlab_project_store_word_free);
+	g_ptr_array_unref (self->words);
+	g_ptr_array_set_free_func (self->items, gitlab_project_store_item_free);
+	g_ptr_array_unref (self->items);
+
+	G_OBJECT_CLASS (gitlab_project_store_parent_class)->finalize (object);
+}
+
+static void
+gitlab_project_store_class_init (GitlabProjectStoreClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	object_class->finalize = gitlab_project_store_finalize;
+}
+
+static void
+gitlab_project_store_init (GitlabProjectStore *self)
+{
+	self->items = g_ptr_array_new ();
+	self->words = g_ptr_array_new ();
+	self->by_id = g_hash_table_new (NULL, NULL);
+}
@@ -0,0 +1,40 @@
+/* gitlab-project-store.h
+ *
+ * Copyright (C) 2017 Günther Wutz <info@gunibert.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <gio/gio.h>
+#include "gitlab-project.h"
+
+G_BEGIN_DECLS
+
+#define GITLAB_TYPE_PROJECT_STORE (gitlab_project_store_get_type())
+
+G_DECLARE_FINAL_TYPE (GitlabProjectStore, gitlab_project_store, GITLAB, PROJECT_STORE, GObject)
+
+GitlabProjectStore *gitlab_project_store_new (void);
+void gitlab_project_store_update (GitlabProjectStore *self,
+                                  GPtrArray          *projects,
+                                  GPtrArray          *removed);
+GitlabProject *gitlab_project_store_lookup (GitlabProjectStore *self,
+                                            gint                id);
+GitlabProject *gitlab_project_store_lookup_name (GitlabProjectStore *self,
+                                                 const gchar        *name);
+GPtrArray *gitlab_project_store_search (GitlabProjectStore *self,
+                                        const gchar        *prefix);
+
+G_END_DECLS
@@ -16,6 +16,10 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include "gitlab-project.h"
+#include "gitlab-project-private.h"
+#include "gitlab-client-private.h"
+#include "gitlab-error.h"
+#include "gitlab-string-pool-private.h"
 
 struct _GitlabProject
 {
@@ -26,6 +30,23 @@ struct _GitlabProject
 	gchar *description;
 	gchar *avatar;
 	gchar *http_url_to_repo;
+	gchar *last_activity_at;
+	gint star_count;
+	gint open_issues_count;
+
+	/* Strings flagged in pooled_props live in pool instead of the heap */
+	GitlabStringPool *pool;
+	guint pooled_props;
+
+	/*
+	 * A lazy project keeps a copy of its object from the page it was
+	 * listed in and decodes a member from it the first time the member is
+	 * read. Members flagged in decoded_props are up to date. Listed
+	 * projects are shared between callers, so both are guarded by lock.
+	 */
+	GMutex lock;
+	GBytes *raw;
+	guint decoded_props;
 };
 
 G_DEFINE_TYPE (GitlabProject, gitlab_project, G_TYPE_OBJECT)
@@ -37,33 +58,288 @@ enum {
 	PROP_DESCRIPTION,
 	PROP_AVATAR,
 	PROP_HTTP_URL_TO_REPO,
+	PROP_LAST_ACTIVITY_AT,
+	PROP_STAR_COUNT,
+	PROP_OPEN_ISSUES_COUNT,
 	N_PROPS
 };
 
 static GParamSpec *properties [N_PROPS];
 
+/* The members of the project json object, indexed by property */
+static const gchar *member_names [N_PROPS] = {
+	[PROP_ID] = "id",
+	[PROP_NAME] = "name_with_namespace",
+	[PROP_DESCRIPTION] = "description",
+	[PROP_AVATAR] = "avatar_url",
+	[PROP_HTTP_URL_TO_REPO] = "http_url_to_repo",
+	[PROP_LAST_ACTIVITY_AT] = "last_activity_at",
+	[PROP_STAR_COUNT] = "star_count",
+	[PROP_OPEN_ISSUES_COUNT] = "open_issues_count",
+};
+
+#define GITLAB_PROJECT_ALL_PROPS (((1u << N_PROPS) - 1) & ~1u)
+
+static gchar **
+gitlab_project_get_string_field (GitlabProject *self,
+                                 guint          prop_id)
+{
+	switch (prop_id)
+	  {
+		case PROP_NAME:
+			return &self->name;
+		case PROP_DESCRIPTION:
+			return &self->description;
+		case PROP_AVATAR:
+			return &self->avatar;
+		case PROP_HTTP_URL_TO_REPO:
+			return &self->http_url_to_repo;
+		case PROP_LAST_ACTIVITY_AT:
+			return &self->last_activity_at;
+		default:
+			return NULL;
+	  }
+}
+
+static gint *
+gitlab_project_get_int_field (GitlabProject *self,
+                              guint          prop_id)
+{
+	switch (prop_id)
+	  {
+		case PROP_ID:
+			return &self->id;
+		case PROP_STAR_COUNT:
+			return &self->star_count;
+		case PROP_OPEN_ISSUES_COUNT:
+			return &self->open_issues_count;
+		default:
+			return NULL;
+	  }
+}
+
+static void
+gitlab_project_take_string (GitlabProject *self,
+                            guint          prop_id,
+                            gchar        **field,
+                            gchar         *value)
+{
+	if ((self->pooled_props & (1u << prop_id)) == 0)
+		g_free (*field);
+	self->pooled_props &= ~(1u << prop_id);
+	*field = value;
+}
+
+static void
+gitlab_project_intern_string (GitlabProject *self,
+                              guint          prop_id,
+                              gchar        **field,
+                              const gchar   *value)
+{
+	gitlab_project_take_string (self, prop_id, field,
+	                            (gchar *) _gitlab_string_pool_insert (self->pool, value));
+	self->pooled_props |= 1u << prop_id;
+}
+
+/*
+ * Decodes the value @token of the member for @prop_id. Members without a
+ * field, or with a value of the wrong type, are skipped.
+ */
+static gboolean
+gitlab_project_decode_member (GitlabProject     *self,
+                              guint              prop_id,
+                              GitlabJsonScanner *scanner,
+                              GitlabJsonToken    token,
+                              GString           *scratch)
+{
+	gchar **string_field = gitlab_project_get_string_field (self, prop_id);
+	gint *int_field = gitlab_project_get_int_field (self, prop_id);
+
+	if (int_field != NULL && token == GITLAB_JSON_TOKEN_NUMBER) {
+		*int_field = _gitlab_json_scanner_get_int (scanner);
+	} else if (string_field != NULL && token == GITLAB_JSON_TOKEN_STRING && self->pool != NULL) {
+		_gitlab_json_scanner_get_string (scanner, scratch);
+		gitlab_project_intern_string (self, prop_id, string_field, scratch->str);
+	} else if (string_field != NULL && token == GITLAB_JSON_TOKEN_STRING) {
+		gitlab_project_take_string (self, prop_id, string_field,
+		                            _gitlab_json_scanner_dup_string (scanner));
+	} else {
+		return _gitlab_json_scanner_skip_value (scanner, token);
+	}
+
+	return TRUE;
+}
+
+static guint
+gitlab_project_lookup_member (GitlabJsonScanner *scanner)
+{
+	for (guint i = PROP_ID; i < N_PROPS; i++) {
+		if (_gitlab_json_scanner_string_equal (scanner, member_names[i]))
+			return i;
+	}
+
+	return PROP_0;
+}
+
+/*
+ * Decodes the member for @prop_id of a lazy project on first access.
+ * The copy of the object is dropped once every member was decoded.
+ */
+static void
+gitlab_project_materialize (GitlabProject *self,
+                            guint          prop_id)
+{
+	GitlabJsonScanner scanner;
+	GitlabJsonToken token;
+	const gchar *data;
+	gsize length;
+
+	if (g_atomic_pointer_get (&self->raw) == NULL || prop_id == PROP_0 || prop_id >= N_PROPS)
+		return;
+
+	g_mutex_lock (&self->lock);
+
+	if (self->raw == NULL || (self->decoded_props & (1u << prop_id)) != 0) {
+		g_mutex_unlock (&self->lock);
+		return;
+	}
+
+	data = g_bytes_get_data (self->raw, &length);
+	_gitlab_json_scanner_init (&scanner, data, length);
+	_gitlab_json_scanner_next (&scanner);
+
+	while (_gitlab_json_scanner_next (&scanner) == GITLAB_JSON_TOKEN_STRING) {
+		gboolean match = _gitlab_json_scanner_string_equal (&scanner, member_names[prop_id]);
+
+		token = _gitlab_json_scanner_next (&scanner);
+		if (match) {
+			gitlab_project_decode_member (self, prop_id, &scanner, token, NULL);
+			break;
+		}
+		if (!_gitlab_json_scanner_skip_value (&scanner, token))
+			break;
+	}
+
+	self->decoded_props |= 1u << prop_id;
+
+	if ((self->decoded_props & GITLAB_PROJECT_ALL_PROPS) == GITLAB_PROJECT_ALL_PROPS) {
+		g_bytes_unref (self->raw);
+		g_atomic_pointer_set (&self->raw, NULL);
+	}
+
+	g_mutex_unlock (&self->lock);
+}
+
 GitlabProject *
 gitlab_project_new_from_node (JsonNode *node)
 {
 	JsonObject *object = json_node_get_object (node);
+	GitlabProject *self = g_object_new (GITLAB_TYPE_PROJECT, NULL);
 
-	gint id = json_object_get_int_member (object, "id");
-	g_autofree gchar *name = g_strdup (json_object_get_string_member (object, "name_with_namespace"));
-	g_autofree gchar *description = g_strdup (json_object_get_string_member (object, "description"));
-	g_autofree gchar *avatar = g_strdup (json_object_get_string_member (object, "avatar_url"));
-	g_autofree gchar *http_url_to_repo = g_strdup (json_object_get_string_member (object, "http_url_to_repo"));
+	for (guint i = PROP_ID; i < N_PROPS; i++) {
+		JsonNode *member = json_object_get_member (object, member_names[i]);
+		gchar **string_field = gitlab_project_get_string_field (self, i);
+		gint *int_field = gitlab_project_get_int_field (self, i);
 
-	GitlabProject *self = g_object_new (GITLAB_TYPE_PROJECT,
-											 "id", id,
-											 "name", name,
-											 "description", description,
-											 "avatar", avatar,
-											 "http-url-to-repo", http_url_to_repo,
-											 NULL);
+		if (member == NULL || !JSON_NODE_HOLDS_VALUE (member))
+			continue;
+
+		if (int_field != NULL)
+			*int_field = json_node_get_int (member);
+		else if (string_field != NULL)
+			gitlab_project_take_string (self, i, string_field, json_node_dup_string (member));
+	}
 
 	return self;
 }
 
+/*
+ * Decodes the members of a project object straight from @scanner, which is
+ * positioned right after the opening brace. Strings are handed over to the
+ * project instead of going through the property machinery, or stored in
+ * @pool if given. All other members are skipped.
+ */
+GitlabProject *
+_gitlab_project_new_from_scanner (GitlabJsonScanner  *scanner,
+                                  GitlabStringPool   *pool,
+                                  GString            *scratch,
+                                  GError            **error)
+{
+	g_autoptr(GitlabProject) self = g_object_new (GITLAB_TYPE_PROJECT, NULL);
+	GitlabJsonToken token;
+
+	if (pool != NULL)
+		self->pool = _gitlab_string_pool_ref (pool);
+
+	while ((token = _gitlab_json_scanner_next (scanner)) == GITLAB_JSON_TOKEN_STRING) {
+		guint prop_id = gitlab_project_lookup_member (scanner);
+
+		token = _gitlab_json_scanner_next (scanner);
+
+		if (!gitlab_project_decode_member (self, prop_id, scanner, token, scratch)) {
+			token = GITLAB_JSON_TOKEN_ERROR;
+			break;
+		}
+	}
+
+	if (token != GITLAB_JSON_TOKEN_END_OBJECT) {
+		g_set_error (error, GITLAB_ERROR, GITLAB_ERROR_PARSE,
+		             "Malformed project at offset %" G_GSIZE_FORMAT ": %s",
+		             scanner->pos,
+		             scanner->error_message ? scanner->error_message : "Expected a member name");
+		return NULL;
+	}
+
+	return g_steal_pointer (&self);
+}
+
+/*
+ * Like _gitlab_project_new_from_scanner(), but only decodes the id and
+ * keeps a copy of the object from @bytes, the body @scanner runs over.
+ * The cost is one pass over the object and a single allocation, no matter
+ * how many members it has.
+ */
+GitlabProject *
+_gitlab_project_new_lazy (GitlabJsonScanner  *scanner,
+                          GBytes             *bytes,
+                          GError            **error)
+{
+	g_autoptr(GitlabProject) self = g_object_new (GITLAB_TYPE_PROJECT, NULL);
+	GitlabJsonToken token;
+	gsize start = scanner->token_start;
+
+	while ((token = _gitlab_json_scanner_next (scanner)) == GITLAB_JSON_TOKEN_STRING) {
+		gboolean is_id = _gitlab_json_scanner_string_equal (scanner, "id");
+
+		token = _gitlab_json_scanner_next (scanner);
+
+		if (is_id && token == GITLAB_JSON_TOKEN_NUMBER) {
+			self->id = _gitlab_json_scanner_get_int (scanner);
+		} else if (!_gitlab_json_scanner_skip_value (scanner, token)) {
+			token = GITLAB_JSON_TOKEN_ERROR;
+			break;
+		}
+	}
+
+	if (token != GITLAB_JSON_TOKEN_END_OBJECT) {
+		g_set_error (error, GITLAB_ERROR, GITLAB_ERROR_PARSE,
+		             "Malformed project at offset %" G_GSIZE_FORMAT ": %s",
+		             scanner->pos,
+		             scanner->error_message ? scanner->error_message : "Expected a member name");
+		return NULL;
+	}
+
+	/*
+	 * A slice made with g_bytes_new_from_bytes() would keep the whole page
+	 * alive for as long as the project, so copy the object instead.
+	 */
+	self->raw = g_bytes_new ((const gchar *) g_bytes_get_data (bytes, NULL) + start,
+	                         scanner->token_end - start);
+	self->decoded_props = 1u << PROP_ID;
+
+	return g_steal_pointer (&self);
+}
+
 GitlabProject *
 gitlab_project_new (int id, gchar *name, gchar *description, gchar *avatar)
 {
@@ -80,10 +356,14 @@ gitlab_project_finalize (GObject *object)
 {
 	GitlabProject *self = (GitlabProject *)object;
 
-	g_free (self->name);
-	g_free (self->description);
-	g_free (self->avatar);
-	g_free (self->http_url_to_repo);
+	gitlab_project_take_string (self, PROP_NAME, &self->name, NULL);
+	gitlab_project_take_string (self, PROP_DESCRIPTION, &self->description, NULL);
+	gitlab_project_take_string (self, PROP_AVATAR, &self->avatar, NULL);
+	gitlab_project_take_string (self, PROP_HTTP_URL_TO_REPO, &self->http_url_to_repo, NULL);
+	gitlab_project_take_string (self, PROP_LAST_ACTIVITY_AT, &self->last_activity_at, NULL);
+	g_clear_pointer (&self->pool, _gitlab_string_pool_unref);
+	g_clear_pointer (&self->raw, g_bytes_unref);
+	g_mutex_clear (&self->lock);
 
 	G_OBJECT_CLASS (gitlab_project_parent_class)->finalize (object);
 }
@@ -96,6 +376,8 @@ gitlab_project_get_property (GObject    *object,
 {
 	GitlabProject *self = GITLAB_PROJECT (object);
 
+	gitlab_project_materialize (self, prop_id);
+
 	switch (prop_id)
 	  {
 		case PROP_ID:
@@ -113,6 +395,15 @@ gitlab_project_get_property (GObject    *object,
 		case PROP_HTTP_URL_TO_REPO:
 			g_value_set_string (value, self->http_url_to_repo);
 			break;
+		case PROP_LAST_ACTIVITY_AT:
+			g_value_set_string (value, self->last_activity_at);
+			break;
+		case PROP_STAR_COUNT:
+			g_value_set_int (value, self->star_count);
+			break;
+		case PROP_OPEN_ISSUES_COUNT:
+			g_value_set_int (value, self->open_issues_count);
+			break;
 	  default:
 	    G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 	  }
@@ -126,22 +417,35 @@ gitlab_project_set_property (GObject      *object,
 {
 	GitlabProject *self = GITLAB_PROJECT (object);
 
+	g_mutex_lock (&self->lock);
+	self->decoded_props |= 1u << prop_id;
+	g_mutex_unlock (&self->lock);
+
 	switch (prop_id)
 	  {
 		case PROP_ID:
 			self->id = g_value_get_int (value);
 			break;
 		case PROP_NAME:
-			self->name = g_value_dup_string (value);
+			gitlab_project_take_string (self, prop_id, &self->name, g_value_dup_string (value));
 			break;
 		case PROP_DESCRIPTION:
-			self->description = g_value_dup_string (value);
+			gitlab_project_take_string (self, prop_id, &self->description, g_value_dup_string (value));
 			break;
 		case PROP_AVATAR:
-			self->avatar = g_value_dup_string (value);
+			gitlab_project_take_string (self, prop_id, &self->avatar, g_value_dup_string (value));
 			break;
 		case PROP_HTTP_URL_TO_REPO:
-			self->http_url_to_repo = g_value_dup_string (value);
+			gitlab_project_take_string (self, prop_id, &self->http_url_to_repo, g_value_dup_string (value));
+			break;
+		case PROP_LAST_ACTIVITY_AT:
+			gitlab_project_take_string (self, prop_id, &self->last_activity_at, g_value_dup_string (value));
+			break;
+		case PROP_STAR_COUNT:
+			self->star_count = g_value_get_int (value);
+			break;
+		case PROP_OPEN_ISSUES_COUNT:
+			self->open_issues_count = g_value_get_int (value);
 			break;
 	  default:
 	    G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
@@ -172,6 +476,15 @@ gitlab_project_class_init (GitlabProjectClass *klass)
 	properties[PROP_HTTP_URL_TO_REPO] =
 		g_param_spec_string ("http-url-to-repo", "Http-url-to-repo", "The http url of the repository", "", G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
 
+	properties[PROP_LAST_ACTIVITY_AT] =
+		g_param_spec_string ("last-activity-at", "Last-activity-at", "The ISO 8601 time of the last activity in the project", "", G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+	properties[PROP_STAR_COUNT] =
+		g_param_spec_int ("star-count", "Star-count", "The number of users who starred the project", 0, G_MAXINT, 0, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+	properties[PROP_OPEN_ISSUES_COUNT] =
+		g_param_spec_int ("open-issues-count", "Open-issues-count", "The number of open issues, 0 in the simple representation", 0, G_MAXINT, 0, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
 	g_object_class_install_properties (object_class, N_PROPS, properties);
 
 }
@@ -179,6 +492,7 @@ gitlab_project_class_init (GitlabProjectClass *klass)
 static void
 gitlab_project_init (GitlabProject *self)
 {
+	g_mutex_init (&self->lock);
 }
 
 gint
@@ -190,23 +504,143 @@ gitlab_project_get_id (GitlabProject *self)
 gchar *
 gitlab_project_get_name (GitlabProject *self)
 {
+	gitlab_project_materialize (self, PROP_NAME);
+
 	return self->name;
 }
 
 gchar *
 gitlab_project_get_description (GitlabProject *self)
 {
+	gitlab_project_materialize (self, PROP_DESCRIPTION);
+
 	return self->description;
 }
 
 gchar *
 gitlab_project_get_avatar (GitlabProject *self)
 {
+	gitlab_project_materialize (self, PROP_AVATAR);
+
 	return self->avatar;
 }
 
 gchar *
 gitlab_project_get_http_url_to_repo (GitlabProject *self)
 {
+	gitlab_project_materialize (self, PROP_HTTP_URL_TO_REPO);
+
 	return self->http_url_to_repo;
 }
+
+gchar *
+gitlab_project_get_last_activity_at (GitlabProject *self)
+{
+	gitlab_project_materialize (self, PROP_LAST_ACTIVITY_AT);
+
+	return self->last_activity_at;
+}
+
+gint
+gitlab_project_get_star_count (GitlabProject *self)
+{
+	gitlab_project_materialize (self, PROP_STAR_COUNT);
+
+	return self->star_count;
+}
+
+/**
+ * gitlab_project_get_open_issues_count:
+ * @self: a #GitlabProject
+ *
+ * The simple representation that #GitlabProjectQuery requests by default
+ * has no open issue count. It is only filled in for projects listed with
+ * gitlab_project_query_set_simple() set to %FALSE or loaded through
+ * gitlab_client_get_project_summaries_async(), and is 0 otherwise.
+ *
+ * Returns: the number of open issues of the project
+ */
+gint
+gitlab_project_get_open_issues_count (GitlabProject *self)
+{
+	gitlab_project_materialize (self, PROP_OPEN_ISSUES_COUNT);
+
+	return self->open_issues_count;
+}
+
+static void
+gitlab_project_load_avatar_cb (GObject      *object,
+                               GAsyncResult *result,
+                               gpointer      user_data)
+{
+	g_autoptr(GTask) task = user_data;
+	GError *error = NULL;
+	GBytes *bytes;
+
+	bytes = _gitlab_client_load_image_finish (GITLAB_CLIENT (object), result, &error);
+	if (bytes == NULL)
+		g_task_return_error (task, error);
+	else
+		g_task_return_pointer (task, bytes, (GDestroyNotify) g_bytes_unref);
+}
+
+/**
+ * gitlab_project_load_avatar_async:
+ * @project: a #GitlabProject
+ * @client: the #GitlabClient to load the avatar with
+ * @callback: the callback for the async operation
+ * @cancellable: (nullable): a #GCancellable, or %NULL
+ * @user_data: user defined parameter
+ *
+ * Loads the image behind #GitlabProject:avatar. Avatars are cached by
+ * @client in memory and on disk, so showing many projects downloads
+ * every distinct avatar at most once.
+ */
+void
+gitlab_project_load_avatar_async (GitlabProject       *project,
+                                  GitlabClient        *client,
+                                  GAsyncReadyCallback  callback,
+                                  GCancellable        *cancellable,
+                                  gpointer             user_data)
+{
+	g_autoptr(GTask) task = NULL;
+	const gchar *avatar;
+
+	g_assert (GITLAB_IS_PROJECT (project));
+	g_assert (GITLAB_IS_CLIENT (client));
+
+	task = g_task_new (project, cancellable, callback, user_data);
+	g_task_set_source_tag (task, gitlab_project_load_avatar_async);
+
+	avatar = gitlab_project_get_avatar (project);
+	if (avatar == NULL || *avatar == '\0') {
+		g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_NOT_FOUND,
+		                         "Project %d has no avatar", project->id);
+		return;
+	}
+
+	_gitlab_client_load_image_async (client,
+	                                 avatar,
+	                                 cancellable,
+	                                 gitlab_project_load_avatar_cb,
+	                                 g_steal_pointer (&task));
+}
+
+/**
+ * gitlab_project_load_avatar_finish:
+ * @project: a #GitlabProject
+ * @res: a #GAsyncResult
+ * @error: a #GError
+ *
+ * Returns: (transfer full): the encoded image
+ */
+GBytes *
+gitlab_project_load_avatar_finish (GitlabProject  *project,
+                                   GAsyncResult   *res,
+                                   GError        **error)
+{
+	g_assert (GITLAB_IS_PROJECT (project));
+	g_assert (g_task_is_valid (res, project));
+
+	return g_task_propagate_pointer (G_TASK (res), error);
+}
@@ -33,5 +33,8 @@ gchar *gitlab_project_get_name (GitlabProject *self);
 gchar *gitlab_project_get_description (GitlabProject *self);
 gchar *gitlab_project_get_avatar (GitlabProject *self);
 gchar *gitlab_project_get_http_url_to_repo (GitlabProject *self);
+gchar *gitlab_project_get_last_activity_at (GitlabProject *self);
+gint   gitlab_project_get_star_count (GitlabProject *self);
+gint   gitlab_project_get_open_issues_count (GitlabProject *self);
 
 G_END_DECLS
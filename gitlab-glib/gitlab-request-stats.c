@@ -0,0 +1,59 @@
+/* gitlab-request-stats.c
+ *
+ * Copyright (C) 2017 Günther Wutz <info@gunibert.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gitlab-request-stats.h"
+
+G_DEFINE_BOXED_TYPE (GitlabRequestStats, gitlab_request_stats, gitlab_request_stats_copy, gitlab_request_stats_free)
+
+/**
+ * gitlab_request_stats_copy:
+ * @self: a #GitlabRequestStats
+ *
+ * Copies the stats passed to #GitlabClient::request-finished, which are
+ * only valid during the emission.
+ *
+ * Returns: (transfer full): a copy of @self, free it with
+ *   gitlab_request_stats_free()
+ */
+GitlabRequestStats *
+gitlab_request_stats_copy (const GitlabRequestStats *self)
+{
+	GitlabRequestStats *copy;
+
+	g_assert (self != NULL);
+
+	copy = g_new (GitlabRequestStats, 1);
+	*copy = *self;
+	copy->endpoint = g_strdup (self->endpoint);
+
+	return copy;
+}
+
+/**
+ * gitlab_request_stats_free:
+ * @self: a #GitlabRequestStats from gitlab_request_stats_copy()
+ */
+void
+gitlab_request_stats_free (GitlabRequestStats *self)
+{
+	if (self == NULL)
+		return;
+
+	g_free ((gchar *) self->endpoint);
+	g_free (self);
+}
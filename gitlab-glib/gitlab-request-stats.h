@@ -0,0 +1,92 @@
+/* gitlab-request-stats.h
+ *
+ * Copyright (C) 2017 Günther Wutz <info@gunibert.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+/**
+ * GitlabRequestPhase:
+ * @GITLAB_REQUEST_PHASE_QUEUED: waiting for the scheduler and a connection
+ * @GITLAB_REQUEST_PHASE_DNS: resolving the host name
+ * @GITLAB_REQUEST_PHASE_CONNECT: establishing the TCP connection
+ * @GITLAB_REQUEST_PHASE_TLS: the TLS handshake
+ * @GITLAB_REQUEST_PHASE_WAIT: from the written request to the response headers
+ * @GITLAB_REQUEST_PHASE_TRANSFER: reading the response body
+ * @GITLAB_REQUEST_PHASE_PARSE: decoding the body into objects
+ * @GITLAB_REQUEST_N_PHASES: the number of phases
+ *
+ * The phases a request goes through. Phases a request skipped, like DNS
+ * on a kept-alive connection, take no time.
+ */
+typedef enum
+{
+	GITLAB_REQUEST_PHASE_QUEUED,
+	GITLAB_REQUEST_PHASE_DNS,
+	GITLAB_REQUEST_PHASE_CONNECT,
+	GITLAB_REQUEST_PHASE_TLS,
+	GITLAB_REQUEST_PHASE_WAIT,
+	GITLAB_REQUEST_PHASE_TRANSFER,
+	GITLAB_REQUEST_PHASE_PARSE,
+	GITLAB_REQUEST_N_PHASES
+} GitlabRequestPhase;
+
+/**
+ * GitlabCacheOutcome:
+ * @GITLAB_CACHE_OUTCOME_NONE: the response cache was not involved
+ * @GITLAB_CACHE_OUTCOME_MISS: the response was downloaded and parsed
+ * @GITLAB_CACHE_OUTCOME_HIT: the server answered 304 and the cached objects were reused
+ */
+typedef enum
+{
+	GITLAB_CACHE_OUTCOME_NONE,
+	GITLAB_CACHE_OUTCOME_MISS,
+	GITLAB_CACHE_OUTCOME_HIT,
+} GitlabCacheOutcome;
+
+/**
+ * GitlabRequestStats:
+ * @endpoint: the path of the request, without host and query
+ * @status: the HTTP status, or a libsoup transport error status
+ * @phase_usec: microseconds spent in each #GitlabRequestPhase
+ * @bytes: the size of the response body as read, after decompression
+ * @items: the number of objects parsed from the body
+ * @cache: the #GitlabCacheOutcome
+ *
+ * Describes one finished request, see #GitlabClient::request-finished.
+ */
+typedef struct
+{
+	const gchar        *endpoint;
+	guint               status;
+	gint64              phase_usec[GITLAB_REQUEST_N_PHASES];
+	gsize               bytes;
+	guint               items;
+	GitlabCacheOutcome  cache;
+} GitlabRequestStats;
+
+#define GITLAB_TYPE_REQUEST_STATS (gitlab_request_stats_get_type())
+
+GType               gitlab_request_stats_get_type (void);
+GitlabRequestStats *gitlab_request_stats_copy     (const GitlabRequestStats *self);
+void                gitlab_request_stats_free     (GitlabRequestStats       *self);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (GitlabRequestStats, gitlab_request_stats_free)
+
+G_END_DECLS
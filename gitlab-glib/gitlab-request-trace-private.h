@@ -0,0 +1,40 @@
+/* gitlab-request-trace-private.h
+ *
+ * Copyright (C) 2017 Günther Wutz <info@gunibert.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <libsoup/soup.h>
+#include "gitlab-request-stats.h"
+
+G_BEGIN_DECLS
+
+typedef struct _GitlabRequestTrace GitlabRequestTrace;
+
+GitlabRequestTrace *_gitlab_request_trace_new         (SoupMessage        *msg);
+void                _gitlab_request_trace_free        (GitlabRequestTrace *self);
+void                _gitlab_request_trace_read        (GitlabRequestTrace *self,
+                                                       gsize               bytes);
+void                _gitlab_request_trace_parsed      (GitlabRequestTrace *self,
+                                                       guint               items);
+void                _gitlab_request_trace_set_cache   (GitlabRequestTrace *self,
+                                                       GitlabCacheOutcome  cache);
+const GitlabRequestStats *
+                    _gitlab_request_trace_finish      (GitlabRequestTrace *self);
+gint64              _gitlab_request_trace_get_start   (GitlabRequestTrace *self);
+SoupMessage        *_gitlab_request_trace_get_message (GitlabRequestTrace *self);
+
+G_END_DECLS
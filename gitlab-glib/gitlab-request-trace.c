@@ -0,0 +1,229 @@
+/* gitlab-request-trace.c
+ *
+ * Copyright (C) 2017 Günther Wutz <info@gunibert.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * A trace follows one SoupMessage from the moment it is handed to the
+ * scheduler until its body was parsed. The network phases are taken from
+ * the signals of the message, the later ones are marked by the caller.
+ */
+
+#include "gitlab-request-trace-private.h"
+
+typedef enum
+{
+	MARK_CREATED,
+	MARK_RESOLVING,
+	MARK_RESOLVED,
+	MARK_CONNECTING,
+	MARK_CONNECTED,
+	MARK_TLS_HANDSHAKING,
+	MARK_TLS_HANDSHAKED,
+	MARK_WROTE_HEADERS,
+	MARK_WROTE_BODY,
+	MARK_GOT_HEADERS,
+	MARK_READ,
+	MARK_PARSED,
+	N_MARKS
+} GitlabRequestMark;
+
+struct _GitlabRequestTrace
+{
+	SoupMessage        *msg;
+	gchar              *endpoint;
+	gint64              marks[N_MARKS];
+	GitlabRequestStats  stats;
+};
+
+static void
+gitlab_request_trace_mark (GitlabRequestTrace *self,
+                           GitlabRequestMark   mark)
+{
+	/* Redirects and retries go through the signals again, keep the first */
+	if (self->marks[mark] == 0)
+		self->marks[mark] = g_get_monotonic_time ();
+}
+
+static void
+gitlab_request_trace_network_event_cb (SoupMessage        *msg,
+                                       GSocketClientEvent  event,
+                                       GIOStream          *connection,
+                                       gpointer            user_data)
+{
+	GitlabRequestTrace *self = user_data;
+
+	switch (event)
+	  {
+		case G_SOCKET_CLIENT_RESOLVING:
+			gitlab_request_trace_mark (self, MARK_RESOLVING);
+			break;
+		case G_SOCKET_CLIENT_RESOLVED:
+			gitlab_request_trace_mark (self, MARK_RESOLVED);
+			break;
+		case G_SOCKET_CLIENT_CONNECTING:
+			gitlab_request_trace_mark (self, MARK_CONNECTING);
+			break;
+		case G_SOCKET_CLIENT_CONNECTED:
+			gitlab_request_trace_mark (self, MARK_CONNECTED);
+			break;
+		case G_SOCKET_CLIENT_TLS_HANDSHAKING:
+			gitlab_request_trace_mark (self, MARK_TLS_HANDSHAKING);
+			break;
+		case G_SOCKET_CLIENT_TLS_HANDSHAKED:
+			gitlab_request_trace_mark (self, MARK_TLS_HANDSHAKED);
+			break;
+		default:
+			break;
+	  }
+}
+
+static void
+gitlab_request_trace_wrote_headers_cb (SoupMessage *msg,
+                                       gpointer     user_data)
+{
+	gitlab_request_trace_mark (user_data, MARK_WROTE_HEADERS);
+}
+
+static void
+gitlab_request_trace_wrote_body_cb (SoupMessage *msg,
+                                    gpointer     user_data)
+{
+	gitlab_request_trace_mark (user_data, MARK_WROTE_BODY);
+}
+
+static void
+gitlab_request_trace_got_headers_cb (SoupMessage *msg,
+                                     gpointer     user_data)
+{
+	gitlab_request_trace_mark (user_data, MARK_GOT_HEADERS);
+}
+
+GitlabRequestTrace *
+_gitlab_request_trace_new (SoupMessage *msg)
+{
+	GitlabRequestTrace *self = g_new0 (GitlabRequestTrace, 1);
+
+	self->msg = g_object_ref (msg);
+	self->endpoint = g_strdup (soup_message_get_uri (msg)->path);
+	self->stats.endpoint = self->endpoint;
+	gitlab_request_trace_mark (self, MARK_CREATED);
+
+	g_signal_connect (msg, "network-event",
+	                  G_CALLBACK (gitlab_request_trace_network_event_cb), self);
+	g_signal_connect (msg, "wrote-headers",
+	                  G_CALLBACK (gitlab_request_trace_wrote_headers_cb), self);
+	g_signal_connect (msg, "wrote-body",
+	                  G_CALLBACK (gitlab_request_trace_wrote_body_cb), self);
+	g_signal_connect (msg, "got-headers",
+	                  G_CALLBACK (gitlab_request_trace_got_headers_cb), self);
+
+	return self;
+}
+
+void
+_gitlab_request_trace_free (GitlabRequestTrace *self)
+{
+	if (self == NULL)
+		return;
+
+	g_signal_handlers_disconnect_by_data (self->msg, self);
+	g_object_unref (self->msg);
+	g_free (self->endpoint);
+	g_free (self);
+}
+
+/*
+ * Marks the end of the body, which was @bytes long.
+ */
+void
+_gitlab_request_trace_read (GitlabRequestTrace *self,
+                            gsize               bytes)
+{
+	gitlab_request_trace_mark (self, MARK_READ);
+	self->stats.bytes = bytes;
+}
+
+/*
+ * Marks the end of parsing, which yielded @items objects.
+ */
+void
+_gitlab_request_trace_parsed (GitlabRequestTrace *self,
+                              guint               items)
+{
+	gitlab_request_trace_mark (self, MARK_PARSED);
+	self->stats.items = items;
+}
+
+void
+_gitlab_request_trace_set_cache (GitlabRequestTrace *self,
+                                 GitlabCacheOutcome  cache)
+{
+	self->stats.cache = cache;
+}
+
+gint64
+_gitlab_request_trace_get_start (GitlabRequestTrace *self)
+{
+	return self->marks[MARK_CREATED];
+}
+
+SoupMessage *
+_gitlab_request_trace_get_message (GitlabRequestTrace *self)
+{
+	return self->msg;
+}
+
+static gint64
+gitlab_request_trace_span (GitlabRequestTrace *self,
+                           GitlabRequestMark   from,
+                           GitlabRequestMark   to)
+{
+	if (self->marks[from] == 0 || self->marks[to] < self->marks[from])
+		return 0;
+
+	return self->marks[to] - self->marks[from];
+}
+
+/*
+ * Computes the phases from the marks taken so far. Phases that never
+ * ended, like the transfer of a failed request, stay at zero.
+ */
+const GitlabRequestStats *
+_gitlab_request_trace_finish (GitlabRequestTrace *self)
+{
+	GitlabRequestMark first_network = MARK_WROTE_HEADERS;
+	gint64 *phases = self->stats.phase_usec;
+
+	for (GitlabRequestMark mark = MARK_RESOLVING; mark < MARK_WROTE_HEADERS; mark++) {
+		if (self->marks[mark] != 0) {
+			first_network = mark;
+			break;
+		}
+	}
+
+	phases[GITLAB_REQUEST_PHASE_QUEUED] = gitlab_request_trace_span (self, MARK_CREATED, first_network);
+	phases[GITLAB_REQUEST_PHASE_DNS] = gitlab_request_trace_span (self, MARK_RESOLVING, MARK_RESOLVED);
+	phases[GITLAB_REQUEST_PHASE_CONNECT] = gitlab_request_trace_span (self, MARK_CONNECTING, MARK_CONNECTED);
+	phases[GITLAB_REQUEST_PHASE_TLS] = gitlab_request_trace_span (self, MARK_TLS_HANDSHAKING, MARK_TLS_HANDSHAKED);
+	phases[GITLAB_REQUEST_PHASE_WAIT] = gitlab_request_trace_span (self, MARK_WROTE_BODY, MARK_GOT_HEADERS);
+	phases[GITLAB_REQUEST_PHASE_TRANSFER] = gitlab_request_trace_span (self, MARK_GOT_HEADERS, MARK_READ);
+	phases[GITLAB_REQUEST_PHASE_PARSE] = gitlab_request_trace_span (self, MARK_READ, MARK_PARSED);
+
+	self->stats.status = self->msg->status_code;
+
+	return &self->stats;
+}
@@ -0,0 +1,48 @@
+/* gitlab-response-cache-private.h
+ *
+ * Copyright (C) 2017 Günther Wutz <info@gunibert.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GitlabResponseCache GitlabResponseCache;
+
+GitlabResponseCache *_gitlab_response_cache_new        (guint                 max_items);
+void                 _gitlab_response_cache_free       (GitlabResponseCache  *self);
+void                 _gitlab_response_cache_clear      (GitlabResponseCache  *self);
+gchar               *_gitlab_response_cache_get_etag   (GitlabResponseCache  *self,
+                                                        const gchar          *key);
+gboolean             _gitlab_response_cache_take_hit   (GitlabResponseCache  *self,
+                                                        const gchar          *key,
+                                                        GPtrArray           **items,
+                                                        guint                *total_pages,
+                                                        guint                *next_page,
+                                                        gchar               **next_url);
+void                 _gitlab_response_cache_take_miss  (GitlabResponseCache  *self,
+                                                        const gchar          *key,
+                                                        const gchar          *etag,
+                                                        GPtrArray            *items,
+                                                        guint                 total_pages,
+                                                        guint                 next_page,
+                                                        const gchar          *next_url);
+guint                _gitlab_response_cache_get_hits   (GitlabResponseCache  *self);
+guint                _gitlab_response_cache_get_misses (GitlabResponseCache  *self);
+
+G_END_DECLS
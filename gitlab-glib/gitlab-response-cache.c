@@ -0,0 +1,224 @@
+/* gitlab-response-cache.c
+ *
+ * Copyright (C) 2017 Günther Wutz <info@gunibert.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Remembers the ETag and the already parsed objects of every page that was
+ * downloaded, so that a page can be revalidated with If-None-Match and a
+ * 304 answered from memory without parsing anything. The cache is bounded
+ * by the number of objects it holds and drops the least recently used
+ * pages first. A client may be used from several threads, so the cache is
+ * locked.
+ */
+
+#include "gitlab-response-cache-private.h"
+
+struct _GitlabResponseCache
+{
+	GMutex      mutex;
+	GHashTable *entries;
+	GQueue      lru;
+	guint       n_items;
+	guint       max_items;
+	guint       hits;
+	guint       misses;
+};
+
+typedef struct
+{
+	GList      link;
+	gchar     *key;
+	gchar     *etag;
+	GPtrArray *items;
+	guint      total_pages;
+	guint      next_page;
+	gchar     *next_url;
+} GitlabResponseCacheEntry;
+
+static void
+gitlab_response_cache_entry_free (gpointer data)
+{
+	GitlabResponseCacheEntry *entry = data;
+
+	g_free (entry->key);
+	g_free (entry->etag);
+	g_free (entry->next_url);
+	g_ptr_array_unref (entry->items);
+	g_free (entry);
+}
+
+GitlabResponseCache *
+_gitlab_response_cache_new (guint max_items)
+{
+	GitlabResponseCache *self = g_new0 (GitlabResponseCache, 1);
+
+	g_mutex_init (&self->mutex);
+	g_queue_init (&self->lru);
+	self->max_items = max_items;
+	self->entries = g_hash_table_new_full (g_str_hash, g_str_equal,
+	                                       NULL, gitlab_response_cache_entry_free);
+
+	return self;
+}
+
+void
+_gitlab_response_cache_free (GitlabResponseCache *self)
+{
+	if (self == NULL)
+		return;
+
+	g_hash_table_unref (self->entries);
+	g_mutex_clear (&self->mutex);
+	g_free (self);
+}
+
+void
+_gitlab_response_cache_clear (GitlabResponseCache *self)
+{
+	g_mutex_lock (&self->mutex);
+	g_queue_init (&self->lru);
+	g_hash_table_remove_all (self->entries);
+	self->n_items = 0;
+	g_mutex_unlock (&self->mutex);
+}
+
+/* Called with the mutex held */
+static void
+gitlab_response_cache_remove_locked (GitlabResponseCache      *self,
+                                     GitlabResponseCacheEntry *entry)
+{
+	g_queue_unlink (&self->lru, &entry->link);
+	self->n_items -= entry->items->len;
+	g_hash_table_remove (self->entries, entry->key);
+}
+
+/*
+ * Returns the ETag to send as If-None-Match for @key, or %NULL.
+ */
+gchar *
+_gitlab_response_cache_get_etag (GitlabResponseCache *self,
+                                 const gchar         *key)
+{
+	GitlabResponseCacheEntry *entry;
+	gchar *etag = NULL;
+
+	g_mutex_lock (&self->mutex);
+	entry = g_hash_table_lookup (self->entries, key);
+	if (entry != NULL)
+		etag = g_strdup (entry->etag);
+	g_mutex_unlock (&self->mutex);
+
+	return etag;
+}
+
+/*
+ * Called when the server answered 304 for @key. Returns a new reference
+ * on the cached items.
+ */
+gboolean
+_gitlab_response_cache_take_hit (GitlabResponseCache  *self,
+                                 const gchar          *key,
+                                 GPtrArray           **items,
+                                 guint                *total_pages,
+                                 guint                *next_page,
+                                 gchar               **next_url)
+{
+	GitlabResponseCacheEntry *entry;
+
+	g_mutex_lock (&self->mutex);
+	entry = g_hash_table_lookup (self->entries, key);
+	if (entry != NULL) {
+		g_queue_unlink (&self->lru, &entry->link);
+		g_queue_push_head_link (&self->lru, &entry->link);
+		self->hits++;
+		*items = g_ptr_array_ref (entry->items);
+		*total_pages = entry->total_pages;
+		*next_page = entry->next_page;
+		*next_url = g_strdup (entry->next_url);
+	}
+	g_mutex_unlock (&self->mutex);
+
+	return entry != NULL;
+}
+
+/*
+ * Called when the full response for @key was downloaded and parsed. The
+ * items are only remembered if the server sent an @etag, dropping the
+ * least recently used pages until the cache fits again.
+ */
+void
+_gitlab_response_cache_take_miss (GitlabResponseCache *self,
+                                  const gchar         *key,
+                                  const gchar         *etag,
+                                  GPtrArray           *items,
+                                  guint                total_pages,
+                                  guint                next_page,
+                                  const gchar         *next_url)
+{
+	GitlabResponseCacheEntry *entry;
+
+	g_mutex_lock (&self->mutex);
+
+	self->misses++;
+
+	entry = g_hash_table_lookup (self->entries, key);
+	if (entry != NULL)
+		gitlab_response_cache_remove_locked (self, entry);
+
+	if (etag != NULL && items->len <= self->max_items) {
+		while (self->n_items + items->len > self->max_items)
+			gitlab_response_cache_remove_locked (self, g_queue_peek_tail_link (&self->lru)->data);
+
+		entry = g_new0 (GitlabResponseCacheEntry, 1);
+		entry->link.data = entry;
+		entry->key = g_strdup (key);
+		entry->etag = g_strdup (etag);
+		entry->items = g_ptr_array_ref (items);
+		entry->total_pages = total_pages;
+		entry->next_page = next_page;
+		entry->next_url = g_strdup (next_url);
+		g_queue_push_head_link (&self->lru, &entry->link);
+		g_hash_table_insert (self->entries, entry->key, entry);
+		self->n_items += items->len;
+	}
+
+	g_mutex_unlock (&self->mutex);
+}
+
+guint
+_gitlab_response_cache_get_hits (GitlabResponseCache *self)
+{
+	guint hits;
+
+	g_mutex_lock (&self->mutex);
+	hits = self->hits;
+	g_mutex_unlock (&self->mutex);
+
+	return hits;
+}
+
+guint
+_gitlab_response_cache_get_misses (GitlabResponseCache *self)
+{
+	guint misses;
+
+	g_mutex_lock (&self->mutex);
+	misses = self->misses;
+	g_mutex_unlock (&self->mutex);
+
+	return misses;
+}
@@ -0,0 +1,42 @@
+/* gitlab-scheduler-private.h
+ *
+ * Copyright (C) 2017 Günther Wutz <info@gunibert.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <libsoup/soup.h>
+
+G_BEGIN_DECLS
+
+#define GITLAB_TYPE_SCHEDULER (gitlab_scheduler_get_type())
+
+G_DECLARE_FINAL_TYPE (GitlabScheduler, gitlab_scheduler, GITLAB, SCHEDULER, GObject)
+
+GitlabScheduler *_gitlab_scheduler_new               (SoupSession          *session,
+                                                      guint                 max_in_flight);
+void             _gitlab_scheduler_set_max_in_flight (GitlabScheduler      *self,
+                                                      guint                 max_in_flight);
+void             _gitlab_scheduler_send_async        (GitlabScheduler      *self,
+                                                      SoupMessage          *msg,
+                                                      GCancellable         *cancellable,
+                                                      GAsyncReadyCallback   callback,
+                                                      gpointer              user_data);
+GInputStream    *_gitlab_scheduler_send_finish       (GitlabScheduler      *self,
+                                                      GAsyncResult         *result,
+                                                      GError              **error);
+
+G_END_DECLS
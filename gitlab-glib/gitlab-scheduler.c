@@ -0,0 +1,418 @@
+/* gitlab-scheduler.c
+ *
+ * Copyright (C) 2017 Günther Wutz <info@gunibert.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Every request of a client is queued here before it is handed to the
+ * session. The scheduler follows the RateLimit-* headers of the responses:
+ * while plenty of requests remain, concurrency grows by one per response
+ * up to max-in-flight; when the remaining quota gets low, concurrency is
+ * halved and requests are spread evenly until the quota resets. 429 and 503
+ * responses pause the queue for Retry-After, the reset time, or an
+ * exponential backoff, all with random jitter, and are retried.
+ *
+ * Requests may come from any thread. Each one is dispatched and completed
+ * in the main context it was queued from.
+ */
+
+#include "gitlab-scheduler-private.h"
+#include "gitlab-error.h"
+
+#define GITLAB_SCHEDULER_MAX_ATTEMPTS   5
+#define GITLAB_SCHEDULER_BACKOFF_BASE   ((gint64) G_USEC_PER_SEC / 2)
+#define GITLAB_SCHEDULER_BACKOFF_MAX    ((gint64) G_USEC_PER_SEC * 60)
+#define GITLAB_STATUS_TOO_MANY_REQUESTS 429
+
+struct _GitlabScheduler
+{
+	GObject parent_instance;
+
+	GMutex       mutex;
+	SoupSession *session;
+	GQueue       queue;
+	guint        max_in_flight;
+	guint        limit;
+	guint        in_flight;
+	gint64       not_before;
+	gint64       interval;
+	gboolean     timer_armed;
+};
+
+G_DEFINE_TYPE (GitlabScheduler, gitlab_scheduler, G_TYPE_OBJECT)
+
+typedef struct
+{
+	SoupMessage *msg;
+	GSource     *cancelled_source;
+	guint        attempt;
+} GitlabSchedulerRequest;
+
+typedef enum
+{
+	GITLAB_SCHEDULER_ACCEPT,
+	GITLAB_SCHEDULER_RETRY,
+	GITLAB_SCHEDULER_GIVE_UP,
+} GitlabSchedulerVerdict;
+
+static void gitlab_scheduler_pump (GitlabScheduler *self);
+
+static void
+gitlab_scheduler_request_free (gpointer data)
+{
+	GitlabSchedulerRequest *request = data;
+
+	if (request->cancelled_source != NULL) {
+		g_source_destroy (request->cancelled_source);
+		g_source_unref (request->cancelled_source);
+	}
+	g_object_unref (request->msg);
+	g_free (request);
+}
+
+GitlabScheduler *
+_gitlab_scheduler_new (SoupSession *session,
+                       guint        max_in_flight)
+{
+	GitlabScheduler *self = g_object_new (GITLAB_TYPE_SCHEDULER, NULL);
+
+	self->session = g_object_ref (session);
+	self->max_in_flight = MAX (max_in_flight, 1);
+	self->limit = self->max_in_flight;
+
+	return self;
+}
+
+static void
+gitlab_scheduler_finalize (GObject *object)
+{
+	GitlabScheduler *self = (GitlabScheduler *)object;
+
+	g_assert (g_queue_is_empty (&self->queue));
+
+	g_clear_object (&self->session);
+	g_mutex_clear (&self->mutex);
+
+	G_OBJECT_CLASS (gitlab_scheduler_parent_class)->finalize (object);
+}
+
+static void
+gitlab_scheduler_class_init (GitlabSchedulerClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	object_class->finalize = gitlab_scheduler_finalize;
+}
+
+static void
+gitlab_scheduler_init (GitlabScheduler *self)
+{
+	g_mutex_init (&self->mutex);
+	g_queue_init (&self->queue);
+}
+
+void
+_gitlab_scheduler_set_max_in_flight (GitlabScheduler *self,
+                                     guint            max_in_flight)
+{
+	g_mutex_lock (&self->mutex);
+	self->max_in_flight = MAX (max_in_flight, 1);
+	self->limit = MIN (self->limit, self->max_in_flight);
+	g_mutex_unlock (&self->mutex);
+
+	gitlab_scheduler_pump (self);
+}
+
+static gint64
+gitlab_scheduler_header_int (SoupMessageHeaders *headers,
+                             const gchar        *name)
+{
+	const gchar *value = soup_message_headers_get_one (headers, name);
+	gchar *end = NULL;
+	gint64 result;
+
+	if (value == NULL)
+		return -1;
+
+	result = g_ascii_strtoll (value, &end, 10);
+	if (end == value || result < 0)
+		return -1;
+
+	return result;
+}
+
+/*
+ * Adapts concurrency and pacing to the response of @request and decides
+ * whether it has to be sent again. Called with the mutex held.
+ */
+static GitlabSchedulerVerdict
+gitlab_scheduler_update_locked (GitlabScheduler        *self,
+                                GitlabSchedulerRequest *request)
+{
+	SoupMessageHeaders *headers = request->msg->response_headers;
+	guint status = request->msg->status_code;
+	gint64 now = g_get_monotonic_time ();
+	gint64 remaining = gitlab_scheduler_header_int (headers, "RateLimit-Remaining");
+	gint64 quota = gitlab_scheduler_header_int (headers, "RateLimit-Limit");
+	gint64 reset = gitlab_scheduler_header_int (headers, "RateLimit-Reset");
+	gint64 retry_after = gitlab_scheduler_header_int (headers, "Retry-After");
+	gint64 reset_in = -1;
+	gint64 low_water;
+	gint64 delay;
+
+	if (reset >= 0)
+		reset_in = MAX (0, reset * G_USEC_PER_SEC - g_get_real_time ());
+
+	if (status == GITLAB_STATUS_TOO_MANY_REQUESTS || status == SOUP_STATUS_SERVICE_UNAVAILABLE) {
+		self->limit = MAX (1, self->limit / 2);
+		self->interval = 0;
+
+		if (++request->attempt >= GITLAB_SCHEDULER_MAX_ATTEMPTS) {
+			if (status == GITLAB_STATUS_TOO_MANY_REQUESTS)
+				return GITLAB_SCHEDULER_GIVE_UP;
+			return GITLAB_SCHEDULER_ACCEPT;
+		}
+
+		if (retry_after >= 0)
+			delay = retry_after * G_USEC_PER_SEC;
+		else if (reset_in > 0)
+			delay = reset_in;
+		else
+			delay = MIN (GITLAB_SCHEDULER_BACKOFF_BASE << request->attempt, GITLAB_SCHEDULER_BACKOFF_MAX);
+
+		/* Jitter, so that throttled clients do not come back in lockstep */
+		delay += (gint64) (g_random_double () * delay / 2);
+
+		self->not_before = MAX (self->not_before, now + delay);
+		return GITLAB_SCHEDULER_RETRY;
+	}
+
+	if (remaining < 0) {
+		self->interval = 0;
+		if (self->limit < self->max_in_flight)
+			self->limit++;
+		return GITLAB_SCHEDULER_ACCEPT;
+	}
+
+	low_water = MAX (quota / 10, 2 * (gint64) self->max_in_flight);
+
+	if (remaining == 0 && reset_in > 0) {
+		self->limit = 1;
+		self->interval = 0;
+		self->not_before = MAX (self->not_before, now + reset_in);
+	} else if (remaining < low_water) {
+		self->limit = MAX (1, self->limit / 2);
+		self->interval = (reset_in > 0 && remaining > 0) ? reset_in / remaining : 0;
+	} else {
+		self->interval = 0;
+		if (self->limit < self->max_in_flight)
+			self->limit++;
+	}
+
+	return GITLAB_SCHEDULER_ACCEPT;
+}
+
+static void
+gitlab_scheduler_sent_cb (GObject      *object,
+                          GAsyncResult *result,
+                          gpointer      user_data)
+{
+	g_autoptr(GTask) task = user_data;
+	GitlabScheduler *self = g_task_get_source_object (task);
+	GitlabSchedulerRequest *request = g_task_get_task_data (task);
+	g_autoptr(GInputStream) stream = NULL;
+	GitlabSchedulerVerdict verdict = GITLAB_SCHEDULER_ACCEPT;
+	GError *error = NULL;
+
+	stream = soup_session_send_finish (SOUP_SESSION (object), result, &error);
+
+	g_mutex_lock (&self->mutex);
+	self->in_flight--;
+	if (stream != NULL)
+		verdict = gitlab_scheduler_update_locked (self, request);
+	if (verdict == GITLAB_SCHEDULER_RETRY)
+		g_queue_push_head (&self->queue, g_object_ref (task));
+	g_mutex_unlock (&self->mutex);
+
+	if (stream == NULL)
+		g_task_return_error (task, error);
+	else if (verdict == GITLAB_SCHEDULER_RETRY)
+		g_input_stream_close (stream, NULL, NULL);
+	else if (verdict == GITLAB_SCHEDULER_GIVE_UP)
+		g_task_return_new_error (task, GITLAB_ERROR, GITLAB_ERROR_RATE_LIMITED,
+		                         "Rate limit still exceeded after %u attempts",
+		                         request->attempt);
+	else
+		g_task_return_pointer (task, g_steal_pointer (&stream), g_object_unref);
+
+	gitlab_scheduler_pump (self);
+}
+
+static gboolean
+gitlab_scheduler_dispatch_cb (gpointer data)
+{
+	GTask *task = data;
+	GitlabScheduler *self = g_task_get_source_object (task);
+	GitlabSchedulerRequest *request = g_task_get_task_data (task);
+
+	soup_session_send_async (self->session,
+	                         request->msg,
+	                         g_task_get_cancellable (task),
+	                         gitlab_scheduler_sent_cb,
+	                         g_object_ref (task));
+
+	return G_SOURCE_REMOVE;
+}
+
+static gboolean
+gitlab_scheduler_timeout_cb (gpointer data)
+{
+	GitlabScheduler *self = data;
+
+	g_mutex_lock (&self->mutex);
+	self->timer_armed = FALSE;
+	g_mutex_unlock (&self->mutex);
+
+	gitlab_scheduler_pump (self);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+gitlab_scheduler_pump (GitlabScheduler *self)
+{
+	g_autoptr(GPtrArray) ready = g_ptr_array_new ();
+	g_autoptr(GMainContext) timer_context = NULL;
+	gint64 now = g_get_monotonic_time ();
+	gint64 delay = 0;
+
+	g_mutex_lock (&self->mutex);
+	while (self->in_flight < self->limit && !g_queue_is_empty (&self->queue)) {
+		if (now < self->not_before) {
+			if (!self->timer_armed) {
+				self->timer_armed = TRUE;
+				timer_context = g_main_context_ref (g_task_get_context (g_queue_peek_head (&self->queue)));
+				delay = self->not_before - now;
+			}
+			break;
+		}
+
+		self->in_flight++;
+		g_ptr_array_add (ready, g_queue_pop_head (&self->queue));
+
+		if (self->interval > 0)
+			self->not_before = now + self->interval;
+	}
+	g_mutex_unlock (&self->mutex);
+
+	if (timer_context != NULL) {
+		GSource *source = g_timeout_source_new (delay / 1000 + 1);
+
+		g_source_set_callback (source, gitlab_scheduler_timeout_cb, g_object_ref (self), g_object_unref);
+		g_source_attach (source, timer_context);
+		g_source_unref (source);
+	}
+
+	for (guint i = 0; i < ready->len; i++) {
+		GTask *task = g_ptr_array_index (ready, i);
+
+		g_main_context_invoke_full (g_task_get_context (task),
+		                            G_PRIORITY_DEFAULT,
+		                            gitlab_scheduler_dispatch_cb,
+		                            task,
+		                            g_object_unref);
+	}
+}
+
+static gboolean
+gitlab_scheduler_cancelled_cb (GCancellable *cancellable,
+                               gpointer      user_data)
+{
+	GTask *task = user_data;
+	GitlabScheduler *self = g_task_get_source_object (task);
+	gboolean queued;
+
+	g_mutex_lock (&self->mutex);
+	queued = g_queue_remove (&self->queue, task);
+	g_mutex_unlock (&self->mutex);
+
+	/* Requests already on the wire are cancelled by the session */
+	if (queued) {
+		g_task_return_error_if_cancelled (task);
+		g_object_unref (task);
+	}
+
+	return G_SOURCE_REMOVE;
+}
+
+/*
+ * _gitlab_scheduler_send_async:
+ * @self: a #GitlabScheduler
+ * @msg: the message to send
+ * @cancellable: (nullable): a #GCancellable, or %NULL
+ * @callback: called once the response headers arrived
+ * @user_data: user data for @callback
+ *
+ * Queues @msg and sends it as soon as the rate limit allows. Requests
+ * answered with 429 or 503 are retried transparently.
+ */
+void
+_gitlab_scheduler_send_async (GitlabScheduler     *self,
+                              SoupMessage         *msg,
+                              GCancellable        *cancellable,
+                              GAsyncReadyCallback  callback,
+                              gpointer             user_data)
+{
+	GitlabSchedulerRequest *request;
+	GTask *task;
+
+	g_assert (GITLAB_IS_SCHEDULER (self));
+	g_assert (SOUP_IS_MESSAGE (msg));
+	g_assert (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+	task = g_task_new (self, cancellable, callback, user_data);
+	g_task_set_source_tag (task, _gitlab_scheduler_send_async);
+
+	request = g_new0 (GitlabSchedulerRequest, 1);
+	request->msg = g_object_ref (msg);
+	g_task_set_task_data (task, request, gitlab_scheduler_request_free);
+
+	if (cancellable != NULL) {
+		request->cancelled_source = g_cancellable_source_new (cancellable);
+		g_source_set_callback (request->cancelled_source,
+		                       (GSourceFunc) gitlab_scheduler_cancelled_cb,
+		                       task, NULL);
+		g_source_attach (request->cancelled_source, g_task_get_context (task));
+	}
+
+	/* The queue owns the reference until the request is dispatched */
+	g_mutex_lock (&self->mutex);
+	g_queue_push_tail (&self->queue, task);
+	g_mutex_unlock (&self->mutex);
+
+	gitlab_scheduler_pump (self);
+}
+
+GInputStream *
+_gitlab_scheduler_send_finish (GitlabScheduler  *self,
+                               GAsyncResult     *result,
+                               GError          **error)
+{
+	g_assert (GITLAB_IS_SCHEDULER (self));
+	g_assert (G_IS_TASK (result));
+
+	return g_task_propagate_pointer (G_TASK (result), error);
+}
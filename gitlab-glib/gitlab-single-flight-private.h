@@ -0,0 +1,37 @@
+/* gitlab-single-flight-private.h
+ *
+ * Copyright (C) 2017 Günther Wutz <info@gunibert.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GitlabSingleFlight GitlabSingleFlight;
+typedef struct _GitlabFlight GitlabFlight;
+
+GitlabSingleFlight *_gitlab_single_flight_new     (void);
+void                _gitlab_single_flight_free    (GitlabSingleFlight *self);
+GitlabFlight       *_gitlab_single_flight_join    (GitlabSingleFlight *self,
+                                                   const gchar        *key,
+                                                   GTask              *task);
+GPtrArray          *_gitlab_single_flight_land    (GitlabSingleFlight *self,
+                                                   GitlabFlight       *flight);
+GCancellable       *_gitlab_flight_get_cancellable (GitlabFlight      *flight);
+
+G_END_DECLS
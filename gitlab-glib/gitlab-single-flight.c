@@ -0,0 +1,233 @@
+/* gitlab-single-flight.c
+ *
+ * Copyright (C) 2017 Günther Wutz <info@gunibert.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Coalesces identical requests that are in flight at the same time. The
+ * first caller for a key becomes the leader and performs the request, all
+ * later callers only wait for it. When it lands, the leader completes every
+ * waiting task from the shared result.
+ *
+ * A waiter whose cancellable fires leaves right away. Once the last waiter
+ * left, the shared request is cancelled and the key is free again.
+ */
+
+#include "gitlab-single-flight-private.h"
+
+struct _GitlabSingleFlight
+{
+	GMutex      mutex;
+	GHashTable *flights;
+};
+
+struct _GitlabFlight
+{
+	gint                ref_count;
+	GitlabSingleFlight *owner;
+	gchar              *key;
+	GCancellable       *cancellable;
+	GPtrArray          *waiters;
+	gboolean            detached;
+};
+
+typedef struct
+{
+	GitlabFlight *flight;
+	GTask        *task;
+	GSource      *source;
+} GitlabFlightWaiter;
+
+static void
+gitlab_flight_unref (GitlabFlight *flight)
+{
+	if (g_atomic_int_dec_and_test (&flight->ref_count)) {
+		g_ptr_array_unref (flight->waiters);
+		g_object_unref (flight->cancellable);
+		g_free (flight->key);
+		g_free (flight);
+	}
+}
+
+static void
+gitlab_flight_waiter_free (gpointer data)
+{
+	GitlabFlightWaiter *waiter = data;
+
+	g_clear_pointer (&waiter->source, g_source_unref);
+	g_object_unref (waiter->task);
+	gitlab_flight_unref (waiter->flight);
+	g_free (waiter);
+}
+
+GitlabSingleFlight *
+_gitlab_single_flight_new (void)
+{
+	GitlabSingleFlight *self = g_new0 (GitlabSingleFlight, 1);
+
+	g_mutex_init (&self->mutex);
+	self->flights = g_hash_table_new_full (g_str_hash, g_str_equal,
+	                                       NULL, (GDestroyNotify) gitlab_flight_unref);
+
+	return self;
+}
+
+void
+_gitlab_single_flight_free (GitlabSingleFlight *self)
+{
+	if (self == NULL)
+		return;
+
+	g_hash_table_unref (self->flights);
+	g_mutex_clear (&self->mutex);
+	g_free (self);
+}
+
+/* Called with the mutex held */
+static void
+gitlab_single_flight_detach_locked (GitlabSingleFlight *self,
+                                    GitlabFlight       *flight)
+{
+	if (!flight->detached) {
+		flight->detached = TRUE;
+		g_hash_table_remove (self->flights, flight->key);
+	}
+}
+
+static gboolean
+gitlab_single_flight_cancelled_cb (GCancellable *cancellable,
+                                   gpointer      user_data)
+{
+	GitlabFlightWaiter *waiter = user_data;
+	GitlabFlight *flight = waiter->flight;
+	GitlabSingleFlight *self = flight->owner;
+	gboolean removed;
+	gboolean abandoned = FALSE;
+
+	g_mutex_lock (&self->mutex);
+	removed = g_ptr_array_remove (flight->waiters, waiter);
+	if (removed && flight->waiters->len == 0) {
+		gitlab_single_flight_detach_locked (self, flight);
+		abandoned = TRUE;
+	}
+	g_mutex_unlock (&self->mutex);
+
+	if (abandoned)
+		g_cancellable_cancel (flight->cancellable);
+
+	if (removed)
+		g_task_return_error_if_cancelled (waiter->task);
+
+	return G_SOURCE_REMOVE;
+}
+
+/*
+ * _gitlab_single_flight_join:
+ * @self: a #GitlabSingleFlight
+ * @key: identifies the request, including method and credentials
+ * @task: the task to complete once the request landed
+ *
+ * Returns: (nullable): a new flight if the caller is the leader and has
+ * to perform the request, %NULL if @task joined a flight in progress
+ */
+GitlabFlight *
+_gitlab_single_flight_join (GitlabSingleFlight *self,
+                            const gchar        *key,
+                            GTask              *task)
+{
+	GitlabFlightWaiter *waiter;
+	GitlabFlight *flight;
+	GitlabFlight *leader = NULL;
+	GCancellable *cancellable = g_task_get_cancellable (task);
+
+	g_mutex_lock (&self->mutex);
+
+	flight = g_hash_table_lookup (self->flights, key);
+	if (flight == NULL) {
+		flight = g_new0 (GitlabFlight, 1);
+		flight->ref_count = 2;
+		flight->owner = self;
+		flight->key = g_strdup (key);
+		flight->cancellable = g_cancellable_new ();
+		flight->waiters = g_ptr_array_new ();
+		g_hash_table_insert (self->flights, flight->key, flight);
+		leader = flight;
+	}
+
+	waiter = g_new0 (GitlabFlightWaiter, 1);
+	waiter->task = g_object_ref (task);
+	waiter->flight = flight;
+	g_atomic_int_inc (&flight->ref_count);
+	g_ptr_array_add (flight->waiters, waiter);
+
+	/* The source owns the waiter, so it outlives a concurrent dispatch */
+	if (cancellable != NULL) {
+		waiter->source = g_cancellable_source_new (cancellable);
+		g_source_set_callback (waiter->source,
+		                       (GSourceFunc) gitlab_single_flight_cancelled_cb,
+		                       waiter,
+		                       gitlab_flight_waiter_free);
+		g_source_attach (waiter->source, g_task_get_context (task));
+	}
+
+	g_mutex_unlock (&self->mutex);
+
+	return leader;
+}
+
+GCancellable *
+_gitlab_flight_get_cancellable (GitlabFlight *flight)
+{
+	return flight->cancellable;
+}
+
+/*
+ * _gitlab_single_flight_land:
+ * @self: a #GitlabSingleFlight
+ * @flight: (transfer full): the flight returned by _gitlab_single_flight_join()
+ *
+ * Frees the key of @flight for new requests.
+ *
+ * Returns: (transfer container): the tasks still waiting for @flight
+ */
+GPtrArray *
+_gitlab_single_flight_land (GitlabSingleFlight *self,
+                            GitlabFlight       *flight)
+{
+	GPtrArray *tasks = g_ptr_array_new_with_free_func (g_object_unref);
+	g_autoptr(GPtrArray) waiters = NULL;
+
+	g_mutex_lock (&self->mutex);
+	gitlab_single_flight_detach_locked (self, flight);
+	waiters = g_steal_pointer (&flight->waiters);
+	flight->waiters = g_ptr_array_new ();
+	g_mutex_unlock (&self->mutex);
+
+	for (guint i = 0; i < waiters->len; i++) {
+		GitlabFlightWaiter *waiter = g_ptr_array_index (waiters, i);
+
+		g_ptr_array_add (tasks, g_object_ref (waiter->task));
+
+		if (waiter->source != NULL)
+			g_source_destroy (waiter->source);
+		else
+			gitlab_flight_waiter_free (waiter);
+	}
+
+	gitlab_flight_unref (flight);
+
+	return tasks;
+}
@@ -0,0 +1,35 @@
+/* gitlab-string-pool-private.h
+ *
+ * Copyright (C) 2017 Günther Wutz <info@gunibert.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GitlabStringPool GitlabStringPool;
+
+GitlabStringPool *_gitlab_string_pool_new    (void);
+GitlabStringPool *_gitlab_string_pool_ref    (GitlabStringPool *self);
+void              _gitlab_string_pool_unref  (GitlabStringPool *self);
+const gchar      *_gitlab_string_pool_insert (GitlabStringPool *self,
+                                              const gchar      *str);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (GitlabStringPool, _gitlab_string_pool_unref)
+
+G_END_DECLS
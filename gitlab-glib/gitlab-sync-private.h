@@ -0,0 +1,42 @@
+/* gitlab-sync-private.h
+ *
+ * Copyright (C) 2017 Günther Wutz <info@gunibert.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GitlabSyncState GitlabSyncState;
+
+/* Returns the id an object is indexed by */
+typedef gint         (*GitlabSyncIdFunc)    (gpointer object);
+/* Returns the ISO 8601 time the object last changed, or %NULL */
+typedef const gchar *(*GitlabSyncStampFunc) (gpointer object);
+
+GitlabSyncState *_gitlab_sync_state_new      (GitlabSyncIdFunc     id_func,
+                                              GitlabSyncStampFunc  stamp_func);
+void             _gitlab_sync_state_free     (GitlabSyncState     *self);
+gchar           *_gitlab_sync_state_get_mark (GitlabSyncState     *self);
+void             _gitlab_sync_state_apply    (GitlabSyncState     *self,
+                                              GList               *items,
+                                              gboolean             complete,
+                                              GPtrArray          **added,
+                                              GPtrArray          **changed,
+                                              GPtrArray          **removed);
+
+G_END_DECLS
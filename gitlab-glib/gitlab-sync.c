@@ -0,0 +1,143 @@
+/* gitlab-sync.c
+ *
+ * Copyright (C) 2017 Günther Wutz <info@gunibert.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * The state of one synchronized collection: the objects seen so far,
+ * indexed by id, and the high-water mark, the newest change time among
+ * them. A delta listing only asks for objects changed at or after the mark
+ * and is diffed against the index. Deletions leave no trace in a delta, so
+ * removed objects are only found by a complete listing.
+ */
+
+#include "gitlab-sync-private.h"
+
+struct _GitlabSyncState
+{
+	GMutex               mutex;
+	GitlabSyncIdFunc     id_func;
+	GitlabSyncStampFunc  stamp_func;
+	GHashTable          *index;
+	gchar               *mark;
+};
+
+GitlabSyncState *
+_gitlab_sync_state_new (GitlabSyncIdFunc    id_func,
+                        GitlabSyncStampFunc stamp_func)
+{
+	GitlabSyncState *self = g_new0 (GitlabSyncState, 1);
+
+	g_mutex_init (&self->mutex);
+	self->id_func = id_func;
+	self->stamp_func = stamp_func;
+	self->index = g_hash_table_new_full (NULL, NULL, NULL, g_object_unref);
+
+	return self;
+}
+
+void
+_gitlab_sync_state_free (GitlabSyncState *self)
+{
+	if (self == NULL)
+		return;
+
+	g_hash_table_unref (self->index);
+	g_free (self->mark);
+	g_mutex_clear (&self->mutex);
+	g_free (self);
+}
+
+/*
+ * Returns the high-water mark, or %NULL if the collection was never
+ * listed completely.
+ */
+gchar *
+_gitlab_sync_state_get_mark (GitlabSyncState *self)
+{
+	gchar *mark;
+
+	g_mutex_lock (&self->mutex);
+	mark = g_strdup (self->mark);
+	g_mutex_unlock (&self->mutex);
+
+	return mark;
+}
+
+/*
+ * Merges a listing into the index. @complete tells whether @items is the
+ * whole collection, in which case indexed objects missing from it are
+ * reported as removed. Objects whose change time did not move, like those
+ * sitting right on the mark, are not reported at all.
+ */
+void
+_gitlab_sync_state_apply (GitlabSyncState  *self,
+                          GList            *items,
+                          gboolean          complete,
+                          GPtrArray       **added,
+                          GPtrArray       **changed,
+                          GPtrArray       **removed)
+{
+	g_autoptr(GHashTable) seen = NULL;
+
+	*added = g_ptr_array_new_with_free_func (g_object_unref);
+	*changed = g_ptr_array_new_with_free_func (g_object_unref);
+	*removed = g_ptr_array_new_with_free_func (g_object_unref);
+
+	if (complete)
+		seen = g_hash_table_new (NULL, NULL);
+
+	g_mutex_lock (&self->mutex);
+
+	for (GList *l = items; l != NULL; l = l->next) {
+		gint id = self->id_func (l->data);
+		const gchar *stamp = self->stamp_func (l->data);
+		gpointer old = g_hash_table_lookup (self->index, GINT_TO_POINTER (id));
+
+		if (seen != NULL)
+			g_hash_table_add (seen, GINT_TO_POINTER (id));
+
+		if (old == NULL)
+			g_ptr_array_add (*added, g_object_ref (l->data));
+		else if (stamp == NULL || g_strcmp0 (stamp, self->stamp_func (old)) != 0)
+			g_ptr_array_add (*changed, g_object_ref (l->data));
+		else
+			continue;
+
+		g_hash_table_replace (self->index, GINT_TO_POINTER (id), g_object_ref (l->data));
+
+		if (stamp != NULL && g_strcmp0 (stamp, self->mark) > 0) {
+			g_free (self->mark);
+			self->mark = g_strdup (stamp);
+		}
+	}
+
+	if (seen != NULL) {
+		GHashTableIter iter;
+		gpointer key;
+		gpointer value;
+
+		g_hash_table_iter_init (&iter, self->index);
+		while (g_hash_table_iter_next (&iter, &key, &value)) {
+			if (!g_hash_table_contains (seen, key)) {
+				g_ptr_array_add (*removed, g_object_ref (value));
+				g_hash_table_iter_remove (&iter);
+			}
+		}
+	}
+
+	g_mutex_unlock (&self->mutex);
+}
@@ -0,0 +1,575 @@
+/* gitlab-webhook-receiver.c
+ *
+ * Copyright (C) 2017 Günther Wutz <info@gunibert.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * An embedded HTTP server for the webhooks of a gitlab instance. Push,
+ * issue and system hook project events are applied to the projects of a
+ * #GitlabProjectStore as they arrive, so the store stays current without
+ * polling. Changed projects are replaced by updated copies, since the
+ * listed ones are shared with the response cache.
+ */
+
+#include "gitlab-webhook-receiver.h"
+#include "gitlab-issue.h"
+#include "gitlab-project.h"
+#include <json-glib/json-glib.h>
+#include <libsoup/soup.h>
+#include <string.h>
+
+struct _GitlabWebhookReceiver
+{
+	GObject parent_instance;
+
+	GitlabProjectStore *store;
+	gchar *secret_token;
+	SoupServer *server;
+};
+
+G_DEFINE_TYPE (GitlabWebhookReceiver, gitlab_webhook_receiver, G_TYPE_OBJECT)
+
+enum {
+	PROP_0,
+	PROP_STORE,
+	PROP_SECRET_TOKEN,
+	N_PROPS
+};
+
+enum {
+	PROJECT_CHANGED,
+	PROJECT_REMOVED,
+	ISSUE_CHANGED,
+	N_SIGNALS
+};
+
+static GParamSpec *properties [N_PROPS];
+static guint signals [N_SIGNALS];
+
+/**
+ * gitlab_webhook_receiver_new:
+ * @store: (nullable): the #GitlabProjectStore to keep current
+ * @secret_token: (nullable): the secret token configured for the webhook
+ *
+ * Returns: (transfer full): a new #GitlabWebhookReceiver
+ */
+GitlabWebhookReceiver *
+gitlab_webhook_receiver_new (GitlabProjectStore *store,
+                             const gchar        *secret_token)
+{
+	return g_object_new (GITLAB_TYPE_WEBHOOK_RECEIVER,
+	                     "store", store,
+	                     "secret-token", secret_token,
+	                     NULL);
+}
+
+static const gchar *
+gitlab_webhook_receiver_get_string (JsonObject  *object,
+                                    const gchar *member)
+{
+	JsonNode *node = object ? json_object_get_member (object, member) : NULL;
+
+	if (node == NULL || json_node_get_value_type (node) != G_TYPE_STRING)
+		return NULL;
+
+	return json_node_get_string (node);
+}
+
+static gint
+gitlab_webhook_receiver_get_int (JsonObject  *object,
+                                 const gchar *member)
+{
+	JsonNode *node = object ? json_object_get_member (object, member) : NULL;
+
+	if (node == NULL || !JSON_NODE_HOLDS_VALUE (node))
+		return 0;
+
+	return json_node_get_int (node);
+}
+
+static JsonObject *
+gitlab_webhook_receiver_get_object (JsonObject  *object,
+                                    const gchar *member)
+{
+	JsonNode *node = json_object_get_member (object, member);
+
+	if (node == NULL || !JSON_NODE_HOLDS_OBJECT (node))
+		return NULL;
+
+	return json_node_get_object (node);
+}
+
+/*
+ * Formats @time like the api does, which keeps last-activity-at in the
+ * order gitlab-sync.c compares it in.
+ */
+static gchar *
+gitlab_webhook_receiver_format_time (GDateTime *time)
+{
+	g_autoptr(GDateTime) utc = g_date_time_to_utc (time);
+	g_autofree gchar *seconds = g_date_time_format (utc, "%Y-%m-%dT%H:%M:%S");
+
+	return g_strdup_printf ("%s.%03dZ", seconds, g_date_time_get_microsecond (utc) / 1000);
+}
+
+/*
+ * Parses the times of event payloads, which are ISO 8601 or, in older
+ * events, of the form "2013-12-03 17:15:43 UTC".
+ */
+static GDateTime *
+gitlab_webhook_receiver_parse_time (const gchar *value)
+{
+	g_autoptr(GTimeZone) utc = g_time_zone_new_utc ();
+	g_autofree gchar *iso = NULL;
+
+	if (value == NULL)
+		return NULL;
+
+	iso = g_strdup (value);
+	if (g_str_has_suffix (iso, " UTC"))
+		strcpy (iso + strlen (iso) - 4, "Z");
+	g_strdelimit (iso, " ", 'T');
+
+	return g_date_time_new_from_iso8601 (iso, utc);
+}
+
+/*
+ * Returns the time of the latest activity @event describes: the update of
+ * an issue or project, the last commit of a push, or else the time it was
+ * received.
+ */
+static gchar *
+gitlab_webhook_receiver_get_event_time (JsonObject *event)
+{
+	g_autoptr(GDateTime) time = NULL;
+	JsonObject *attributes = gitlab_webhook_receiver_get_object (event, "object_attributes");
+	JsonNode *commits = json_object_get_member (event, "commits");
+
+	if (attributes != NULL)
+		time = gitlab_webhook_receiver_parse_time (gitlab_webhook_receiver_get_string (attributes, "updated_at"));
+
+	if (time == NULL && commits != NULL && JSON_NODE_HOLDS_ARRAY (commits)) {
+		JsonArray *array = json_node_get_array (commits);
+		guint length = json_array_get_length (array);
+		JsonNode *last = length > 0 ? json_array_get_element (array, length - 1) : NULL;
+
+		if (last != NULL && JSON_NODE_HOLDS_OBJECT (last))
+			time = gitlab_webhook_receiver_parse_time (gitlab_webhook_receiver_get_string (json_node_get_object (last), "timestamp"));
+	}
+
+	/* System hooks carry the time at the top */
+	if (time == NULL)
+		time = gitlab_webhook_receiver_parse_time (gitlab_webhook_receiver_get_string (event, "updated_at"));
+
+	if (time == NULL)
+		time = g_date_time_new_now_utc ();
+
+	return gitlab_webhook_receiver_format_time (time);
+}
+
+/*
+ * Applies the given members to the project with @id, %NULL leaves a
+ * member as it is. Listed projects are shared with the response cache, so
+ * the project in the store is never changed but replaced by an updated
+ * copy.
+ */
+static void
+gitlab_webhook_receiver_apply_project (GitlabWebhookReceiver *self,
+                                       gint                   id,
+                                       const gchar           *name,
+                                       const gchar           *description,
+                                       const gchar           *avatar,
+                                       const gchar           *http_url_to_repo,
+                                       const gchar           *last_activity_at)
+{
+	g_autoptr(GitlabProject) fresh = NULL;
+	GitlabProject *project = NULL;
+
+	if (self->store != NULL)
+		project = gitlab_project_store_lookup (self->store, id);
+
+	if (project != NULL)
+		fresh = g_object_new (GITLAB_TYPE_PROJECT,
+		                      "id", id,
+		                      "name", gitlab_project_get_name (project),
+		                      "description", gitlab_project_get_description (project),
+		                      "avatar", gitlab_project_get_avatar (project),
+		                      "http-url-to-repo", gitlab_project_get_http_url_to_repo (project),
+		                      "last-activity-at", gitlab_project_get_last_activity_at (project),
+		                      "star-count", gitlab_project_get_star_count (project),
+		                      "open-issues-count", gitlab_project_get_open_issues_count (project),
+		                      NULL);
+	else
+		fresh = g_object_new (GITLAB_TYPE_PROJECT, "id", id, NULL);
+
+	if (name != NULL)
+		g_object_set (fresh, "name", name, NULL);
+	if (description != NULL)
+		g_object_set (fresh, "description", description, NULL);
+	if (avatar != NULL)
+		g_object_set (fresh, "avatar", avatar, NULL);
+	if (http_url_to_repo != NULL)
+		g_object_set (fresh, "http-url-to-repo", http_url_to_repo, NULL);
+	/* Events may arrive late, activity never goes back */
+	if (last_activity_at != NULL &&
+	    g_strcmp0 (last_activity_at, gitlab_project_get_last_activity_at (fresh)) > 0)
+		g_object_set (fresh, "last-activity-at", last_activity_at, NULL);
+
+	if (self->store != NULL) {
+		g_autoptr(GPtrArray) projects = g_ptr_array_new ();
+
+		g_ptr_array_add (projects, fresh);
+		gitlab_project_store_update (self->store, projects, NULL);
+	}
+
+	g_signal_emit (self, signals [PROJECT_CHANGED], 0, fresh);
+}
+
+/*
+ * Push and issue events describe the project in a "project" object, which
+ * has the namespace and name separately.
+ */
+static void
+gitlab_webhook_receiver_apply_event_project (GitlabWebhookReceiver *self,
+                                             JsonObject            *event)
+{
+	JsonObject *project = gitlab_webhook_receiver_get_object (event, "project");
+	g_autofree gchar *name = NULL;
+	g_autofree gchar *time = NULL;
+	const gchar *namespace;
+	gint id;
+
+	id = gitlab_webhook_receiver_get_int (project, "id");
+	if (project == NULL || id == 0)
+		return;
+
+	namespace = gitlab_webhook_receiver_get_string (project, "namespace");
+	if (namespace != NULL)
+		name = g_strdup_printf ("%s / %s", namespace, gitlab_webhook_receiver_get_string (project, "name"));
+	else
+		name = g_strdup (gitlab_webhook_receiver_get_string (project, "name"));
+
+	time = gitlab_webhook_receiver_get_event_time (event);
+	gitlab_webhook_receiver_apply_project (self,
+	                                       id,
+	                                       name,
+	                                       gitlab_webhook_receiver_get_string (project, "description"),
+	                                       gitlab_webhook_receiver_get_string (project, "avatar_url"),
+	                                       gitlab_webhook_receiver_get_string (project, "git_http_url"),
+	                                       time);
+}
+
+static void
+gitlab_webhook_receiver_apply_issue (GitlabWebhookReceiver *self,
+                                     JsonObject            *attributes)
+{
+	g_autoptr(GitlabIssue) issue = NULL;
+
+	if (attributes == NULL)
+		return;
+
+	issue = g_object_new (GITLAB_TYPE_ISSUE,
+	                      "id", gitlab_webhook_receiver_get_int (attributes, "id"),
+	                      "iid", gitlab_webhook_receiver_get_int (attributes, "iid"),
+	                      "project-id", gitlab_webhook_receiver_get_int (attributes, "project_id"),
+	                      "title", gitlab_webhook_receiver_get_string (attributes, "title"),
+	                      "description", gitlab_webhook_receiver_get_string (attributes, "description"),
+	                      "state", gitlab_webhook_receiver_get_string (attributes, "state"),
+	                      "web-url", gitlab_webhook_receiver_get_string (attributes, "url"),
+	                      "updated-at", gitlab_webhook_receiver_get_string (attributes, "updated_at"),
+	                      NULL);
+
+	g_signal_emit (self, signals [ISSUE_CHANGED], 0, issue);
+}
+
+static void
+gitlab_webhook_receiver_remove_project (GitlabWebhookReceiver *self,
+                                        gint                   id)
+{
+	g_autoptr(GitlabProject) project = NULL;
+
+	if (self->store != NULL && gitlab_project_store_lookup (self->store, id) != NULL) {
+		g_autoptr(GPtrArray) removed = g_ptr_array_new ();
+
+		project = g_object_ref (gitlab_project_store_lookup (self->store, id));
+		g_ptr_array_add (removed, project);
+		gitlab_project_store_update (self->store, NULL, removed);
+	} else {
+		project = g_object_new (GITLAB_TYPE_PROJECT, "id", id, NULL);
+	}
+
+	g_signal_emit (self, signals [PROJECT_REMOVED], 0, project);
+}
+
+/*
+ * Applies one event. Returns %FALSE for payloads that are no event.
+ */
+static gboolean
+gitlab_webhook_receiver_apply (GitlabWebhookReceiver *self,
+                               JsonObject            *event)
+{
+	const gchar *kind = gitlab_webhook_receiver_get_string (event, "object_kind");
+	const gchar *event_name = gitlab_webhook_receiver_get_string (event, "event_name");
+
+	if (g_strcmp0 (kind, "push") == 0 || g_strcmp0 (kind, "tag_push") == 0) {
+		gitlab_webhook_receiver_apply_event_project (self, event);
+	} else if (g_strcmp0 (kind, "issue") == 0) {
+		gitlab_webhook_receiver_apply_event_project (self, event);
+		gitlab_webhook_receiver_apply_issue (self, gitlab_webhook_receiver_get_object (event, "object_attributes"));
+	} else if (g_strcmp0 (event_name, "project_destroy") == 0) {
+		gitlab_webhook_receiver_remove_project (self, gitlab_webhook_receiver_get_int (event, "project_id"));
+	} else if (event_name != NULL && g_str_has_prefix (event_name, "project_")) {
+		g_autofree gchar *time = gitlab_webhook_receiver_get_event_time (event);
+
+		/*
+		 * System hooks name the project by its path, not by the display
+		 * name of its namespace, so the name is left as it is.
+		 */
+		gitlab_webhook_receiver_apply_project (self,
+		                                       gitlab_webhook_receiver_get_int (event, "project_id"),
+		                                       NULL, NULL, NULL, NULL,
+		                                       time);
+	} else {
+		return kind != NULL || event_name != NULL;
+	}
+
+	return TRUE;
+}
+
+/*
+ * Compares digests of both tokens, which takes the same time no matter
+ * where they differ.
+ */
+static gboolean
+gitlab_webhook_receiver_token_equal (const gchar *token,
+                                     const gchar *expected)
+{
+	g_autofree gchar *token_digest = NULL;
+	g_autofree gchar *expected_digest = NULL;
+	guchar diff = 0;
+
+	if (token == NULL)
+		return FALSE;
+
+	token_digest = g_compute_checksum_for_string (G_CHECKSUM_SHA256, token, -1);
+	expected_digest = g_compute_checksum_for_string (G_CHECKSUM_SHA256, expected, -1);
+
+	for (gsize i = 0; expected_digest[i] != '\0'; i++)
+		diff |= token_digest[i] ^ expected_digest[i];
+
+	return diff == 0;
+}
+
+static void
+gitlab_webhook_receiver_server_cb (SoupServer        *server,
+                                   SoupMessage       *msg,
+                                   const char        *path,
+                                   GHashTable        *query,
+                                   SoupClientContext *client,
+                                   gpointer           user_data)
+{
+	GitlabWebhookReceiver *self = user_data;
+	g_autoptr(JsonParser) parser = NULL;
+	const gchar *token;
+	JsonNode *root;
+
+	if (msg->method != SOUP_METHOD_POST) {
+		soup_message_set_status (msg, SOUP_STATUS_METHOD_NOT_ALLOWED);
+		return;
+	}
+
+	token = soup_message_headers_get_one (msg->request_headers, "X-Gitlab-Token");
+	if (self->secret_token != NULL && !gitlab_webhook_receiver_token_equal (token, self->secret_token)) {
+		soup_message_set_status (msg, SOUP_STATUS_UNAUTHORIZED);
+		return;
+	}
+
+	parser = json_parser_new ();
+	if (!json_parser_load_from_data (parser, msg->request_body->data, msg->request_body->length, NULL) ||
+	    (root = json_parser_get_root (parser)) == NULL ||
+	    !JSON_NODE_HOLDS_OBJECT (root) ||
+	    !gitlab_webhook_receiver_apply (self, json_node_get_object (root))) {
+		soup_message_set_status (msg, SOUP_STATUS_BAD_REQUEST);
+		return;
+	}
+
+	soup_message_set_status (msg, SOUP_STATUS_OK);
+}
+
+/**
+ * gitlab_webhook_receiver_listen:
+ * @self: a #GitlabWebhookReceiver
+ * @port: the port to listen on, or 0 for any free port
+ * @local_only: whether to only accept connections from localhost
+ * @error: a #GError
+ *
+ * Starts accepting events, which are handled in the thread default main
+ * context of the caller.
+ *
+ * Returns: %TRUE if the receiver listens
+ */
+gboolean
+gitlab_webhook_receiver_listen (GitlabWebhookReceiver  *self,
+                                guint                   port,
+                                gboolean                local_only,
+                                GError                **error)
+{
+	g_assert (GITLAB_IS_WEBHOOK_RECEIVER (self));
+
+	if (local_only)
+		return soup_server_listen_local (self->server, port, 0, error);
+	else
+		return soup_server_listen_all (self->server, port, 0, error);
+}
+
+/**
+ * gitlab_webhook_receiver_get_port:
+ * @self: a #GitlabWebhookReceiver
+ *
+ * Returns: the port the receiver listens on, or 0
+ */
+guint
+gitlab_webhook_receiver_get_port (GitlabWebhookReceiver *self)
+{
+	GSList *uris;
+	guint port = 0;
+
+	g_assert (GITLAB_IS_WEBHOOK_RECEIVER (self));
+
+	uris = soup_server_get_uris (self->server);
+	if (uris != NULL)
+		port = soup_uri_get_port (uris->data);
+	g_slist_free_full (uris, (GDestroyNotify) soup_uri_free);
+
+	return port;
+}
+
+static void
+gitlab_webhook_receiver_finalize (GObject *object)
+{
+	GitlabWebhookReceiver *self = (GitlabWebhookReceiver *)object;
+
+	soup_server_disconnect (self->server);
+	g_clear_object (&self->server);
+	g_clear_object (&self->store);
+	g_free (self->secret_token);
+
+	G_OBJECT_CLASS (gitlab_webhook_receiver_parent_class)->finalize (object);
+}
+
+static void
+gitlab_webhook_receiver_get_property (GObject    *object,
+                                      guint       prop_id,
+                                      GValue     *value,
+                                      GParamSpec *pspec)
+{
+	GitlabWebhookReceiver *self = GITLAB_WEBHOOK_RECEIVER (object);
+
+	switch (prop_id)
+	  {
+		case PROP_STORE:
+			g_value_set_object (value, self->store);
+			break;
+		case PROP_SECRET_TOKEN:
+			g_value_set_string (value, self->secret_token);
+			break;
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+	  }
+}
+
+static void
+gitlab_webhook_receiver_set_property (GObject      *object,
+                                      guint         prop_id,
+                                      const GValue *value,
+                                      GParamSpec   *pspec)
+{
+	GitlabWebhookReceiver *self = GITLAB_WEBHOOK_RECEIVER (object);
+
+	switch (prop_id)
+	  {
+		case PROP_STORE:
+			self->store = g_value_dup_object (value);
+			break;
+		case PROP_SECRET_TOKEN:
+			g_free (self->secret_token);
+			self->secret_token = g_value_dup_string (value);
+			break;
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+	  }
+}
+
+static void
+gitlab_webhook_receiver_class_init (GitlabWebhookReceiverClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	object_class->finalize = gitlab_webhook_receiver_finalize;
+	object_class->get_property = gitlab_webhook_receiver_get_property;
+	object_class->set_property = gitlab_webhook_receiver_set_property;
+
+	properties[PROP_STORE] =
+		g_param_spec_object ("store", "Store", "The store the events are applied to", GITLAB_TYPE_PROJECT_STORE, G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_STRINGS);
+
+	properties[PROP_SECRET_TOKEN] =
+		g_param_spec_string ("secret-token", "Secret-token", "The token gitlab sends in X-Gitlab-Token", NULL, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+	g_object_class_install_properties (object_class, N_PROPS, properties);
+
+	/**
+	 * GitlabWebhookReceiver::project-changed:
+	 * @self: a #GitlabWebhookReceiver
+	 * @project: the new or updated #GitlabProject
+	 */
+	signals [PROJECT_CHANGED] =
+		g_signal_new ("project-changed",
+		              G_TYPE_FROM_CLASS (klass),
+		              G_SIGNAL_RUN_LAST,
+		              0, NULL, NULL, NULL,
+		              G_TYPE_NONE, 1, GITLAB_TYPE_PROJECT);
+
+	/**
+	 * GitlabWebhookReceiver::project-removed:
+	 * @self: a #GitlabWebhookReceiver
+	 * @project: the removed #GitlabProject
+	 */
+	signals [PROJECT_REMOVED] =
+		g_signal_new ("project-removed",
+		              G_TYPE_FROM_CLASS (klass),
+		              G_SIGNAL_RUN_LAST,
+		              0, NULL, NULL, NULL,
+		              G_TYPE_NONE, 1, GITLAB_TYPE_PROJECT);
+
+	/**
+	 * GitlabWebhookReceiver::issue-changed:
+	 * @self: a #GitlabWebhookReceiver
+	 * @issue: the #GitlabIssue as sent with the event
+	 */
+	signals [ISSUE_CHANGED] =
+		g_signal_new ("issue-changed",
+		              G_TYPE_FROM_CLASS (klass),
+		              G_SIGNAL_RUN_LAST,
+		              0, NULL, NULL, NULL,
+		              G_TYPE_NONE, 1, GITLAB_TYPE_ISSUE);
+}
+
+static void
+gitlab_webhook_receiver_init (GitlabWebhookReceiver *self)
+{
+	self->server = soup_server_new (NULL, NULL);
+	soup_server_add_handler (self->server, NULL, gitlab_webhook_receiver_server_cb, self, NULL);
+}
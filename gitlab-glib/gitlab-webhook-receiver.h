@@ -0,0 +1,37 @@
+/* gitlab-webhook-receiver.h
+ *
+ * Copyright (C) 2017 Günther Wutz <info@gunibert.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <gio/gio.h>
+#include "gitlab-project-store.h"
+
+G_BEGIN_DECLS
+
+#define GITLAB_TYPE_WEBHOOK_RECEIVER (gitlab_webhook_receiver_get_type())
+
+G_DECLARE_FINAL_TYPE (GitlabWebhookReceiver, gitlab_webhook_receiver, GITLAB, WEBHOOK_RECEIVER, GObject)
+
+GitlabWebhookReceiver *gitlab_webhook_receiver_new (GitlabProjectStore *store,
+                                                    const gchar        *secret_token);
+gboolean gitlab_webhook_receiver_listen (GitlabWebhookReceiver  *self,
+                                         guint                   port,
+                                         gboolean                local_only,
+                                         GError                **error);
+guint gitlab_webhook_receiver_get_port (GitlabWebhookReceiver *self);
+
+G_END_DECLS
@@ -4,6 +4,13 @@
 G_BEGIN_DECLS
 
 #include "gitlab-client.h"
+#include "gitlab-error.h"
+#include "gitlab-issue.h"
+#include "gitlab-pipeline-watcher.h"
 #include "gitlab-project.h"
+#include "gitlab-project-query.h"
+#include "gitlab-project-store.h"
+#include "gitlab-request-stats.h"
+#include "gitlab-webhook-receiver.h"
 
 G_END_DECLS
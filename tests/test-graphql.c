@@ -0,0 +1,262 @@
+/* test-graphql.c
+ *
+ * Copyright (C) 2017 Günther Wutz <info@gunibert.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Loads project summaries from a mock GraphQL endpoint on localhost.
+ */
+
+#include <gitlab.h>
+#include <json-glib/json-glib.h>
+#include <libsoup/soup.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef enum
+{
+	MOCK_ANSWER,
+	MOCK_MALFORMED,
+	MOCK_ERRORS,
+} MockMode;
+
+typedef struct
+{
+	SoupServer   *server;
+	GitlabClient *client;
+	GMainLoop    *loop;
+	MockMode      mode;
+	guint         requests;
+	gchar        *authorization;
+	GPtrArray    *projects;
+	GPtrArray    *issues;
+	GError       *error;
+} Fixture;
+
+/* Answers with every requested project that has an odd id, with one issue */
+static gchar *
+mock_answer (JsonObject *request)
+{
+	JsonObject *variables = json_object_get_object_member (request, "variables");
+	JsonArray *ids = json_object_get_array_member (variables, "ids");
+	GString *body = g_string_new ("{\"data\":{\"projects\":{\"nodes\":[");
+	gboolean first = TRUE;
+
+	for (guint i = 0; i < json_array_get_length (ids); i++) {
+		const gchar *gid = json_array_get_string_element (ids, i);
+		gint id = atoi (strrchr (gid, '/') + 1);
+
+		if (id % 2 == 0)
+			continue;
+
+		if (!first)
+			g_string_append_c (body, ',');
+		first = FALSE;
+
+		g_string_append_printf (body,
+		                        "{\"id\":\"%s\",\"nameWithNamespace\":\"group / project-%d\","
+		                        "\"description\":null,\"avatarUrl\":null,"
+		                        "\"httpUrlToRepo\":\"https://gitlab.example.com/group/project-%d.git\","
+		                        "\"lastActivityAt\":\"2020-01-01T00:00:00Z\","
+		                        "\"starCount\":%d,\"openIssuesCount\":1,"
+		                        "\"issues\":{\"nodes\":[{\"id\":\"gid://gitlab/Issue/%d\",\"iid\":\"1\","
+		                        "\"title\":\"Issue of %d\",\"description\":null,\"state\":\"opened\","
+		                        "\"webUrl\":\"https://gitlab.example.com/group/project-%d/-/issues/1\","
+		                        "\"updatedAt\":\"2020-01-01T00:00:00Z\"}]}}",
+		                        gid, id, id, id, 1000 + id, id, id);
+	}
+
+	g_string_append (body, "]}}}");
+
+	return g_string_free (body, FALSE);
+}
+
+static void
+mock_server_cb (SoupServer        *server,
+                SoupMessage       *msg,
+                const char        *path,
+                GHashTable        *query,
+                SoupClientContext *client,
+                gpointer           user_data)
+{
+	Fixture *fixture = user_data;
+	g_autoptr(JsonParser) parser = json_parser_new ();
+	gchar *body;
+
+	fixture->requests++;
+	g_free (fixture->authorization);
+	fixture->authorization = g_strdup (soup_message_headers_get_one (msg->request_headers, "Authorization"));
+
+	if (msg->method != SOUP_METHOD_POST ||
+	    !json_parser_load_from_data (parser, msg->request_body->data, msg->request_body->length, NULL)) {
+		soup_message_set_status (msg, SOUP_STATUS_BAD_REQUEST);
+		return;
+	}
+
+	switch (fixture->mode)
+	  {
+		case MOCK_ANSWER:
+			body = mock_answer (json_node_get_object (json_parser_get_root (parser)));
+			break;
+		case MOCK_MALFORMED:
+			body = g_strdup ("{\"data\":{\"projects\":");
+			break;
+		case MOCK_ERRORS:
+		default:
+			body = g_strdup ("{\"errors\":[{\"message\":\"Query has complexity of 300, which exceeds max complexity of 250\"}]}");
+			break;
+	  }
+
+	soup_message_set_status (msg, SOUP_STATUS_OK);
+	soup_message_set_response (msg, "application/json", SOUP_MEMORY_TAKE, body, strlen (body));
+}
+
+static void
+fixture_set_up (Fixture       *fixture,
+                gconstpointer  user_data)
+{
+	g_autoptr(GError) error = NULL;
+	g_autofree gchar *root = NULL;
+	g_autofree gchar *baseurl = NULL;
+	GSList *uris;
+
+	fixture->server = soup_server_new (NULL, NULL);
+	soup_server_add_handler (fixture->server, "/api/graphql", mock_server_cb, fixture, NULL);
+	soup_server_listen_local (fixture->server, 0, SOUP_SERVER_LISTEN_IPV4_ONLY, &error);
+	g_assert_no_error (error);
+
+	uris = soup_server_get_uris (fixture->server);
+	root = soup_uri_to_string (uris->data, FALSE);
+	g_slist_free_full (uris, (GDestroyNotify) soup_uri_free);
+	baseurl = g_strconcat (root, g_str_has_suffix (root, "/") ? "" : "/", "api/v4", NULL);
+
+	fixture->client = gitlab_client_new (baseurl, (gchar *) user_data);
+	fixture->loop = g_main_loop_new (NULL, FALSE);
+}
+
+static void
+fixture_tear_down (Fixture       *fixture,
+                   gconstpointer  user_data)
+{
+	g_clear_pointer (&fixture->projects, g_ptr_array_unref);
+	g_clear_pointer (&fixture->issues, g_ptr_array_unref);
+	g_clear_error (&fixture->error);
+	g_free (fixture->authorization);
+	g_main_loop_unref (fixture->loop);
+	g_object_unref (fixture->client);
+	g_object_unref (fixture->server);
+}
+
+static void
+summaries_cb (GObject      *object,
+              GAsyncResult *result,
+              gpointer      user_data)
+{
+	Fixture *fixture = user_data;
+
+	fixture->projects = gitlab_client_get_project_summaries_finish (GITLAB_CLIENT (object),
+	                                                                result,
+	                                                                &fixture->issues,
+	                                                                &fixture->error);
+	g_main_loop_quit (fixture->loop);
+}
+
+static void
+load_summaries (Fixture *fixture,
+                guint    n_ids)
+{
+	g_autofree gint *ids = g_new (gint, n_ids);
+
+	for (guint i = 0; i < n_ids; i++)
+		ids[i] = i + 1;
+
+	gitlab_client_get_project_summaries_async (fixture->client, ids, n_ids, 5,
+	                                           summaries_cb, NULL, fixture);
+	g_main_loop_run (fixture->loop);
+}
+
+static void
+test_summaries (Fixture       *fixture,
+                gconstpointer  user_data)
+{
+	GitlabProject *project;
+
+	load_summaries (fixture, 25);
+
+	g_assert_no_error (fixture->error);
+	g_assert_cmpuint (fixture->requests, ==, 2);
+	g_assert_cmpstr (fixture->authorization, ==, "Bearer secret");
+
+	/* In the order of the ids, with a hole for every project not found */
+	g_assert_cmpuint (fixture->projects->len, ==, 25);
+	g_assert_null (g_ptr_array_index (fixture->projects, 1));
+
+	project = g_ptr_array_index (fixture->projects, 20);
+	g_assert_nonnull (project);
+	g_assert_cmpint (gitlab_project_get_id (project), ==, 21);
+	g_assert_cmpstr (gitlab_project_get_name (project), ==, "group / project-21");
+	g_assert_cmpint (gitlab_project_get_star_count (project), ==, 1021);
+	g_assert_cmpint (gitlab_project_get_open_issues_count (project), ==, 1);
+
+	g_assert_cmpuint (fixture->issues->len, ==, 13);
+}
+
+static void
+test_without_token (Fixture       *fixture,
+                    gconstpointer  user_data)
+{
+	load_summaries (fixture, 3);
+
+	g_assert_no_error (fixture->error);
+	g_assert_null (fixture->authorization);
+	g_assert_cmpuint (fixture->projects->len, ==, 3);
+}
+
+static void
+test_malformed (Fixture       *fixture,
+                gconstpointer  user_data)
+{
+	fixture->mode = MOCK_MALFORMED;
+	load_summaries (fixture, 3);
+
+	g_assert_error (fixture->error, GITLAB_ERROR, GITLAB_ERROR_PARSE);
+	g_assert_null (fixture->projects);
+}
+
+static void
+test_errors (Fixture       *fixture,
+             gconstpointer  user_data)
+{
+	fixture->mode = MOCK_ERRORS;
+	load_summaries (fixture, 3);
+
+	g_assert_error (fixture->error, GITLAB_ERROR, GITLAB_ERROR_GRAPHQL);
+	g_assert_nonnull (strstr (fixture->error->message, "complexity"));
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add ("/graphql/summaries", Fixture, "secret", fixture_set_up, test_summaries, fixture_tear_down);
+	g_test_add ("/graphql/without-token", Fixture, NULL, fixture_set_up, test_without_token, fixture_tear_down);
+	g_test_add ("/graphql/malformed", Fixture, "secret", fixture_set_up, test_malformed, fixture_tear_down);
+	g_test_add ("/graphql/errors", Fixture, "secret", fixture_set_up, test_errors, fixture_tear_down);
+
+	return g_test_run ();
+}
@@ -0,0 +1,184 @@
+/* test-json-scanner.c
+ *
+ * Copyright (C) 2017 Günther Wutz <info@gunibert.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gitlab-json-scanner-private.h"
+
+#include <string.h>
+
+static void
+scanner_init (GitlabJsonScanner *scanner,
+              const gchar       *json)
+{
+	_gitlab_json_scanner_init (scanner, json, strlen (json));
+}
+
+/* Returns the unescaped contents of the single string in @json */
+static gchar *
+scan_string (const gchar *json)
+{
+	GitlabJsonScanner scanner;
+
+	scanner_init (&scanner, json);
+	g_assert_cmpint (_gitlab_json_scanner_next (&scanner), ==, GITLAB_JSON_TOKEN_STRING);
+
+	return _gitlab_json_scanner_dup_string (&scanner);
+}
+
+static void
+test_tokens (void)
+{
+	GitlabJsonScanner scanner;
+
+	scanner_init (&scanner, " {\"id\": 42, \"neg\": -1.5e3, \"ok\": true, \"no\": false, \"none\": null}\n");
+
+	g_assert_cmpint (_gitlab_json_scanner_next (&scanner), ==, GITLAB_JSON_TOKEN_BEGIN_OBJECT);
+	g_assert_cmpint (_gitlab_json_scanner_next (&scanner), ==, GITLAB_JSON_TOKEN_STRING);
+	g_assert_true (_gitlab_json_scanner_string_equal (&scanner, "id"));
+	g_assert_false (_gitlab_json_scanner_string_equal (&scanner, "i"));
+	g_assert_cmpint (_gitlab_json_scanner_next (&scanner), ==, GITLAB_JSON_TOKEN_NUMBER);
+	g_assert_cmpint (_gitlab_json_scanner_get_int (&scanner), ==, 42);
+	g_assert_cmpint (_gitlab_json_scanner_next (&scanner), ==, GITLAB_JSON_TOKEN_STRING);
+	g_assert_cmpint (_gitlab_json_scanner_next (&scanner), ==, GITLAB_JSON_TOKEN_NUMBER);
+	g_assert_cmpint (_gitlab_json_scanner_next (&scanner), ==, GITLAB_JSON_TOKEN_STRING);
+	g_assert_cmpint (_gitlab_json_scanner_next (&scanner), ==, GITLAB_JSON_TOKEN_TRUE);
+	g_assert_cmpint (_gitlab_json_scanner_next (&scanner), ==, GITLAB_JSON_TOKEN_STRING);
+	g_assert_cmpint (_gitlab_json_scanner_next (&scanner), ==, GITLAB_JSON_TOKEN_FALSE);
+	g_assert_cmpint (_gitlab_json_scanner_next (&scanner), ==, GITLAB_JSON_TOKEN_STRING);
+	g_assert_cmpint (_gitlab_json_scanner_next (&scanner), ==, GITLAB_JSON_TOKEN_NULL);
+	g_assert_cmpint (_gitlab_json_scanner_next (&scanner), ==, GITLAB_JSON_TOKEN_END_OBJECT);
+	g_assert_cmpint (_gitlab_json_scanner_next (&scanner), ==, GITLAB_JSON_TOKEN_EOF);
+}
+
+static void
+test_escapes (void)
+{
+	g_autofree gchar *plain = scan_string ("\"plain\"");
+	g_autofree gchar *simple = scan_string ("\"a\\\"b\\\\c\\/d\\b\\f\\n\\r\\t\"");
+	g_autofree gchar *unicode = scan_string ("\"caf\\u00e9 \\u20AC\"");
+
+	g_assert_cmpstr (plain, ==, "plain");
+	g_assert_cmpstr (simple, ==, "a\"b\\c/d\b\f\n\r\t");
+	g_assert_cmpstr (unicode, ==, "café €");
+}
+
+static void
+test_surrogates (void)
+{
+	g_autofree gchar *pair = scan_string ("\"\\ud83d\\ude00!\"");
+	g_autofree gchar *lone_high = scan_string ("\"\\ud83dx\"");
+	g_autofree gchar *lone_low = scan_string ("\"\\ude00\"");
+	g_autofree gchar *high_at_end = scan_string ("\"\\ud83d\"");
+	g_autofree gchar *swapped = scan_string ("\"\\ude00\\ud83d\"");
+
+	g_assert_cmpstr (pair, ==, "\xF0\x9F\x98\x80!");
+	g_assert_cmpstr (lone_high, ==, "\xEF\xBF\xBDx");
+	g_assert_cmpstr (lone_low, ==, "\xEF\xBF\xBD");
+	g_assert_cmpstr (high_at_end, ==, "\xEF\xBF\xBD");
+	g_assert_cmpstr (swapped, ==, "\xEF\xBF\xBD\xEF\xBF\xBD");
+}
+
+static void
+test_nul (void)
+{
+	g_autofree gchar *nul = scan_string ("\"a\\u0000b\"");
+
+	/* NUL would truncate the string, it is replaced */
+	g_assert_cmpstr (nul, ==, "a\xEF\xBF\xBD" "b");
+}
+
+static void
+test_bad_escapes (void)
+{
+	g_autofree gchar *short_hex = scan_string ("\"\\u12\"");
+	g_autofree gchar *bad_hex = scan_string ("\"\\uzzzz\"");
+
+	g_assert_true (g_utf8_validate (short_hex, -1, NULL));
+	g_assert_true (g_str_has_prefix (short_hex, "\xEF\xBF\xBD"));
+	g_assert_true (g_utf8_validate (bad_hex, -1, NULL));
+	g_assert_true (g_str_has_prefix (bad_hex, "\xEF\xBF\xBD"));
+}
+
+static void
+test_nesting (void)
+{
+	GitlabJsonScanner scanner;
+	GitlabJsonToken token;
+
+	scanner_init (&scanner, "{\"skip\": {\"a\": [1, [2, {\"b\": \"]}\"}], {}]}, \"id\": 7}");
+
+	g_assert_cmpint (_gitlab_json_scanner_next (&scanner), ==, GITLAB_JSON_TOKEN_BEGIN_OBJECT);
+	g_assert_cmpint (_gitlab_json_scanner_next (&scanner), ==, GITLAB_JSON_TOKEN_STRING);
+	token = _gitlab_json_scanner_next (&scanner);
+	g_assert_true (_gitlab_json_scanner_skip_value (&scanner, token));
+
+	g_assert_cmpint (_gitlab_json_scanner_next (&scanner), ==, GITLAB_JSON_TOKEN_STRING);
+	g_assert_true (_gitlab_json_scanner_string_equal (&scanner, "id"));
+	g_assert_cmpint (_gitlab_json_scanner_next (&scanner), ==, GITLAB_JSON_TOKEN_NUMBER);
+	g_assert_cmpint (_gitlab_json_scanner_get_int (&scanner), ==, 7);
+	g_assert_cmpint (_gitlab_json_scanner_next (&scanner), ==, GITLAB_JSON_TOKEN_END_OBJECT);
+	g_assert_cmpint (_gitlab_json_scanner_next (&scanner), ==, GITLAB_JSON_TOKEN_EOF);
+}
+
+static void
+test_malformed (void)
+{
+	GitlabJsonScanner scanner;
+	GitlabJsonToken token;
+
+	scanner_init (&scanner, "\"unterminated");
+	g_assert_cmpint (_gitlab_json_scanner_next (&scanner), ==, GITLAB_JSON_TOKEN_ERROR);
+	g_assert_nonnull (scanner.error_message);
+
+	scanner_init (&scanner, "\"escape at the end\\");
+	g_assert_cmpint (_gitlab_json_scanner_next (&scanner), ==, GITLAB_JSON_TOKEN_ERROR);
+
+	scanner_init (&scanner, "tru");
+	g_assert_cmpint (_gitlab_json_scanner_next (&scanner), ==, GITLAB_JSON_TOKEN_ERROR);
+
+	scanner_init (&scanner, "@");
+	g_assert_cmpint (_gitlab_json_scanner_next (&scanner), ==, GITLAB_JSON_TOKEN_ERROR);
+
+	scanner_init (&scanner, "[1, [2, 3]");
+	token = _gitlab_json_scanner_next (&scanner);
+	g_assert_false (_gitlab_json_scanner_skip_value (&scanner, token));
+	g_assert_cmpstr (scanner.error_message, ==, "Unexpected end of document");
+
+	scanner_init (&scanner, "]");
+	token = _gitlab_json_scanner_next (&scanner);
+	g_assert_false (_gitlab_json_scanner_skip_value (&scanner, token));
+
+	scanner_init (&scanner, "");
+	g_assert_cmpint (_gitlab_json_scanner_next (&scanner), ==, GITLAB_JSON_TOKEN_EOF);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/json-scanner/tokens", test_tokens);
+	g_test_add_func ("/json-scanner/escapes", test_escapes);
+	g_test_add_func ("/json-scanner/surrogates", test_surrogates);
+	g_test_add_func ("/json-scanner/nul", test_nul);
+	g_test_add_func ("/json-scanner/bad-escapes", test_bad_escapes);
+	g_test_add_func ("/json-scanner/nesting", test_nesting);
+	g_test_add_func ("/json-scanner/malformed", test_malformed);
+
+	return g_test_run ();
+}
@@ -0,0 +1,759 @@
+/* test-listing.c
+ *
+ * Copyright (C) 2017 Günther Wutz <info@gunibert.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Lists and syncs projects from a mock REST endpoint on localhost. The
+ * group listing has numbered pages, the listing of all projects keyset
+ * pages.
+ */
+
+#include <gitlab.h>
+#include <libsoup/soup.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MOCK_STAMP         "2020-01-01T00:00:00.000Z"
+#define MOCK_TOUCHED_STAMP "2020-02-01T00:00:00.000Z"
+
+typedef struct
+{
+	SoupServer   *server;
+	GitlabClient *client;
+	GMainLoop    *loop;
+	gchar        *baseurl;
+
+	/* The projects on the server are first_id to last_id */
+	guint         first_id;
+	guint         last_id;
+	/* A project with newer activity than the others, or 0 */
+	guint         touched;
+	/* A numbered page answered with 500, or 0 */
+	guint         fail_page;
+	/* The number of requests still answered with 429 */
+	guint         rate_limited;
+	gboolean      etags;
+	gboolean      slow;
+	gboolean      gzip;
+
+	guint         requests;
+	guint         not_modified;
+	guint         in_flight;
+	guint         max_in_flight;
+	gchar        *last_activity_after;
+	gchar        *accept_encoding;
+
+	guint         pending;
+	GPtrArray    *pages;
+	GError       *error;
+} Fixture;
+
+typedef struct
+{
+	Fixture  *fixture;
+	GList    *projects;
+	GError   *error;
+} Call;
+
+typedef struct
+{
+	SoupServer  *server;
+	SoupMessage *msg;
+} Delay;
+
+static gboolean
+mock_unpause_cb (gpointer user_data)
+{
+	Delay *delay = user_data;
+
+	soup_server_unpause_message (delay->server, delay->msg);
+	g_object_unref (delay->msg);
+	g_free (delay);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+mock_finished_cb (SoupMessage *msg,
+                  gpointer     user_data)
+{
+	Fixture *fixture = user_data;
+
+	fixture->in_flight--;
+}
+
+static guint
+mock_query_uint (GHashTable  *query,
+                 const gchar *name,
+                 guint        fallback)
+{
+	const gchar *value = query != NULL ? g_hash_table_lookup (query, name) : NULL;
+
+	return value != NULL ? (guint) atoi (value) : fallback;
+}
+
+static const gchar *
+mock_stamp (Fixture *fixture,
+            guint    id)
+{
+	return id == fixture->touched ? MOCK_TOUCHED_STAMP : MOCK_STAMP;
+}
+
+/* The ids of the projects matching @query, in ascending order */
+static GArray *
+mock_select (Fixture    *fixture,
+             GHashTable *query)
+{
+	const gchar *after = query != NULL ? g_hash_table_lookup (query, "last_activity_after") : NULL;
+	GArray *ids = g_array_new (FALSE, FALSE, sizeof (guint));
+
+	for (guint id = fixture->first_id; id <= fixture->last_id; id++) {
+		if (after != NULL && strcmp (mock_stamp (fixture, id), after) < 0)
+			continue;
+		g_array_append_val (ids, id);
+	}
+
+	return ids;
+}
+
+static gchar *
+mock_page (Fixture *fixture,
+           GArray  *ids,
+           guint    start,
+           guint    end)
+{
+	GString *body = g_string_new ("[");
+
+	for (guint i = start; i < end; i++) {
+		guint id = g_array_index (ids, guint, i);
+
+		if (i > start)
+			g_string_append_c (body, ',');
+
+		g_string_append_printf (body,
+		                        "{\"id\":%u,\"name\":\"project-%u\","
+		                        "\"name_with_namespace\":\"test / project-%u\","
+		                        "\"description\":\"A mock project\",\"avatar_url\":null,"
+		                        "\"http_url_to_repo\":\"https://gitlab.example.com/test/project-%u.git\","
+		                        "\"last_activity_at\":\"%s\",\"star_count\":0}",
+		                        id, id, id, id, mock_stamp (fixture, id));
+	}
+
+	g_string_append_c (body, ']');
+
+	return g_string_free (body, FALSE);
+}
+
+/* Returns @body compressed with gzip */
+static gchar *
+mock_compress (const gchar *body,
+               gsize       *length)
+{
+	g_autoptr(GZlibCompressor) compressor = g_zlib_compressor_new (G_ZLIB_COMPRESSOR_FORMAT_GZIP, -1);
+	g_autoptr(GOutputStream) memory = g_memory_output_stream_new_resizable ();
+	g_autoptr(GOutputStream) stream = NULL;
+	g_autoptr(GError) error = NULL;
+
+	stream = g_converter_output_stream_new (memory, G_CONVERTER (compressor));
+	g_output_stream_write_all (stream, body, strlen (body), NULL, NULL, &error);
+	g_assert_no_error (error);
+	g_output_stream_close (stream, NULL, &error);
+	g_assert_no_error (error);
+
+	*length = g_memory_output_stream_get_data_size (G_MEMORY_OUTPUT_STREAM (memory));
+
+	return g_memory_output_stream_steal_data (G_MEMORY_OUTPUT_STREAM (memory));
+}
+
+static void
+mock_server_cb (SoupServer        *server,
+                SoupMessage       *msg,
+                const char        *path,
+                GHashTable        *query,
+                SoupClientContext *client,
+                gpointer           user_data)
+{
+	Fixture *fixture = user_data;
+	g_autoptr(GArray) ids = NULL;
+	g_autofree gchar *etag = NULL;
+	guint per_page = mock_query_uint (query, "per_page", 20);
+	guint start;
+	guint end;
+	gchar *body;
+	gsize length;
+
+	fixture->requests++;
+	fixture->in_flight++;
+	fixture->max_in_flight = MAX (fixture->max_in_flight, fixture->in_flight);
+	g_signal_connect (msg, "finished", G_CALLBACK (mock_finished_cb), fixture);
+
+	g_free (fixture->accept_encoding);
+	fixture->accept_encoding = g_strdup (soup_message_headers_get_list (msg->request_headers, "Accept-Encoding"));
+
+	if (fixture->rate_limited > 0) {
+		fixture->rate_limited--;
+		soup_message_set_status_full (msg, 429, "Too Many Requests");
+		soup_message_headers_replace (msg->response_headers, "Retry-After", "0");
+		return;
+	}
+
+	g_free (fixture->last_activity_after);
+	fixture->last_activity_after = g_strdup (query != NULL ? g_hash_table_lookup (query, "last_activity_after") : NULL);
+
+	ids = mock_select (fixture, query);
+
+	if (g_strcmp0 (path, "/api/v4/projects") == 0) {
+		guint id_after = mock_query_uint (query, "id_after", 0);
+
+		for (start = 0; start < ids->len && g_array_index (ids, guint, start) <= id_after; start++)
+			;
+		end = MIN (start + per_page, ids->len);
+
+		if (end < ids->len) {
+			g_autofree gchar *link = NULL;
+
+			link = g_strdup_printf ("<%s/projects?pagination=keyset&order_by=id&sort=asc&per_page=%u&id_after=%u>; rel=\"next\"",
+			                        fixture->baseurl, per_page, g_array_index (ids, guint, end - 1));
+			soup_message_headers_replace (msg->response_headers, "Link", link);
+		}
+	} else if (g_strcmp0 (path, "/api/v4/groups/test/projects") == 0) {
+		guint page = mock_query_uint (query, "page", 1);
+		guint total_pages = MAX (1, (ids->len + per_page - 1) / per_page);
+		g_autofree gchar *total = g_strdup_printf ("%u", total_pages);
+		g_autofree gchar *next = page < total_pages ? g_strdup_printf ("%u", page + 1) : g_strdup ("");
+
+		if (page == fixture->fail_page) {
+			soup_message_set_status (msg, SOUP_STATUS_INTERNAL_SERVER_ERROR);
+			return;
+		}
+
+		start = MIN ((page - 1) * per_page, ids->len);
+		end = MIN (start + per_page, ids->len);
+
+		soup_message_headers_replace (msg->response_headers, "X-Total-Pages", total);
+		soup_message_headers_replace (msg->response_headers, "X-Next-Page", next);
+
+		if (fixture->etags) {
+			etag = g_strdup_printf ("\"page-%u\"", page);
+			soup_message_headers_replace (msg->response_headers, "ETag", etag);
+		}
+	} else {
+		soup_message_set_status (msg, SOUP_STATUS_NOT_FOUND);
+		return;
+	}
+
+	if (etag != NULL &&
+	    g_strcmp0 (soup_message_headers_get_one (msg->request_headers, "If-None-Match"), etag) == 0) {
+		fixture->not_modified++;
+		soup_message_set_status (msg, SOUP_STATUS_NOT_MODIFIED);
+		return;
+	}
+
+	body = mock_page (fixture, ids, start, end);
+	length = strlen (body);
+
+	if (fixture->gzip) {
+		gchar *plain = body;
+
+		body = mock_compress (plain, &length);
+		g_free (plain);
+		soup_message_headers_replace (msg->response_headers, "Content-Encoding", "gzip");
+	}
+
+	soup_message_set_status (msg, SOUP_STATUS_OK);
+	soup_message_set_response (msg, "application/json", SOUP_MEMORY_TAKE, body, length);
+
+	/* Keeps the request open for a while, so that concurrent ones overlap */
+	if (fixture->slow) {
+		Delay *delay = g_new0 (Delay, 1);
+
+		delay->server = server;
+		delay->msg = g_object_ref (msg);
+		soup_server_pause_message (server, msg);
+		g_timeout_add (50, mock_unpause_cb, delay);
+	}
+}
+
+static void
+fixture_set_up (Fixture       *fixture,
+                gconstpointer  user_data)
+{
+	g_autoptr(GError) error = NULL;
+	g_autofree gchar *root = NULL;
+	GSList *uris;
+
+	fixture->server = soup_server_new (NULL, NULL);
+	soup_server_add_handler (fixture->server, "/api/v4", mock_server_cb, fixture, NULL);
+	soup_server_listen_local (fixture->server, 0, SOUP_SERVER_LISTEN_IPV4_ONLY, &error);
+	g_assert_no_error (error);
+
+	uris = soup_server_get_uris (fixture->server);
+	root = soup_uri_to_string (uris->data, FALSE);
+	g_slist_free_full (uris, (GDestroyNotify) soup_uri_free);
+	fixture->baseurl = g_strconcat (root, g_str_has_suffix (root, "/") ? "" : "/", "api/v4", NULL);
+
+	fixture->client = gitlab_client_new (fixture->baseurl, (gchar *) user_data);
+	fixture->loop = g_main_loop_new (NULL, FALSE);
+	fixture->pages = g_ptr_array_new_with_free_func ((GDestroyNotify) g_ptr_array_unref);
+	fixture->first_id = 1;
+	fixture->last_id = 10;
+}
+
+static void
+fixture_tear_down (Fixture       *fixture,
+                   gconstpointer  user_data)
+{
+	g_ptr_array_unref (fixture->pages);
+	g_clear_error (&fixture->error);
+	g_free (fixture->last_activity_after);
+	g_free (fixture->accept_encoding);
+	g_free (fixture->baseurl);
+	g_main_loop_unref (fixture->loop);
+	g_object_unref (fixture->client);
+	g_object_unref (fixture->server);
+}
+
+static void
+call_clear (Call *call)
+{
+	g_list_free_full (call->projects, g_object_unref);
+	g_clear_error (&call->error);
+}
+
+static void
+fixture_run (Fixture *fixture)
+{
+	if (fixture->pending > 0)
+		g_main_loop_run (fixture->loop);
+}
+
+static void
+fixture_done (Fixture *fixture)
+{
+	if (--fixture->pending == 0)
+		g_main_loop_quit (fixture->loop);
+}
+
+static GitlabProjectQuery *
+new_query (gboolean keyset)
+{
+	GitlabProjectQuery *query = gitlab_project_query_new ();
+
+	if (!keyset)
+		gitlab_project_query_set_group (query, "test");
+	gitlab_project_query_set_per_page (query, 2);
+
+	return query;
+}
+
+static void
+query_cb (GObject      *object,
+          GAsyncResult *result,
+          gpointer      user_data)
+{
+	Call *call = user_data;
+
+	call->projects = gitlab_client_query_projects_finish (GITLAB_CLIENT (object), result, &call->error);
+	fixture_done (call->fixture);
+}
+
+static void
+start_query (Fixture      *fixture,
+             Call         *call,
+             gboolean      keyset,
+             GCancellable *cancellable)
+{
+	g_autoptr(GitlabProjectQuery) query = new_query (keyset);
+
+	call->fixture = fixture;
+	fixture->pending++;
+	gitlab_client_query_projects_async (fixture->client, query, query_cb, cancellable, call);
+}
+
+/* Checks that @projects are @first_id to @last_id in order */
+static void
+assert_projects (GList *projects,
+                 guint  first_id,
+                 guint  last_id)
+{
+	guint id = first_id;
+
+	for (GList *l = projects; l != NULL; l = l->next)
+		g_assert_cmpint (gitlab_project_get_id (l->data), ==, id++);
+	g_assert_cmpuint (id, ==, last_id + 1);
+}
+
+static void
+test_numbered_pages (Fixture       *fixture,
+                     gconstpointer  user_data)
+{
+	Call call = { 0 };
+
+	fixture->slow = TRUE;
+	g_object_set (fixture->client, "max-pages-in-flight", 2, NULL);
+
+	start_query (fixture, &call, FALSE, NULL);
+	fixture_run (fixture);
+
+	g_assert_no_error (call.error);
+	assert_projects (call.projects, 1, 10);
+	g_assert_cmpuint (fixture->requests, ==, 5);
+
+	/* The first page comes alone, the others two at a time */
+	g_assert_cmpuint (fixture->max_in_flight, ==, 2);
+
+	call_clear (&call);
+}
+
+static void
+test_keyset_pages (Fixture       *fixture,
+                   gconstpointer  user_data)
+{
+	Call call = { 0 };
+
+	fixture->slow = TRUE;
+	fixture->last_id = 5;
+
+	start_query (fixture, &call, TRUE, NULL);
+	fixture_run (fixture);
+
+	g_assert_no_error (call.error);
+	assert_projects (call.projects, 1, 5);
+	g_assert_cmpuint (fixture->requests, ==, 3);
+
+	/* Every keyset page needs the link of the previous one */
+	g_assert_cmpuint (fixture->max_in_flight, ==, 1);
+
+	call_clear (&call);
+}
+
+static void
+stream_page_cb (GitlabClient *client,
+                GPtrArray    *projects,
+                gpointer      user_data)
+{
+	Fixture *fixture = user_data;
+
+	g_ptr_array_add (fixture->pages, g_ptr_array_ref (projects));
+}
+
+static void
+stream_cb (GObject      *object,
+           GAsyncResult *result,
+           gpointer      user_data)
+{
+	Fixture *fixture = user_data;
+
+	gitlab_client_stream_projects_finish (GITLAB_CLIENT (object), result, &fixture->error);
+	fixture_done (fixture);
+}
+
+static void
+test_stream_error (Fixture       *fixture,
+                   gconstpointer  user_data)
+{
+	g_autoptr(GitlabProjectQuery) query = new_query (FALSE);
+
+	fixture->fail_page = 2;
+
+	fixture->pending++;
+	gitlab_client_stream_projects_async (fixture->client, query, stream_page_cb, fixture,
+	                                     stream_cb, NULL, fixture);
+	fixture_run (fixture);
+
+	g_assert_error (fixture->error, GITLAB_ERROR, GITLAB_ERROR_HTTP);
+
+	/* Pages behind the failed one are never handed out, even if they arrived */
+	g_assert_cmpuint (fixture->pages->len, ==, 1);
+	g_assert_cmpuint (((GPtrArray *) g_ptr_array_index (fixture->pages, 0))->len, ==, 2);
+}
+
+static void
+test_rate_limit (Fixture       *fixture,
+                 gconstpointer  user_data)
+{
+	Call call = { 0 };
+
+	fixture->last_id = 2;
+	fixture->rate_limited = 2;
+
+	start_query (fixture, &call, FALSE, NULL);
+	fixture_run (fixture);
+
+	g_assert_no_error (call.error);
+	assert_projects (call.projects, 1, 2);
+	g_assert_cmpuint (fixture->requests, ==, 3);
+
+	call_clear (&call);
+}
+
+static void
+test_rate_limit_give_up (Fixture       *fixture,
+                         gconstpointer  user_data)
+{
+	Call call = { 0 };
+
+	fixture->last_id = 2;
+	fixture->rate_limited = G_MAXUINT;
+
+	start_query (fixture, &call, FALSE, NULL);
+	fixture_run (fixture);
+
+	g_assert_error (call.error, GITLAB_ERROR, GITLAB_ERROR_RATE_LIMITED);
+	g_assert_null (call.projects);
+	g_assert_cmpuint (fixture->requests, ==, 5);
+
+	call_clear (&call);
+}
+
+static void
+test_revalidate (Fixture       *fixture,
+                 gconstpointer  user_data)
+{
+	Call first = { 0 };
+	Call second = { 0 };
+
+	fixture->etags = TRUE;
+	fixture->last_id = 4;
+
+	start_query (fixture, &first, FALSE, NULL);
+	fixture_run (fixture);
+	start_query (fixture, &second, FALSE, NULL);
+	fixture_run (fixture);
+
+	g_assert_no_error (first.error);
+	g_assert_no_error (second.error);
+	assert_projects (second.projects, 1, 4);
+
+	g_assert_cmpuint (fixture->requests, ==, 4);
+	g_assert_cmpuint (fixture->not_modified, ==, 2);
+	g_assert_cmpuint (gitlab_client_get_cache_misses (fixture->client), ==, 2);
+	g_assert_cmpuint (gitlab_client_get_cache_hits (fixture->client), ==, 2);
+
+	/* A 304 is answered with the projects parsed the first time */
+	g_assert_true (first.projects->data == second.projects->data);
+
+	/* Without the cached pages the listing is downloaded again */
+	gitlab_client_clear_cache (fixture->client);
+	call_clear (&second);
+	second = (Call) { 0 };
+	start_query (fixture, &second, FALSE, NULL);
+	fixture_run (fixture);
+
+	g_assert_no_error (second.error);
+	g_assert_cmpuint (fixture->not_modified, ==, 2);
+	g_assert_true (first.projects->data != second.projects->data);
+
+	call_clear (&first);
+	call_clear (&second);
+}
+
+static void
+test_gzip (Fixture       *fixture,
+           gconstpointer  user_data)
+{
+	Call call = { 0 };
+
+	fixture->gzip = TRUE;
+
+	start_query (fixture, &call, FALSE, NULL);
+	fixture_run (fixture);
+
+	/* The session asks for compressed bodies and inflates them for the pager */
+	g_assert_nonnull (fixture->accept_encoding);
+	g_assert_nonnull (strstr (fixture->accept_encoding, "gzip"));
+	g_assert_no_error (call.error);
+	assert_projects (call.projects, 1, 10);
+
+	call_clear (&call);
+}
+
+static void
+test_shared (Fixture       *fixture,
+             gconstpointer  user_data)
+{
+	Call first = { 0 };
+	Call second = { 0 };
+
+	fixture->last_id = 4;
+
+	start_query (fixture, &first, FALSE, NULL);
+	start_query (fixture, &second, FALSE, NULL);
+	fixture_run (fixture);
+
+	g_assert_no_error (first.error);
+	g_assert_no_error (second.error);
+	assert_projects (first.projects, 1, 4);
+	assert_projects (second.projects, 1, 4);
+	g_assert_cmpuint (fixture->requests, ==, 2);
+
+	call_clear (&first);
+	call_clear (&second);
+}
+
+static void
+test_cancel_waiter (Fixture       *fixture,
+                    gconstpointer  user_data)
+{
+	g_autoptr(GCancellable) cancellable = g_cancellable_new ();
+	Call cancelled = { 0 };
+	Call remaining = { 0 };
+
+	fixture->last_id = 4;
+
+	start_query (fixture, &cancelled, FALSE, cancellable);
+	start_query (fixture, &remaining, FALSE, NULL);
+	g_cancellable_cancel (cancellable);
+	fixture_run (fixture);
+
+	g_assert_error (cancelled.error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+	g_assert_no_error (remaining.error);
+	assert_projects (remaining.projects, 1, 4);
+	g_assert_cmpuint (fixture->requests, ==, 2);
+
+	call_clear (&cancelled);
+	call_clear (&remaining);
+}
+
+static void
+test_cancel_last_waiter (Fixture       *fixture,
+                         gconstpointer  user_data)
+{
+	g_autoptr(GCancellable) cancellable = g_cancellable_new ();
+	Call cancelled = { 0 };
+	Call next = { 0 };
+
+	fixture->last_id = 4;
+
+	start_query (fixture, &cancelled, FALSE, cancellable);
+	g_cancellable_cancel (cancellable);
+	fixture_run (fixture);
+
+	g_assert_error (cancelled.error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+
+	/* The abandoned listing was cancelled and does not capture the next call */
+	start_query (fixture, &next, FALSE, NULL);
+	fixture_run (fixture);
+
+	g_assert_no_error (next.error);
+	assert_projects (next.projects, 1, 4);
+
+	call_clear (&cancelled);
+	call_clear (&next);
+}
+
+typedef struct
+{
+	Fixture   *fixture;
+	GPtrArray *added;
+	GPtrArray *changed;
+	GPtrArray *removed;
+	GError    *error;
+} Sync;
+
+static void
+sync_cb (GObject      *object,
+         GAsyncResult *result,
+         gpointer      user_data)
+{
+	Sync *sync = user_data;
+
+	gitlab_client_sync_projects_finish (GITLAB_CLIENT (object), result,
+	                                    &sync->added, &sync->changed, &sync->removed,
+	                                    &sync->error);
+	fixture_done (sync->fixture);
+}
+
+static void
+run_sync (Fixture         *fixture,
+          GitlabSyncFlags  flags,
+          Sync            *sync)
+{
+	g_autoptr(GitlabProjectQuery) query = new_query (FALSE);
+
+	g_clear_pointer (&sync->added, g_ptr_array_unref);
+	g_clear_pointer (&sync->changed, g_ptr_array_unref);
+	g_clear_pointer (&sync->removed, g_ptr_array_unref);
+	sync->fixture = fixture;
+
+	fixture->pending++;
+	gitlab_client_sync_projects_async (fixture->client, query, flags, sync_cb, NULL, sync);
+	fixture_run (fixture);
+
+	g_assert_no_error (sync->error);
+}
+
+static void
+test_sync (Fixture       *fixture,
+           gconstpointer  user_data)
+{
+	Sync sync = { 0 };
+
+	fixture->last_id = 5;
+
+	/* The first sync lists everything */
+	run_sync (fixture, GITLAB_SYNC_NONE, &sync);
+	g_assert_null (fixture->last_activity_after);
+	g_assert_cmpuint (sync.added->len, ==, 5);
+	g_assert_cmpuint (sync.changed->len, ==, 0);
+	g_assert_cmpuint (sync.removed->len, ==, 0);
+
+	/* Later ones only ask for what changed since the newest activity */
+	fixture->touched = 3;
+	fixture->last_id = 6;
+	run_sync (fixture, GITLAB_SYNC_NONE, &sync);
+	g_assert_cmpstr (fixture->last_activity_after, ==, MOCK_STAMP);
+	g_assert_cmpuint (sync.added->len, ==, 1);
+	g_assert_cmpint (gitlab_project_get_id (g_ptr_array_index (sync.added, 0)), ==, 6);
+	g_assert_cmpuint (sync.changed->len, ==, 1);
+	g_assert_cmpint (gitlab_project_get_id (g_ptr_array_index (sync.changed, 0)), ==, 3);
+	g_assert_cmpuint (sync.removed->len, ==, 0);
+
+	/* Deletions only show in a complete listing */
+	fixture->first_id = 2;
+	run_sync (fixture, GITLAB_SYNC_FULL, &sync);
+	g_assert_null (fixture->last_activity_after);
+	g_assert_cmpuint (sync.added->len, ==, 0);
+	g_assert_cmpuint (sync.changed->len, ==, 0);
+	g_assert_cmpuint (sync.removed->len, ==, 1);
+	g_assert_cmpint (gitlab_project_get_id (g_ptr_array_index (sync.removed, 0)), ==, 1);
+
+	g_clear_pointer (&sync.added, g_ptr_array_unref);
+	g_clear_pointer (&sync.changed, g_ptr_array_unref);
+	g_clear_pointer (&sync.removed, g_ptr_array_unref);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add ("/listing/numbered-pages", Fixture, "secret", fixture_set_up, test_numbered_pages, fixture_tear_down);
+	g_test_add ("/listing/keyset-pages", Fixture, "secret", fixture_set_up, test_keyset_pages, fixture_tear_down);
+	g_test_add ("/listing/stream-error", Fixture, "secret", fixture_set_up, test_stream_error, fixture_tear_down);
+	g_test_add ("/listing/rate-limit", Fixture, "secret", fixture_set_up, test_rate_limit, fixture_tear_down);
+	g_test_add ("/listing/rate-limit-give-up", Fixture, "secret", fixture_set_up, test_rate_limit_give_up, fixture_tear_down);
+	g_test_add ("/listing/revalidate", Fixture, "secret", fixture_set_up, test_revalidate, fixture_tear_down);
+	g_test_add ("/listing/gzip", Fixture, "secret", fixture_set_up, test_gzip, fixture_tear_down);
+	g_test_add ("/listing/shared", Fixture, "secret", fixture_set_up, test_shared, fixture_tear_down);
+	g_test_add ("/listing/cancel-waiter", Fixture, "secret", fixture_set_up, test_cancel_waiter, fixture_tear_down);
+	g_test_add ("/listing/cancel-last-waiter", Fixture, "secret", fixture_set_up, test_cancel_last_waiter, fixture_tear_down);
+	g_test_add ("/sync/projects", Fixture, "secret", fixture_set_up, test_sync, fixture_tear_down);
+
+	return g_test_run ();
+}
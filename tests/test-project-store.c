@@ -0,0 +1,228 @@
+/* test-project-store.c
+ *
+ * Copyright (C) 2017 Günther Wutz <info@gunibert.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Applies batches to a project store and replays every items-changed
+ * signal on a mirror, which has to end up equal to the store.
+ */
+
+#include <gitlab.h>
+
+typedef struct
+{
+	GitlabProjectStore *store;
+	GPtrArray          *mirror;
+	guint               changes;
+	guint               position;
+	guint               removed;
+	guint               added;
+} Fixture;
+
+static void
+items_changed_cb (GListModel *model,
+                  guint       position,
+                  guint       removed,
+                  guint       added,
+                  gpointer    user_data)
+{
+	Fixture *fixture = user_data;
+
+	fixture->changes++;
+	fixture->position = position;
+	fixture->removed = removed;
+	fixture->added = added;
+
+	g_ptr_array_remove_range (fixture->mirror, position, removed);
+	for (guint i = 0; i < added; i++)
+		g_ptr_array_insert (fixture->mirror, position + i, g_list_model_get_item (model, position + i));
+}
+
+static void
+fixture_set_up (Fixture       *fixture,
+                gconstpointer  user_data)
+{
+	fixture->store = gitlab_project_store_new ();
+	fixture->mirror = g_ptr_array_new_with_free_func (g_object_unref);
+	g_signal_connect (fixture->store, "items-changed", G_CALLBACK (items_changed_cb), fixture);
+}
+
+static void
+fixture_tear_down (Fixture       *fixture,
+                   gconstpointer  user_data)
+{
+	g_ptr_array_unref (fixture->mirror);
+	g_object_unref (fixture->store);
+}
+
+static GitlabProject *
+new_project (gint         id,
+             const gchar *name)
+{
+	return g_object_new (GITLAB_TYPE_PROJECT, "id", id, "name", name, NULL);
+}
+
+/* Applies one batch and checks the single change it reported */
+static void
+update (Fixture   *fixture,
+        GPtrArray *projects,
+        GPtrArray *removed,
+        guint      position,
+        guint      n_removed,
+        guint      n_added)
+{
+	guint changes = fixture->changes;
+	guint n_items;
+
+	gitlab_project_store_update (fixture->store, projects, removed);
+
+	g_assert_cmpuint (fixture->changes, ==, changes + 1);
+	g_assert_cmpuint (fixture->position, ==, position);
+	g_assert_cmpuint (fixture->removed, ==, n_removed);
+	g_assert_cmpuint (fixture->added, ==, n_added);
+
+	n_items = g_list_model_get_n_items (G_LIST_MODEL (fixture->store));
+	g_assert_cmpuint (fixture->mirror->len, ==, n_items);
+	for (guint i = 0; i < n_items; i++) {
+		g_autoptr(GitlabProject) project = g_list_model_get_item (G_LIST_MODEL (fixture->store), i);
+
+		g_assert_true (g_ptr_array_index (fixture->mirror, i) == project);
+	}
+}
+
+static void
+assert_names (Fixture     *fixture,
+              const gchar *names)
+{
+	g_autoptr(GString) joined = g_string_new (NULL);
+
+	for (guint i = 0; i < fixture->mirror->len; i++) {
+		if (i > 0)
+			g_string_append_c (joined, ',');
+		g_string_append (joined, gitlab_project_get_name (g_ptr_array_index (fixture->mirror, i)));
+	}
+
+	g_assert_cmpstr (joined->str, ==, names);
+}
+
+static void
+test_merge (Fixture       *fixture,
+            gconstpointer  user_data)
+{
+	g_autoptr(GPtrArray) batch = g_ptr_array_new_with_free_func (g_object_unref);
+	g_autoptr(GitlabProject) charlie = new_project (2, "Charlie");
+
+	/* A batch is sorted by name, case insensitive, whatever its order */
+	g_ptr_array_add (batch, new_project (3, "echo"));
+	g_ptr_array_add (batch, new_project (1, "Alpha"));
+	g_ptr_array_add (batch, g_object_ref (charlie));
+	update (fixture, batch, NULL, 0, 0, 3);
+	assert_names (fixture, "Alpha,Charlie,echo");
+
+	/* New projects are merged in between */
+	g_ptr_array_set_size (batch, 0);
+	g_ptr_array_add (batch, new_project (4, "delta"));
+	g_ptr_array_add (batch, new_project (5, "Bravo"));
+	update (fixture, batch, NULL, 1, 1, 3);
+	assert_names (fixture, "Alpha,Bravo,Charlie,delta,echo");
+
+	/* Handing in the same objects again changes nothing */
+	g_ptr_array_set_size (batch, 0);
+	g_ptr_array_add (batch, g_object_ref (charlie));
+	gitlab_project_store_update (fixture->store, batch, NULL);
+	g_assert_cmpuint (fixture->changes, ==, 2);
+
+	g_assert_true (gitlab_project_store_lookup (fixture->store, 2) == charlie);
+	g_assert_true (gitlab_project_store_lookup_name (fixture->store, "CHARLIE") == charlie);
+	g_assert_null (gitlab_project_store_lookup_name (fixture->store, "char"));
+}
+
+static void
+test_replace (Fixture       *fixture,
+              gconstpointer  user_data)
+{
+	g_autoptr(GPtrArray) batch = g_ptr_array_new_with_free_func (g_object_unref);
+	g_autoptr(GitlabProject) renamed = new_project (1, "foxtrot");
+
+	g_ptr_array_add (batch, new_project (1, "alpha"));
+	g_ptr_array_add (batch, new_project (2, "charlie"));
+	g_ptr_array_add (batch, new_project (3, "echo"));
+	g_ptr_array_add (batch, new_project (4, "golf"));
+	update (fixture, batch, NULL, 0, 0, 4);
+
+	/* A new version in the same place is one replaced item */
+	g_ptr_array_set_size (batch, 0);
+	g_ptr_array_add (batch, new_project (2, "charlie"));
+	update (fixture, batch, NULL, 1, 1, 1);
+	assert_names (fixture, "alpha,charlie,echo,golf");
+
+	/* A rename moves the project, the change spans from old to new place */
+	g_ptr_array_set_size (batch, 0);
+	g_ptr_array_add (batch, g_object_ref (renamed));
+	update (fixture, batch, NULL, 0, 3, 3);
+	assert_names (fixture, "charlie,echo,foxtrot,golf");
+	g_assert_true (gitlab_project_store_lookup (fixture->store, 1) == renamed);
+	g_assert_null (gitlab_project_store_lookup_name (fixture->store, "alpha"));
+}
+
+static void
+test_remove (Fixture       *fixture,
+             gconstpointer  user_data)
+{
+	g_autoptr(GPtrArray) batch = g_ptr_array_new_with_free_func (g_object_unref);
+	g_autoptr(GPtrArray) removed = g_ptr_array_new_with_free_func (g_object_unref);
+	g_autoptr(GPtrArray) found = NULL;
+
+	g_ptr_array_add (batch, new_project (1, "GNOME / gnome-builder"));
+	g_ptr_array_add (batch, new_project (2, "GNOME / gnome-shell"));
+	g_ptr_array_add (batch, new_project (3, "GNOME / gtk"));
+	update (fixture, batch, NULL, 0, 0, 3);
+
+	/* Removals and additions of one batch are a single change */
+	g_ptr_array_set_size (batch, 0);
+	g_ptr_array_add (batch, new_project (4, "GNOME / gnome-calendar"));
+	g_ptr_array_add (removed, new_project (2, "GNOME / gnome-shell"));
+	update (fixture, batch, removed, 1, 1, 1);
+	assert_names (fixture, "GNOME / gnome-builder,GNOME / gnome-calendar,GNOME / gtk");
+
+	g_assert_null (gitlab_project_store_lookup (fixture->store, 2));
+
+	found = gitlab_project_store_search (fixture->store, "shell");
+	g_assert_cmpuint (found->len, ==, 0);
+	g_clear_pointer (&found, g_ptr_array_unref);
+
+	found = gitlab_project_store_search (fixture->store, "cal");
+	g_assert_cmpuint (found->len, ==, 1);
+	g_assert_cmpint (gitlab_project_get_id (g_ptr_array_index (found, 0)), ==, 4);
+
+	/* Removing what the store does not have changes nothing */
+	gitlab_project_store_update (fixture->store, NULL, removed);
+	g_assert_cmpuint (fixture->changes, ==, 2);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add ("/project-store/merge", Fixture, NULL, fixture_set_up, test_merge, fixture_tear_down);
+	g_test_add ("/project-store/replace", Fixture, NULL, fixture_set_up, test_replace, fixture_tear_down);
+	g_test_add ("/project-store/remove", Fixture, NULL, fixture_set_up, test_remove, fixture_tear_down);
+
+	return g_test_run ();
+}
@@ -0,0 +1,160 @@
+/* test-response-cache.c
+ *
+ * Copyright (C) 2017 Günther Wutz <info@gunibert.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gitlab-response-cache-private.h"
+
+/* A page of @n_items placeholder items */
+static GPtrArray *
+new_page (guint n_items)
+{
+	GPtrArray *items = g_ptr_array_new ();
+
+	for (guint i = 0; i < n_items; i++)
+		g_ptr_array_add (items, GUINT_TO_POINTER (i + 1));
+
+	return items;
+}
+
+static gboolean
+cache_contains (GitlabResponseCache *cache,
+                const gchar         *key)
+{
+	g_autofree gchar *etag = _gitlab_response_cache_get_etag (cache, key);
+
+	return etag != NULL;
+}
+
+static void
+test_hit (void)
+{
+	GitlabResponseCache *cache = _gitlab_response_cache_new (10);
+	g_autoptr(GPtrArray) page = new_page (3);
+	g_autoptr(GPtrArray) items = NULL;
+	g_autofree gchar *etag = NULL;
+	g_autofree gchar *next_url = NULL;
+	guint total_pages;
+	guint next_page;
+
+	g_assert_false (_gitlab_response_cache_take_hit (cache, "a", &items, &total_pages, &next_page, &next_url));
+
+	_gitlab_response_cache_take_miss (cache, "a", "\"1\"", page, 4, 2, "https://gitlab.example.com/next");
+
+	etag = _gitlab_response_cache_get_etag (cache, "a");
+	g_assert_cmpstr (etag, ==, "\"1\"");
+
+	/* A hit hands out the very array that was cached, nothing is parsed again */
+	g_assert_true (_gitlab_response_cache_take_hit (cache, "a", &items, &total_pages, &next_page, &next_url));
+	g_assert_true (items == page);
+	g_assert_cmpuint (total_pages, ==, 4);
+	g_assert_cmpuint (next_page, ==, 2);
+	g_assert_cmpstr (next_url, ==, "https://gitlab.example.com/next");
+
+	g_assert_cmpuint (_gitlab_response_cache_get_hits (cache), ==, 1);
+	g_assert_cmpuint (_gitlab_response_cache_get_misses (cache), ==, 1);
+
+	_gitlab_response_cache_free (cache);
+}
+
+static void
+test_without_etag (void)
+{
+	GitlabResponseCache *cache = _gitlab_response_cache_new (10);
+	g_autoptr(GPtrArray) page = new_page (3);
+
+	_gitlab_response_cache_take_miss (cache, "a", NULL, page, 1, 0, NULL);
+
+	g_assert_false (cache_contains (cache, "a"));
+	g_assert_cmpuint (_gitlab_response_cache_get_misses (cache), ==, 1);
+
+	_gitlab_response_cache_free (cache);
+}
+
+static void
+test_eviction (void)
+{
+	GitlabResponseCache *cache = _gitlab_response_cache_new (4);
+	g_autoptr(GPtrArray) a = new_page (2);
+	g_autoptr(GPtrArray) b = new_page (2);
+	g_autoptr(GPtrArray) c = new_page (2);
+	g_autoptr(GPtrArray) huge = new_page (5);
+	g_autoptr(GPtrArray) items = NULL;
+	g_autofree gchar *next_url = NULL;
+	guint total_pages;
+	guint next_page;
+
+	_gitlab_response_cache_take_miss (cache, "a", "\"a\"", a, 1, 0, NULL);
+	_gitlab_response_cache_take_miss (cache, "b", "\"b\"", b, 1, 0, NULL);
+
+	/* A hit makes "a" the most recently used page, so "b" goes first */
+	g_assert_true (_gitlab_response_cache_take_hit (cache, "a", &items, &total_pages, &next_page, &next_url));
+	_gitlab_response_cache_take_miss (cache, "c", "\"c\"", c, 1, 0, NULL);
+
+	g_assert_true (cache_contains (cache, "a"));
+	g_assert_false (cache_contains (cache, "b"));
+	g_assert_true (cache_contains (cache, "c"));
+
+	/* A page larger than the whole cache is not kept and evicts nothing */
+	_gitlab_response_cache_take_miss (cache, "huge", "\"huge\"", huge, 1, 0, NULL);
+
+	g_assert_false (cache_contains (cache, "huge"));
+	g_assert_true (cache_contains (cache, "a"));
+	g_assert_true (cache_contains (cache, "c"));
+
+	_gitlab_response_cache_free (cache);
+}
+
+static void
+test_replace (void)
+{
+	GitlabResponseCache *cache = _gitlab_response_cache_new (4);
+	g_autoptr(GPtrArray) old = new_page (2);
+	g_autoptr(GPtrArray) fresh = new_page (3);
+	g_autoptr(GPtrArray) other = new_page (1);
+	g_autofree gchar *etag = NULL;
+
+	_gitlab_response_cache_take_miss (cache, "a", "\"1\"", old, 1, 0, NULL);
+	_gitlab_response_cache_take_miss (cache, "a", "\"2\"", fresh, 1, 0, NULL);
+
+	/* The old version of "a" no longer counts against the bound */
+	_gitlab_response_cache_take_miss (cache, "b", "\"b\"", other, 1, 0, NULL);
+
+	etag = _gitlab_response_cache_get_etag (cache, "a");
+	g_assert_cmpstr (etag, ==, "\"2\"");
+	g_assert_true (cache_contains (cache, "b"));
+
+	_gitlab_response_cache_clear (cache);
+
+	g_assert_false (cache_contains (cache, "a"));
+	g_assert_false (cache_contains (cache, "b"));
+
+	_gitlab_response_cache_free (cache);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/response-cache/hit", test_hit);
+	g_test_add_func ("/response-cache/without-etag", test_without_etag);
+	g_test_add_func ("/response-cache/eviction", test_eviction);
+	g_test_add_func ("/response-cache/replace", test_replace);
+
+	return g_test_run ();
+}
@@ -0,0 +1,176 @@
+/* test-single-flight.c
+ *
+ * Copyright (C) 2017 Günther Wutz <info@gunibert.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gitlab-single-flight-private.h"
+
+typedef struct
+{
+	guint   completed;
+	GError *error;
+} Waiter;
+
+static void
+waiter_cb (GObject      *object,
+           GAsyncResult *result,
+           gpointer      user_data)
+{
+	Waiter *waiter = user_data;
+
+	waiter->completed++;
+	g_task_propagate_boolean (G_TASK (result), &waiter->error);
+}
+
+static void
+wait_for (Waiter *waiter)
+{
+	while (waiter->completed == 0)
+		g_main_context_iteration (NULL, TRUE);
+}
+
+/* Completes the tasks still waiting for @flight, like the leader would */
+static guint
+land (GitlabSingleFlight *flights,
+      GitlabFlight       *flight)
+{
+	g_autoptr(GPtrArray) tasks = _gitlab_single_flight_land (flights, flight);
+
+	for (guint i = 0; i < tasks->len; i++)
+		g_task_return_boolean (g_ptr_array_index (tasks, i), TRUE);
+
+	return tasks->len;
+}
+
+static void
+test_join (void)
+{
+	GitlabSingleFlight *flights = _gitlab_single_flight_new ();
+	Waiter first = { 0 };
+	Waiter second = { 0 };
+	Waiter third = { 0 };
+	g_autoptr(GTask) first_task = g_task_new (NULL, NULL, waiter_cb, &first);
+	g_autoptr(GTask) second_task = g_task_new (NULL, NULL, waiter_cb, &second);
+	g_autoptr(GTask) third_task = g_task_new (NULL, NULL, waiter_cb, &third);
+	GitlabFlight *flight;
+	GitlabFlight *next;
+
+	flight = _gitlab_single_flight_join (flights, "GET a", first_task);
+	g_assert_nonnull (flight);
+	g_assert_null (_gitlab_single_flight_join (flights, "GET a", second_task));
+
+	g_assert_cmpuint (land (flights, flight), ==, 2);
+	wait_for (&first);
+	wait_for (&second);
+	g_assert_no_error (first.error);
+	g_assert_no_error (second.error);
+
+	/* A landed flight frees its key for the next request */
+	next = _gitlab_single_flight_join (flights, "GET a", third_task);
+	g_assert_nonnull (next);
+	g_assert_cmpuint (land (flights, next), ==, 1);
+	wait_for (&third);
+	g_assert_no_error (third.error);
+
+	_gitlab_single_flight_free (flights);
+}
+
+static void
+test_cancel_waiter (void)
+{
+	GitlabSingleFlight *flights = _gitlab_single_flight_new ();
+	g_autoptr(GCancellable) cancellable = g_cancellable_new ();
+	Waiter leader = { 0 };
+	Waiter cancelled = { 0 };
+	g_autoptr(GTask) leader_task = g_task_new (NULL, NULL, waiter_cb, &leader);
+	g_autoptr(GTask) cancelled_task = g_task_new (NULL, cancellable, waiter_cb, &cancelled);
+	GitlabFlight *flight;
+
+	flight = _gitlab_single_flight_join (flights, "GET a", leader_task);
+	g_assert_null (_gitlab_single_flight_join (flights, "GET a", cancelled_task));
+
+	g_cancellable_cancel (cancellable);
+	wait_for (&cancelled);
+	g_assert_error (cancelled.error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+
+	/* Someone still waits, so the request goes on */
+	g_assert_false (g_cancellable_is_cancelled (_gitlab_flight_get_cancellable (flight)));
+
+	g_assert_cmpuint (land (flights, flight), ==, 1);
+	wait_for (&leader);
+	g_assert_no_error (leader.error);
+	g_assert_cmpuint (cancelled.completed, ==, 1);
+
+	g_clear_error (&cancelled.error);
+	_gitlab_single_flight_free (flights);
+}
+
+static void
+test_cancel_last_waiter (void)
+{
+	GitlabSingleFlight *flights = _gitlab_single_flight_new ();
+	g_autoptr(GCancellable) first_cancellable = g_cancellable_new ();
+	g_autoptr(GCancellable) second_cancellable = g_cancellable_new ();
+	Waiter first = { 0 };
+	Waiter second = { 0 };
+	Waiter third = { 0 };
+	g_autoptr(GTask) first_task = g_task_new (NULL, first_cancellable, waiter_cb, &first);
+	g_autoptr(GTask) second_task = g_task_new (NULL, second_cancellable, waiter_cb, &second);
+	g_autoptr(GTask) third_task = g_task_new (NULL, NULL, waiter_cb, &third);
+	GitlabFlight *flight;
+	GitlabFlight *next;
+
+	flight = _gitlab_single_flight_join (flights, "GET a", first_task);
+	g_assert_null (_gitlab_single_flight_join (flights, "GET a", second_task));
+
+	g_cancellable_cancel (first_cancellable);
+	g_cancellable_cancel (second_cancellable);
+	wait_for (&first);
+	wait_for (&second);
+	g_assert_error (first.error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+	g_assert_error (second.error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+
+	/* Nobody waits anymore, so the request is cancelled and the key freed */
+	g_assert_true (g_cancellable_is_cancelled (_gitlab_flight_get_cancellable (flight)));
+
+	next = _gitlab_single_flight_join (flights, "GET a", third_task);
+	g_assert_nonnull (next);
+	g_assert_true (next != flight);
+	g_assert_false (g_cancellable_is_cancelled (_gitlab_flight_get_cancellable (next)));
+
+	/* The abandoned flight still lands, without anyone to complete */
+	g_assert_cmpuint (land (flights, flight), ==, 0);
+	g_assert_cmpuint (land (flights, next), ==, 1);
+	wait_for (&third);
+	g_assert_no_error (third.error);
+
+	g_clear_error (&first.error);
+	g_clear_error (&second.error);
+	_gitlab_single_flight_free (flights);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/single-flight/join", test_join);
+	g_test_add_func ("/single-flight/cancel-waiter", test_cancel_waiter);
+	g_test_add_func ("/single-flight/cancel-last-waiter", test_cancel_last_waiter);
+
+	return g_test_run ();
+}
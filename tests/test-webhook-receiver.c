@@ -0,0 +1,277 @@
+/* test-webhook-receiver.c
+ *
+ * Copyright (C) 2017 Günther Wutz <info@gunibert.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Posts recorded gitlab payloads to a receiver listening on localhost and
+ * checks what they do to its store.
+ */
+
+#include <gitlab.h>
+#include <libsoup/soup.h>
+#include <string.h>
+
+#define TOKEN "s3cret"
+
+static const gchar *push_event =
+	"{\"object_kind\":\"push\",\"event_name\":\"push\","
+	"\"before\":\"95790bf891e76fee5e1747ab589903a6a1f80f22\","
+	"\"after\":\"da1560886d4f094c3e6c9ef40349f7d38b5d27d7\","
+	"\"ref\":\"refs/heads/master\",\"user_id\":4,\"user_name\":\"John Smith\","
+	"\"project_id\":15,"
+	"\"project\":{\"id\":15,\"name\":\"Diaspora\",\"description\":\"A social network\","
+	"\"web_url\":\"http://example.com/mike/diaspora\",\"avatar_url\":null,"
+	"\"git_http_url\":\"http://example.com/mike/diaspora.git\","
+	"\"namespace\":\"Mike\",\"path_with_namespace\":\"mike/diaspora\"},"
+	"\"commits\":["
+	"{\"id\":\"b6568db1bc1dcd7f8b4d5a946b0b91f9dacd7327\",\"message\":\"Update Catalan translation\","
+	"\"timestamp\":\"2011-12-12T14:27:31+02:00\"},"
+	"{\"id\":\"da1560886d4f094c3e6c9ef40349f7d38b5d27d7\",\"message\":\"fixed readme\","
+	"\"timestamp\":\"2012-01-03T23:36:29+02:00\"}],"
+	"\"total_commits_count\":2}";
+
+static const gchar *issue_event =
+	"{\"object_kind\":\"issue\",\"event_type\":\"issue\","
+	"\"user\":{\"id\":1,\"name\":\"Administrator\",\"username\":\"root\"},"
+	"\"project\":{\"id\":15,\"name\":\"Diaspora\",\"description\":\"A social network\","
+	"\"avatar_url\":null,\"git_http_url\":\"http://example.com/mike/diaspora.git\","
+	"\"namespace\":\"Mike\",\"path_with_namespace\":\"mike/diaspora\"},"
+	"\"object_attributes\":{\"id\":301,\"iid\":23,\"project_id\":15,"
+	"\"title\":\"New API: create/update/delete file\",\"description\":\"Create new API for manipulations with repository\","
+	"\"state\":\"opened\",\"created_at\":\"2013-12-03 17:15:43 UTC\","
+	"\"updated_at\":\"2013-12-03 17:15:43 UTC\","
+	"\"url\":\"http://example.com/mike/diaspora/issues/23\",\"action\":\"open\"}}";
+
+static const gchar *project_rename_event =
+	"{\"event_name\":\"project_rename\",\"created_at\":\"2012-07-21T07:30:58Z\","
+	"\"updated_at\":\"2012-07-21T07:38:22Z\",\"name\":\"Rename\",\"path\":\"rename\","
+	"\"path_with_namespace\":\"jsmith/rename\",\"project_id\":15,"
+	"\"owner_name\":\"John Smith\",\"owner_email\":\"johnsmith@example.com\","
+	"\"project_visibility\":\"internal\",\"old_path_with_namespace\":\"jsmith/overscore\"}";
+
+static const gchar *project_destroy_event =
+	"{\"event_name\":\"project_destroy\",\"created_at\":\"2012-07-21T07:30:58Z\","
+	"\"updated_at\":\"2012-07-21T07:38:22Z\",\"name\":\"Diaspora\","
+	"\"path\":\"diaspora\",\"path_with_namespace\":\"mike/diaspora\",\"project_id\":15,"
+	"\"owner_name\":\"Mike\",\"owner_email\":\"mike@example.com\","
+	"\"project_visibility\":\"internal\"}";
+
+typedef struct
+{
+	GitlabProjectStore    *store;
+	GitlabWebhookReceiver *receiver;
+	SoupSession           *session;
+	gchar                 *url;
+	GMainLoop             *loop;
+	guint                  changed;
+	guint                  removed;
+	guint                  issues;
+} Fixture;
+
+static void
+project_changed_cb (GitlabWebhookReceiver *receiver,
+                    GitlabProject         *project,
+                    Fixture               *fixture)
+{
+	fixture->changed++;
+}
+
+static void
+project_removed_cb (GitlabWebhookReceiver *receiver,
+                    GitlabProject         *project,
+                    Fixture               *fixture)
+{
+	fixture->removed++;
+}
+
+static void
+issue_changed_cb (GitlabWebhookReceiver *receiver,
+                  GitlabIssue           *issue,
+                  Fixture               *fixture)
+{
+	fixture->issues++;
+}
+
+static void
+fixture_set_up (Fixture       *fixture,
+                gconstpointer  user_data)
+{
+	g_autoptr(GError) error = NULL;
+
+	fixture->store = gitlab_project_store_new ();
+	fixture->receiver = gitlab_webhook_receiver_new (fixture->store, TOKEN);
+	fixture->session = soup_session_new ();
+	fixture->loop = g_main_loop_new (NULL, FALSE);
+
+	g_signal_connect (fixture->receiver, "project-changed", G_CALLBACK (project_changed_cb), fixture);
+	g_signal_connect (fixture->receiver, "project-removed", G_CALLBACK (project_removed_cb), fixture);
+	g_signal_connect (fixture->receiver, "issue-changed", G_CALLBACK (issue_changed_cb), fixture);
+
+	gitlab_webhook_receiver_listen (fixture->receiver, 0, TRUE, &error);
+	g_assert_no_error (error);
+
+	fixture->url = g_strdup_printf ("http://127.0.0.1:%u/hook",
+	                                gitlab_webhook_receiver_get_port (fixture->receiver));
+}
+
+static void
+fixture_tear_down (Fixture       *fixture,
+                   gconstpointer  user_data)
+{
+	g_free (fixture->url);
+	g_main_loop_unref (fixture->loop);
+	g_object_unref (fixture->session);
+	g_object_unref (fixture->receiver);
+	g_object_unref (fixture->store);
+}
+
+static void
+post_cb (SoupSession *session,
+         SoupMessage *msg,
+         gpointer     user_data)
+{
+	g_main_loop_quit (user_data);
+}
+
+/* The receiver runs in the same main context, so the request is queued */
+static guint
+post (Fixture     *fixture,
+      const gchar *token,
+      const gchar *body)
+{
+	SoupMessage *msg = soup_message_new (SOUP_METHOD_POST, fixture->url);
+	guint status;
+
+	if (token != NULL)
+		soup_message_headers_replace (msg->request_headers, "X-Gitlab-Token", token);
+	soup_message_set_request (msg, "application/json", SOUP_MEMORY_STATIC, body, strlen (body));
+
+	g_object_ref (msg);
+	soup_session_queue_message (fixture->session, msg, post_cb, fixture->loop);
+	g_main_loop_run (fixture->loop);
+
+	status = msg->status_code;
+	g_object_unref (msg);
+
+	return status;
+}
+
+static void
+test_push (Fixture       *fixture,
+           gconstpointer  user_data)
+{
+	GitlabProject *project;
+
+	g_assert_cmpuint (post (fixture, TOKEN, push_event), ==, SOUP_STATUS_OK);
+	g_assert_cmpuint (fixture->changed, ==, 1);
+
+	project = gitlab_project_store_lookup (fixture->store, 15);
+	g_assert_nonnull (project);
+	g_assert_cmpstr (gitlab_project_get_name (project), ==, "Mike / Diaspora");
+	g_assert_cmpstr (gitlab_project_get_http_url_to_repo (project), ==, "http://example.com/mike/diaspora.git");
+	/* The last commit, in the format of the api */
+	g_assert_cmpstr (gitlab_project_get_last_activity_at (project), ==, "2012-01-03T21:36:29.000Z");
+}
+
+static void
+test_replaces_project (Fixture       *fixture,
+                       gconstpointer  user_data)
+{
+	g_autoptr(GitlabProject) listed = NULL;
+	g_autoptr(GPtrArray) projects = g_ptr_array_new ();
+	GitlabProject *project;
+
+	listed = g_object_new (GITLAB_TYPE_PROJECT,
+	                       "id", 15,
+	                       "name", "Diaspora",
+	                       "last-activity-at", "2014-01-01T00:00:00.000Z",
+	                       "star-count", 7,
+	                       "open-issues-count", 3,
+	                       NULL);
+	g_ptr_array_add (projects, listed);
+	gitlab_project_store_update (fixture->store, projects, NULL);
+
+	g_assert_cmpuint (post (fixture, TOKEN, push_event), ==, SOUP_STATUS_OK);
+
+	/* Listed projects may be shared, they are replaced and never changed */
+	project = gitlab_project_store_lookup (fixture->store, 15);
+	g_assert_true (project != listed);
+	g_assert_cmpstr (gitlab_project_get_name (listed), ==, "Diaspora");
+	g_assert_cmpstr (gitlab_project_get_name (project), ==, "Mike / Diaspora");
+	g_assert_cmpint (gitlab_project_get_star_count (project), ==, 7);
+	g_assert_cmpint (gitlab_project_get_open_issues_count (project), ==, 3);
+
+	/* The push is older than the listing, the activity does not go back */
+	g_assert_cmpstr (gitlab_project_get_last_activity_at (project), ==, "2014-01-01T00:00:00.000Z");
+}
+
+static void
+test_issue (Fixture       *fixture,
+            gconstpointer  user_data)
+{
+	g_assert_cmpuint (post (fixture, TOKEN, issue_event), ==, SOUP_STATUS_OK);
+	g_assert_cmpuint (fixture->issues, ==, 1);
+	g_assert_cmpuint (fixture->changed, ==, 1);
+	g_assert_nonnull (gitlab_project_store_lookup (fixture->store, 15));
+}
+
+static void
+test_system_hooks (Fixture       *fixture,
+                   gconstpointer  user_data)
+{
+	GitlabProject *project;
+
+	g_assert_cmpuint (post (fixture, TOKEN, push_event), ==, SOUP_STATUS_OK);
+	g_assert_cmpuint (post (fixture, TOKEN, project_rename_event), ==, SOUP_STATUS_OK);
+
+	/* System hooks only know the path, the name stays */
+	project = gitlab_project_store_lookup (fixture->store, 15);
+	g_assert_cmpstr (gitlab_project_get_name (project), ==, "Mike / Diaspora");
+	g_assert_cmpstr (gitlab_project_get_last_activity_at (project), ==, "2012-07-21T07:38:22.000Z");
+
+	g_assert_cmpuint (post (fixture, TOKEN, project_destroy_event), ==, SOUP_STATUS_OK);
+	g_assert_cmpuint (fixture->removed, ==, 1);
+	g_assert_null (gitlab_project_store_lookup (fixture->store, 15));
+}
+
+static void
+test_rejects (Fixture       *fixture,
+              gconstpointer  user_data)
+{
+	g_assert_cmpuint (post (fixture, NULL, push_event), ==, SOUP_STATUS_UNAUTHORIZED);
+	g_assert_cmpuint (post (fixture, "s3cre", push_event), ==, SOUP_STATUS_UNAUTHORIZED);
+	g_assert_cmpuint (post (fixture, TOKEN, "{\"object_kind\":"), ==, SOUP_STATUS_BAD_REQUEST);
+	g_assert_cmpuint (post (fixture, TOKEN, "[]"), ==, SOUP_STATUS_BAD_REQUEST);
+
+	g_assert_cmpuint (fixture->changed, ==, 0);
+	g_assert_null (gitlab_project_store_lookup (fixture->store, 15));
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add ("/webhook-receiver/push", Fixture, NULL, fixture_set_up, test_push, fixture_tear_down);
+	g_test_add ("/webhook-receiver/replaces-project", Fixture, NULL, fixture_set_up, test_replaces_project, fixture_tear_down);
+	g_test_add ("/webhook-receiver/issue", Fixture, NULL, fixture_set_up, test_issue, fixture_tear_down);
+	g_test_add ("/webhook-receiver/system-hooks", Fixture, NULL, fixture_set_up, test_system_hooks, fixture_tear_down);
+	g_test_add ("/webhook-receiver/rejects", Fixture, NULL, fixture_set_up, test_rejects, fixture_tear_down);
+
+	return g_test_run ();
+}